@@ -17,16 +17,50 @@
 #define BOOST_TEST_MODULE reachability
 
 #include <boost/test/unit_test.hpp>
+#include <cstdio>
 #include <string>
 #include <fstream>
+#include <random>
 #include <sstream>
 
 #include "utils.h"
+#include "PetriEngine/PQL/Bytecode.h"
+#include "PetriEngine/PQL/Evaluation.h"
+#include "PetriEngine/PQL/IncrementalDistance.h"
+#include "PetriEngine/SuccessorGenerator.h"
+#include "CTL/CTLEngine.h"
+#include "CTL/CTLResult.h"
+#include "CTL/PetriNets/SubformulaCache.h"
 
 using namespace PetriEngine;
 using namespace PetriEngine::Colored;
 namespace utf = boost::unit_test;
 
+// the queries of the Angiogenesis-PT-01 files and the answers to ReachabilityCardinality.xml
+const std::set<size_t> all_queries{0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15};
+const std::vector<Reachability::ResultPrinter::Result> cardinality_results{
+    Reachability::ResultPrinter::Satisfied,
+    Reachability::ResultPrinter::Satisfied,
+    Reachability::ResultPrinter::Satisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::Satisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::Satisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::Satisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::NotSatisfied,
+    Reachability::ResultPrinter::NotSatisfied};
+
+auto load_angiogenesis(const std::string& queries, const std::set<size_t>& qnums = all_queries)
+{
+    return load_pn("/models/Angiogenesis-PT-01/model.pnml", "/models/Angiogenesis-PT-01/" + queries, qnums);
+}
+
 BOOST_AUTO_TEST_CASE(DirectoryTest) {
     BOOST_REQUIRE(getenv("TEST_FILES"));
 }
@@ -114,3 +148,416 @@ BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityFireability, * utf::timeout(60)
         }
     }
 }
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityMultiCore, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+
+    for (auto i : all_queries) {
+        for (auto search :{Strategy::BFS, Strategy::DFS, Strategy::HEUR, Strategy::RDFS}) {
+            for (bool stub :{true, false}) {
+                for (bool trace :{true, false}) {
+                    auto c2 = prepareForReachability(conditions[i]);
+                    ReachabilitySearch strategy(*pn, handler, 0);
+                    std::vector<Condition_ptr> vec{c2};
+                    std::vector<Reachability::ResultPrinter::Result> results{Reachability::ResultPrinter::Unknown};
+                    strategy.reachable(vec, results, search, stub, false, false, trace, 0, 4);
+                    BOOST_REQUIRE_EQUAL(cardinality_results[i], results[0]);
+                }
+            }
+        }
+    }
+}
+
+// counts the answers reported for each query, answering as ResultHandler
+class CountingHandler : public Reachability::AbstractHandler {
+public:
+    std::vector<size_t> reported = std::vector<size_t>(all_queries.size(), 0);
+
+    std::pair<Result, bool> handle(size_t index, PQL::Condition* query, Result result,
+            const std::vector<uint32_t>* maxPlaceBound, size_t expandedStates, size_t exploredStates,
+            size_t discoveredStates, int maxTokens, Structures::StateSetInterface* stateset,
+            size_t lastmarking, const MarkVal* initialMarking, bool trace) override {
+        ++reported[index];
+        return static_cast<AbstractHandler&>(_handler).handle(index, query, result, maxPlaceBound,
+            expandedStates, exploredStates, discoveredStates, maxTokens, stateset, lastmarking, initialMarking, trace);
+    }
+
+private:
+    ResultHandler _handler;
+};
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityMultiCoreAnswered, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    // queries answered before the search, as by simplification, are neither checked nor reported again
+    for (auto search :{Strategy::BFS, Strategy::DFS, Strategy::HEUR}) {
+        for (bool stub :{true, false}) {
+            std::vector<Condition_ptr> vec;
+            std::vector<Reachability::ResultPrinter::Result> results;
+            for (auto i : all_queries) {
+                vec.push_back(prepareForReachability(conditions[i]));
+                results.push_back(i % 2 == 0 ? cardinality_results[i] : Reachability::ResultPrinter::Unknown);
+            }
+            CountingHandler handler;
+            ReachabilitySearch strategy(*pn, handler, 0);
+            strategy.reachable(vec, results, search, stub, false, false, false, 0, 4);
+            for (auto i : all_queries) {
+                BOOST_REQUIRE_EQUAL(cardinality_results[i], results[i]);
+                BOOST_REQUIRE_EQUAL(handler.reported[i], i % 2 == 0 ? 0 : 1);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityBitstate, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+
+    // bitstate hashing only concludes on a witness, exhausting the search leaves the query unknown
+    for (auto i : all_queries) {
+        for (auto search :{Strategy::BFS, Strategy::DFS}) {
+            for (bool trace :{true, false}) {
+                auto c2 = prepareForReachability(conditions[i]);
+                ReachabilitySearch strategy(*pn, handler, 0);
+                strategy.setBitstate(24, 3, 0);
+                std::vector<Condition_ptr> vec{c2};
+                std::vector<Reachability::ResultPrinter::Result> results{Reachability::ResultPrinter::Unknown};
+                strategy.reachable(vec, results, search, true, false, false, trace, 0);
+                BOOST_REQUIRE(results[0] == Reachability::ResultPrinter::Unknown || results[0] == cardinality_results[i]);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityBitstateUnsolved, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+    std::vector<Condition_ptr> vec;
+    std::vector<Reachability::ResultPrinter::Result> results;
+    std::vector<std::string> names;
+    for (auto i : all_queries) {
+        vec.push_back(prepareForReachability(conditions[i]));
+        results.push_back(Reachability::ResultPrinter::Unknown);
+        names.push_back("Query-" + std::to_string(i));
+    }
+    ReachabilitySearch strategy(*pn, handler, 0);
+    strategy.setBitstate(24, 3, 0);
+    strategy.reachable(vec, results, Strategy::BFS, false, false, false, false, 0);
+
+    // the queries the bitstate search leaves open are reported, the others are not
+    std::stringstream out;
+    Reachability::ResultPrinter printer(nullptr, nullptr, names);
+    printer.printUnsolved(out, results, "by the bitstate search");
+    size_t open = 0;
+    for (auto i : all_queries) {
+        auto line = "FORMULA " + names[i] + " CANNOT_COMPUTE\n";
+        bool printed = out.str().find(line) != std::string::npos;
+        BOOST_REQUIRE_EQUAL(printed, results[i] == Reachability::ResultPrinter::Unknown);
+        if (printed) {
+            ++open;
+            BOOST_REQUIRE(out.str().find("Query index " + std::to_string(i) +
+                " could not be solved by the bitstate search\n") != std::string::npos);
+        }
+        else
+            BOOST_REQUIRE_EQUAL(cardinality_results[i], results[i]);
+    }
+    // unsatisfiable queries are never concluded by bitstate hashing
+    BOOST_REQUIRE_GT(open, 0);
+}
+
+// a random token-preserving net where every arc weight and marking is a multiple of scale,
+// together with queries comparing each place to multiples of scale
+auto scaled_net(uint32_t seed, uint32_t scale)
+{
+    std::mt19937 rng(seed);
+    shared_string_set sset;
+    PetriNetBuilder builder(sset);
+    const uint32_t places = 3 + rng() % 4, transitions = 2 + rng() % 6;
+    for (uint32_t p = 0; p < places; ++p)
+        builder.addPlace("p" + std::to_string(p), (rng() % 3) * scale, 0, 0);
+    for (uint32_t t = 0; t < transitions; ++t) {
+        auto name = "t" + std::to_string(t);
+        builder.addTransition(name, 0, 0, 0);
+        auto in = rng() % places, out = rng() % places;
+        builder.addInputArc("p" + std::to_string(in), name, false, scale);
+        builder.addOutputArc(name, "p" + std::to_string(out), scale);
+        if (rng() % 2 == 0) {
+            builder.addInputArc("p" + std::to_string((in + 1) % places), name, false, scale);
+            builder.addOutputArc(name, "p" + std::to_string((out + 1) % places), scale);
+        }
+    }
+    std::shared_ptr<PetriNet> net(builder.makePetriNet(false));
+
+    std::vector<Condition_ptr> queries;
+    for (uint32_t p = 0; p < places; ++p) {
+        auto name = std::make_shared<const std::string>("p" + std::to_string(p));
+        auto index = std::find_if(net->placeNames().begin(), net->placeNames().end(),
+                                  [&](auto& n) { return *n == *name; }) - net->placeNames().begin();
+        auto place = std::make_shared<UnfoldedIdentifierExpr>(name, (int)index);
+        for (int c = 1; c <= 3; ++c) {
+            auto bound = std::make_shared<LiteralExpr>(c * (int)scale);
+            auto below = std::make_shared<LiteralExpr>(c * (int)scale - 1);
+            queries.push_back(std::make_shared<EFCondition>(std::make_shared<LessThanOrEqualCondition>(bound, place)));
+            queries.push_back(std::make_shared<EFCondition>(std::make_shared<LessThanOrEqualCondition>(place, below)));
+        }
+    }
+    return std::make_pair(net, queries);
+}
+
+BOOST_AUTO_TEST_CASE(WideArcsMatchCompactArcs, * utf::timeout(60)) {
+
+    ResultHandler handler;
+    // weights of 40000 do not fit the 16-bit compact layout of the firing arcs
+    for (uint32_t seed = 0; seed < 20; ++seed) {
+        auto [compact, compactQueries] = scaled_net(seed, 1);
+        auto [wide, wideQueries] = scaled_net(seed, 40000);
+        BOOST_REQUIRE(compact->compact());
+        BOOST_REQUIRE(!wide->compact());
+        for (auto search :{Strategy::BFS, Strategy::DFS, Strategy::HEUR}) {
+            for (bool stub :{true, false}) {
+                std::vector<Reachability::ResultPrinter::Result> expected, results;
+                for (auto* net :{compact.get(), wide.get()}) {
+                    auto& queries = net == compact.get() ? compactQueries : wideQueries;
+                    std::vector<Condition_ptr> vec;
+                    for (auto& q : queries)
+                        vec.push_back(prepareForReachability(q));
+                    auto& res = net == compact.get() ? expected : results;
+                    res.assign(vec.size(), Reachability::ResultPrinter::Unknown);
+                    ReachabilitySearch strategy(*net, handler, 0);
+                    strategy.reachable(vec, res, search, stub, false, false, false, 0);
+                }
+                BOOST_REQUIRE(std::find(expected.begin(), expected.end(),
+                                        Reachability::ResultPrinter::Unknown) == expected.end());
+                BOOST_REQUIRE(expected == results);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityExternal, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+
+    for (auto i : all_queries) {
+        for (bool stub :{true, false}) {
+            auto c2 = prepareForReachability(conditions[i]);
+            ReachabilitySearch strategy(*pn, handler, 0);
+            // use the smallest possible sorting buffer
+            strategy.setExternal(".", 1024);
+            std::vector<Condition_ptr> vec{c2};
+            std::vector<Reachability::ResultPrinter::Result> results{Reachability::ResultPrinter::Unknown};
+            strategy.reachable(vec, results, Strategy::BFS, stub, false, false, false, 0);
+            BOOST_REQUIRE_EQUAL(cardinality_results[i], results[0]);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityResume, * utf::timeout(60)) {
+
+    std::set<size_t> qnums{3, 4, 5};
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml", qnums);
+
+    ResultHandler handler;
+
+    for (auto i : qnums) {
+        for (auto search : {Strategy::BFS, Strategy::DFS, Strategy::HEUR}) {
+            auto c2 = prepareForReachability(conditions[i]);
+            std::vector<Condition_ptr> vec{c2};
+            {
+                // checkpoint after every expansion, leaving the state just before the search ended
+                ReachabilitySearch strategy(*pn, handler, 0);
+                strategy.setCheckpoint("resume_test.ckpt", 0);
+                std::vector<Reachability::ResultPrinter::Result> results{Reachability::ResultPrinter::Unknown};
+                strategy.reachable(vec, results, search, false, false, false, false, 0);
+                BOOST_REQUIRE_EQUAL(Reachability::ResultPrinter::NotSatisfied, results[0]);
+            }
+            {
+                ReachabilitySearch strategy(*pn, handler, 0);
+                strategy.setResume("resume_test.ckpt");
+                std::vector<Reachability::ResultPrinter::Result> results{Reachability::ResultPrinter::Unknown};
+                strategy.reachable(vec, results, search, false, false, false, false, 0);
+                BOOST_REQUIRE_EQUAL(Reachability::ResultPrinter::NotSatisfied, results[0]);
+            }
+            {
+                // another query of the same count must not continue the search
+                ReachabilitySearch strategy(*pn, handler, 0);
+                strategy.setResume("resume_test.ckpt");
+                std::vector<Condition_ptr> other{prepareForReachability(conditions[i == 3 ? 4 : 3])};
+                std::vector<Reachability::ResultPrinter::Result> results{Reachability::ResultPrinter::Unknown};
+                BOOST_REQUIRE_THROW(strategy.reachable(other, results, search, false, false, false, false, 0), base_error);
+            }
+            std::remove("resume_test.ckpt");
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityEnabledCache, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+
+    for (auto i : all_queries) {
+        for (bool stub :{true, false}) {
+            // a budget of a few sets also covers the fallback to computing them
+            for (size_t budget : {size_t{256}, size_t{1} << 20}) {
+                auto c2 = prepareForReachability(conditions[i]);
+                ReachabilitySearch strategy(*pn, handler, 0);
+                strategy.setEnabledCache(budget);
+                std::vector<Condition_ptr> vec{c2};
+                std::vector<Reachability::ResultPrinter::Result> results{Reachability::ResultPrinter::Unknown};
+                strategy.reachable(vec, results, Strategy::DFS, stub, false, false, false, 0);
+                BOOST_REQUIRE_EQUAL(cardinality_results[i], results[0]);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityAllQueries, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+
+    // searching for all queries at once, their comparisons are evaluated through the shared cache
+    for (auto search : {Strategy::DFS, Strategy::BFS}) {
+        std::vector<Condition_ptr> vec;
+        for (auto i : all_queries)
+            vec.push_back(prepareForReachability(conditions[i]));
+        ReachabilitySearch strategy(*pn, handler, 0);
+        std::vector<Reachability::ResultPrinter::Result> results(vec.size(), Reachability::ResultPrinter::Unknown);
+        strategy.reachable(vec, results, search, false, false, false, false, 0);
+        for (auto i : all_queries)
+            BOOST_REQUIRE_EQUAL(cardinality_results[i], results[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityBytecode, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    // the compiled queries evaluate and measure distances as the conditions do
+    for (auto i : all_queries) {
+        auto c2 = prepareForReachability(conditions[i]);
+        auto program = PQL::Bytecode::compile(c2.get(), pn.get());
+        BOOST_REQUIRE(program != nullptr);
+        PQL::EvaluationContext context(pn->initial(), pn.get());
+        BOOST_REQUIRE_EQUAL(PQL::evaluate(c2.get(), context), program->evaluate(pn->initial()));
+        for (bool negated : {false, true}) {
+            PQL::DistanceContext dc(pn.get(), pn->initial());
+            if (negated) dc.negate();
+            BOOST_REQUIRE_EQUAL(c2->distance(dc), program->distance(pn->initial(), negated));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityIncrementalDistance, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    // the distances derived from the initial marking are those of its successors
+    for (auto i : all_queries) {
+        auto c2 = prepareForReachability(conditions[i]);
+        auto program = PQL::Bytecode::compile(c2.get(), pn.get());
+        BOOST_REQUIRE(program != nullptr);
+        PQL::IncrementalDistance distance(*program, *pn);
+        BOOST_REQUIRE_EQUAL(distance.evaluate(pn->initial()), program->distance(pn->initial()));
+
+        SuccessorGenerator generator(*pn);
+        Structures::State state, working;
+        state.setMarking(pn->makeInitialMarking());
+        working.setMarking(pn->makeInitialMarking());
+        generator.prepare(&state);
+        while (generator.next(working))
+            BOOST_REQUIRE_EQUAL(distance.successor(working.marking(), generator.fired()),
+                                program->distance(working.marking()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalityAllQueriesStubborn, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+
+    // answered queries leave the stubborn set and the heuristic while the others are still searched for
+    for (auto search : {Strategy::DFS, Strategy::HEUR}) {
+        std::vector<Condition_ptr> vec;
+        for (auto i : all_queries)
+            vec.push_back(prepareForReachability(conditions[i]));
+        ReachabilitySearch strategy(*pn, handler, 0);
+        std::vector<Reachability::ResultPrinter::Result> results(vec.size(), Reachability::ResultPrinter::Unknown);
+        strategy.reachable(vec, results, search, true, false, false, false, 0);
+        for (auto i : all_queries)
+            BOOST_REQUIRE_EQUAL(cardinality_results[i], results[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01ReachabilityCardinalitySwarm, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("ReachabilityCardinality.xml");
+
+    ResultHandler handler;
+
+    // the first answer of any worker is kept, and the workers stop once all queries are answered
+    for (uint32_t workers : {1, 4}) {
+        std::vector<Condition_ptr> vec;
+        for (auto i : all_queries)
+            vec.push_back(prepareForReachability(conditions[i]));
+        ReachabilitySearch strategy(*pn, handler, 0);
+        std::vector<Reachability::ResultPrinter::Result> results(vec.size(), Reachability::ResultPrinter::Unknown);
+        strategy.swarm(vec, results, Strategy::HEUR, true, false, false, 0, workers);
+        for (auto i : all_queries)
+            BOOST_REQUIRE_EQUAL(cardinality_results[i], results[i]);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01CTLCardinalityParallelCZero, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("CTLCardinality.xml");
+
+    // the workers must agree with the sequential algorithm for every strategy
+    for (auto strategy : {Strategy::DFS, Strategy::BFS, Strategy::RDFS}) {
+        for (auto i : all_queries) {
+            AsCTL v;
+            Visitor::visit(v, conditions[i]);
+            auto query = PetriEngine::PQL::pushNegation(v._ctl_query);
+            CTLResult sequential(conditions[i].get());
+            CTLResult parallel(conditions[i].get());
+            bool expected = CTLSingleSolve(query.get(), pn.get(), CTL::CZero, strategy, false, sequential, 1);
+            bool result = CTLSingleSolve(query.get(), pn.get(), CTL::CZero, strategy, false, parallel, 4);
+            BOOST_REQUIRE_EQUAL(expected, result);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(AngiogenesisPT01CTLFireabilitySubformulaCache, * utf::timeout(60)) {
+
+    auto [pn, conditions, qstrings] = load_angiogenesis("CTLFireability.xml");
+
+    // every query is solved twice, the second time mostly from the cache
+    PetriNets::SubformulaCache cache;
+    for (size_t round = 0; round < 2; ++round) {
+        for (auto i : all_queries) {
+            AsCTL v;
+            Visitor::visit(v, conditions[i]);
+            auto query = PetriEngine::PQL::pushNegation(v._ctl_query);
+            CTLResult plain(conditions[i].get());
+            CTLResult cached(conditions[i].get());
+            bool expected = CTLSingleSolve(query.get(), pn.get(), CTL::CZero, Strategy::DFS, false, plain);
+            bool result = CTLSingleSolve(query.get(), pn.get(), CTL::CZero, Strategy::DFS, false, cached, 1, &cache);
+            BOOST_REQUIRE_EQUAL(expected, result);
+        }
+    }
+    BOOST_REQUIRE(cache.size() > 0);
+}
@@ -0,0 +1,529 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_MODULE structures
+
+#include <boost/test/unit_test.hpp>
+#include <algorithm>
+#include <memory>
+#include <queue>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "utils/structures/light_bitset.h"
+#include "PetriEngine/PetriNetBuilder.h"
+#include "PetriEngine/Stubborn/ReachabilityStubbornSet.h"
+#include "PetriEngine/Structures/SmallVector.h"
+#include "PetriEngine/Structures/MarkingKernels.h"
+#include "PetriEngine/Structures/Queue.h"
+#include "PetriEngine/Structures/SegmentedStack.h"
+#include "PetriEngine/Structures/StateId.h"
+#include "PetriEngine/PQL/Expressions.h"
+#include "CTL/PetriNets/ConfigurationTable.h"
+#include "CTL/PetriNets/SubformulaCache.h"
+
+using namespace PetriEngine;
+using namespace PetriEngine::PQL;
+
+std::vector<size_t> set_bits(const light_bitset& set)
+{
+    std::vector<size_t> bits;
+    for(size_t i = set.next(0); i < set.size(); i = set.next(i + 1))
+        bits.push_back(i);
+    return bits;
+}
+
+BOOST_AUTO_TEST_CASE(LightBitsetSetAndClear) {
+    light_bitset set(200);
+    BOOST_REQUIRE_EQUAL(set.words(), 4);
+    BOOST_REQUIRE_EQUAL(set.next(0), 200);
+
+    set.set(0);
+    set[63] = true;
+    set.set(64);
+    set.set(199);
+    BOOST_REQUIRE(set[63] && set.test(64) && !set.test(65));
+    BOOST_REQUIRE(set_bits(set) == std::vector<size_t>({0, 63, 64, 199}));
+
+    set[63] = false;
+    BOOST_REQUIRE(!set.test(63));
+    BOOST_REQUIRE_EQUAL(set.next(1), 64);
+
+    // or_word reports the bits it set, not the ones already there
+    BOOST_REQUIRE_EQUAL(set.or_word(1, 0b11), 0b10);
+    BOOST_REQUIRE_EQUAL(set.or_word(1, 0b11), 0);
+
+    set.clear();
+    BOOST_REQUIRE_EQUAL(set.next(0), 200);
+    for(size_t w = 0; w < set.words(); ++w)
+        BOOST_REQUIRE_EQUAL(set.word(w), 0);
+}
+
+BOOST_AUTO_TEST_CASE(LightBitsetClearAfterManyWrites) {
+    light_bitset set(300);
+    // clearing words by reset and writing them again lists them again,
+    // past the number of words the whole set is cleared instead
+    for(int round = 0; round < 10; ++round)
+    {
+        for(size_t i = 0; i < set.size(); i += 64)
+        {
+            set.set(i);
+            set.reset(i);
+        }
+        set.set(5);
+    }
+    set.set(299);
+    set.clear();
+    BOOST_REQUIRE_EQUAL(set.next(0), 300);
+
+    // and the next clear is sparse again
+    set.set(130);
+    set.clear();
+    BOOST_REQUIRE_EQUAL(set.next(0), 300);
+}
+
+BOOST_AUTO_TEST_CASE(LightBitsetSetAll) {
+    light_bitset set(70);
+    set.set();
+    BOOST_REQUIRE_EQUAL(set_bits(set).size(), 70);
+    // no bit past the size
+    BOOST_REQUIRE_EQUAL(set.word(1), (light_bitset::word_t{1} << 6) - 1);
+    set.clear();
+    BOOST_REQUIRE_EQUAL(set.next(0), 70);
+
+    light_bitset other(70);
+    other.set(69);
+    BOOST_REQUIRE(!set.intersects(other));
+    set.swap(other);
+    BOOST_REQUIRE(set.test(69));
+    BOOST_REQUIRE(!other.test(69));
+    BOOST_REQUIRE(!set.intersects(other));
+}
+
+// exposes the stubborn set of a single place without a marking
+class PlaceStubbornSet : public ReachabilityStubbornSet {
+public:
+    using ReachabilityStubbornSet::ReachabilityStubbornSet;
+
+    std::set<std::string> stubbornNames() const
+    {
+        std::set<std::string> names;
+        for(size_t t = _stubborn.next(0); t < _stubborn.size(); t = _stubborn.next(t + 1))
+            names.insert(*_net.transitionNames()[t]);
+        return names;
+    }
+};
+
+BOOST_AUTO_TEST_CASE(StubbornSetPlaceMasks) {
+    // 200 transitions, four words of masks, in five kinds towards place p
+    shared_string_set sset;
+    PetriNetBuilder builder(sset);
+    builder.addPlace("p", 1, 0, 0);
+    std::set<std::string> producers, decreasing, inhibited;
+    for(int i = 0; i < 200; ++i)
+    {
+        auto name = "t" + std::to_string(i);
+        builder.addTransition(name, 0, 0, 0);
+        switch(i % 5)
+        {
+        case 0: // produces
+            builder.addOutputArc(name, "p", 1);
+            producers.insert(name);
+            break;
+        case 1: // consumes
+            builder.addInputArc("p", name, false, 1);
+            decreasing.insert(name);
+            break;
+        case 2: // tests
+            builder.addInputArc("p", name, false, 1);
+            builder.addOutputArc(name, "p", 1);
+            break;
+        case 3: // consumes and produces more
+            builder.addInputArc("p", name, false, 1);
+            builder.addOutputArc(name, "p", 2);
+            producers.insert(name);
+            break;
+        case 4:
+            builder.addInputArc("p", name, true, 1);
+            inhibited.insert(name);
+            break;
+        }
+    }
+    std::unique_ptr<PetriNet> net(builder.makePetriNet(false));
+    PlaceStubbornSet stubborn(*net);
+
+    for(int round = 0; round < 2; ++round)
+    {
+        stubborn.presetOf(0);
+        BOOST_REQUIRE(stubborn.stubbornNames() == producers);
+        // the place is seen, its preset is not added again
+        stubborn.presetOf(0);
+        BOOST_REQUIRE(stubborn.stubbornNames() == producers);
+        stubborn.reset();
+        BOOST_REQUIRE(stubborn.stubbornNames().empty());
+
+        stubborn.postsetOf(0);
+        BOOST_REQUIRE(stubborn.stubbornNames() == decreasing);
+        stubborn.reset();
+
+        stubborn.inhibitorPostsetOf(0);
+        BOOST_REQUIRE(stubborn.stubbornNames() == inhibited);
+        stubborn.postsetOf(0);
+        auto both = inhibited;
+        both.insert(decreasing.begin(), decreasing.end());
+        BOOST_REQUIRE(stubborn.stubbornNames() == both);
+        stubborn.reset();
+        BOOST_REQUIRE(stubborn.stubbornNames().empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(SmallVectorInlineAndHeap) {
+    Structures::SmallVector<uint32_t, 2> vec;
+    BOOST_REQUIRE(vec.empty());
+    vec.push_back(1);
+    vec.push_back(3);
+    // still inline, then moved to the heap
+    vec.insert(vec.begin() + 1, 2);
+    for(uint32_t i = 4; i <= 100; ++i)
+        vec.push_back(i);
+    BOOST_REQUIRE_EQUAL(vec.size(), 100);
+    for(uint32_t i = 0; i < vec.size(); ++i)
+        BOOST_REQUIRE_EQUAL(vec[i], i + 1);
+
+    vec.insert(vec.begin(), 0);
+    vec.insert(vec.end(), 101);
+    BOOST_REQUIRE_EQUAL(vec[0], 0);
+    BOOST_REQUIRE_EQUAL(vec[101], 101);
+
+    auto it = vec.erase(vec.begin() + 10, vec.begin() + 20);
+    BOOST_REQUIRE_EQUAL(*it, 20);
+    BOOST_REQUIRE_EQUAL(vec.size(), 92);
+    vec.erase(vec.begin(), vec.end());
+    BOOST_REQUIRE(vec.empty());
+
+    // a cleared vector is inline again
+    vec.clear();
+    vec.push_back(7);
+    vec.push_back(8);
+    BOOST_REQUIRE_EQUAL(vec.size(), 2);
+    BOOST_REQUIRE_EQUAL(vec[0], 7);
+    BOOST_REQUIRE_EQUAL(vec[1], 8);
+
+    std::vector<uint32_t> backwards;
+    for(auto e : vec.reversed())
+        backwards.push_back(e);
+    BOOST_REQUIRE(backwards == std::vector<uint32_t>({8, 7}));
+}
+
+BOOST_AUTO_TEST_CASE(SmallVectorOwnElements) {
+    // adding an element of the vector itself while it moves to a larger block
+    Structures::SmallVector<uint64_t, 1> vec;
+    vec.push_back(42);
+    vec.push_back(vec[0]);
+    BOOST_REQUIRE_EQUAL(vec.size(), 2);
+    BOOST_REQUIRE_EQUAL(vec[1], 42);
+    vec.push_back(vec[1] + 1);
+    vec.insert(vec.begin(), vec[2]);
+    BOOST_REQUIRE_EQUAL(vec.size(), 4);
+    BOOST_REQUIRE_EQUAL(vec[0], 43);
+    BOOST_REQUIRE_EQUAL(vec[3], 43);
+    // and shifting the element it inserts
+    vec.insert(vec.begin(), vec[1]);
+    BOOST_REQUIRE_EQUAL(vec[0], 42);
+    BOOST_REQUIRE_EQUAL(vec[1], 43);
+    BOOST_REQUIRE_EQUAL(vec[2], 42);
+}
+
+BOOST_AUTO_TEST_CASE(SmallVectorZeroedMemory) {
+    using vector_t = Structures::SmallVector<void*, 1>;
+    BOOST_REQUIRE_EQUAL(sizeof(vector_t), 16);
+    alignas(vector_t) unsigned char memory[sizeof(vector_t)] = {};
+    auto& vec = *reinterpret_cast<vector_t*>(memory);
+    BOOST_REQUIRE(vec.empty());
+    vec.push_back(memory);
+    vec.push_back(nullptr);
+    BOOST_REQUIRE_EQUAL(vec.size(), 2);
+    BOOST_REQUIRE(vec[0] == memory);
+    vec.clear();
+}
+
+BOOST_AUTO_TEST_CASE(MarkingKernelsAgainstScalar) {
+    using namespace Structures;
+    const auto selected = std::string(MarkingKernels::name());
+    std::mt19937 rng(7);
+    for(auto kernel : {"generic", "sse4.1", "avx2"})
+    {
+        // only those compiled in and supported by this CPU
+        if(!MarkingKernels::use(kernel))
+            continue;
+        BOOST_TEST_MESSAGE("kernel " << kernel);
+        // lengths around and between the vector widths, tokens 0, 1, 3 and 4
+        for(size_t places = 0; places <= 70; ++places)
+        {
+            for(int round = 0; round < 20; ++round)
+            {
+                const uint32_t tokens[] = {0, 1, 3, 4};
+                bool small = round % 2 == 0; // at most 3 tokens, for the two bit packing
+                std::vector<uint32_t> marking(places), bounds(places);
+                for(size_t i = 0; i < places; ++i)
+                {
+                    marking[i] = round % 5 == 1 ? 3 * (rng() % 2) : tokens[rng() % (small ? 3 : 4)];
+                    bounds[i] = rng() % 5;
+                }
+
+                MarkingKernels::stats_t ref;
+                std::vector<uint32_t> refBounds(places);
+                std::vector<unsigned char> refBits((places + 7) / 8, 0), refTwo((places + 3) / 4, 0);
+                for(size_t i = 0; i < places; ++i)
+                {
+                    refBounds[i] = std::max(bounds[i], marking[i]);
+                    if(marking[i] == 0) continue;
+                    ++ref.active;
+                    ref.sum += marking[i];
+                    ref.max = std::max(ref.max, marking[i]);
+                    ref.last = i;
+                    refBits[i / 8] |= 0x80 >> (i % 8);
+                }
+                // the least significant bit of the tokens first
+                for(size_t i = 0; small && i < places; ++i)
+                {
+                    if(marking[i] & 1) refTwo[i / 4] |= 0x80 >> (2 * (i % 4));
+                    if(marking[i] & 2) refTwo[i / 4] |= 0x40 >> (2 * (i % 4));
+                }
+                ref.allsame = std::all_of(marking.begin(), marking.end(),
+                                          [&](auto m) { return m == 0 || m == ref.max; });
+
+                auto s = MarkingKernels::stats(marking.data(), places);
+                BOOST_REQUIRE_EQUAL(s.sum, ref.sum);
+                BOOST_REQUIRE_EQUAL(s.active, ref.active);
+                BOOST_REQUIRE_EQUAL(s.max, ref.max);
+                BOOST_REQUIRE_EQUAL(s.last, ref.last);
+                BOOST_REQUIRE_EQUAL(s.allsame, ref.allsame);
+
+                MarkingKernels::updateBounds(bounds.data(), marking.data(), places);
+                BOOST_REQUIRE(bounds == refBounds);
+
+                std::vector<unsigned char> bits(refBits.size(), 0), two(refTwo.size(), 0);
+                MarkingKernels::packBits(bits.data(), marking.data(), places);
+                BOOST_REQUIRE(bits == refBits);
+                if(small)
+                {
+                    MarkingKernels::packTwoBits(two.data(), marking.data(), places);
+                    BOOST_REQUIRE(two == refTwo);
+                }
+            }
+        }
+    }
+    BOOST_REQUIRE(MarkingKernels::use(selected.c_str()));
+}
+
+BOOST_AUTO_TEST_CASE(SegmentedStackChunks) {
+    Structures::SegmentedStack<uint32_t, 4> stack;
+    BOOST_REQUIRE_EQUAL(stack.capacity(), 0);
+    for(uint32_t i = 0; i < 10; ++i)
+    {
+        stack.push(i);
+        BOOST_REQUIRE_EQUAL(stack.top(), i);
+    }
+    BOOST_REQUIRE_EQUAL(stack.size(), 10);
+    BOOST_REQUIRE_EQUAL(stack.capacity(), 12);
+    for(uint32_t i = 0; i < 10; ++i)
+        BOOST_REQUIRE_EQUAL(stack[i], i);
+
+    // chunks above the top are released, but for one spare
+    for(uint32_t i = 10; i-- > 4;)
+    {
+        BOOST_REQUIRE_EQUAL(stack.top(), i);
+        stack.pop();
+    }
+    BOOST_REQUIRE_EQUAL(stack.size(), 4);
+    BOOST_REQUIRE_EQUAL(stack.capacity(), 8);
+    // back and forth over the boundary reuses the spare
+    for(int round = 0; round < 3; ++round)
+    {
+        stack.push(4);
+        BOOST_REQUIRE_EQUAL(stack.capacity(), 8);
+        stack.pop();
+        BOOST_REQUIRE_EQUAL(stack.top(), 3);
+    }
+    while(!stack.empty())
+        stack.pop();
+    BOOST_REQUIRE_EQUAL(stack.capacity(), 4);
+    stack.push(7);
+    BOOST_REQUIRE_EQUAL(stack.top(), 7);
+    BOOST_REQUIRE_EQUAL(stack.capacity(), 4);
+}
+
+BOOST_AUTO_TEST_CASE(StateIdsAbove32Bits) {
+    using namespace Structures;
+    const uint64_t ids[] = {0, 1, (uint64_t{1} << 32) - 1, uint64_t{1} << 32,
+                            (uint64_t{1} << 32) + 12345, (uint64_t{1} << 40) - 1};
+
+    // both representations of VERIFYPN_PACKED_IDS, whichever this build uses
+    SegmentedStack<packed_id_t, 2> packed;
+    SegmentedStack<uint64_t, 2> plain;
+    static_assert(sizeof(packed_id_t) == 5);
+    for(auto id : ids)
+    {
+        packed.push(id);
+        plain.push(id);
+    }
+    for(size_t i = 0; i < std::size(ids); ++i)
+    {
+        BOOST_REQUIRE_EQUAL(uint64_t(packed[i]), ids[i]);
+        BOOST_REQUIRE_EQUAL(plain[i], ids[i]);
+    }
+    BOOST_REQUIRE_THROW(packed_id_t(uint64_t{1} << 40), base_error);
+    BOOST_REQUIRE_THROW(packed_uint_t<4>(uint64_t{1} << 32), base_error);
+
+    // and the one the waiting lists store
+    DFSQueue queue(0);
+    for(auto id : ids)
+        queue.push(id, nullptr, nullptr);
+    for(size_t i = std::size(ids); i-- > 0;)
+        BOOST_REQUIRE_EQUAL(queue.pop(), ids[i]);
+    BOOST_REQUIRE(queue.empty());
+}
+
+// pushes id with the given distance, the value of weight <= 0
+void push_weighted(Structures::HeuristicQueue& queue, size_t id, uint32_t weight)
+{
+    DistanceContext context(nullptr, nullptr);
+    LessThanOrEqualCondition query(std::make_shared<LiteralExpr>(weight), std::make_shared<LiteralExpr>(0));
+    queue.push(id, &context, &query);
+}
+
+BOOST_AUTO_TEST_CASE(HeuristicQueueEqualWeights) {
+    Structures::HeuristicQueue queue(0);
+    for(size_t id = 1; id <= 5; ++id)
+        push_weighted(queue, id, 3);
+    push_weighted(queue, 6, 2);
+    // as a depth-first search among equals, the latest first
+    BOOST_REQUIRE_EQUAL(queue.pop(), 6);
+    for(size_t id = 5; id >= 1; --id)
+        BOOST_REQUIRE_EQUAL(queue.pop(), id);
+    BOOST_REQUIRE(queue.empty());
+    BOOST_REQUIRE_EQUAL(queue.pop(), Structures::Queue::EMPTY);
+}
+
+BOOST_AUTO_TEST_CASE(HeuristicQueueOverflow) {
+    // weights from 2^16 up are kept in a heap next to the buckets
+    Structures::HeuristicQueue queue(0);
+    push_weighted(queue, 1, 70000);
+    push_weighted(queue, 2, 65536);
+    push_weighted(queue, 3, 65535);
+    push_weighted(queue, 4, 200000);
+    push_weighted(queue, 5, 70000);
+    push_weighted(queue, 6, 0);
+    for(size_t id : {6, 3, 2})
+        BOOST_REQUIRE_EQUAL(queue.pop(), id);
+    push_weighted(queue, 7, 100);
+    push_weighted(queue, 8, 70000);
+    for(size_t id : {7, 8, 5, 1, 4})
+        BOOST_REQUIRE_EQUAL(queue.pop(), id);
+    BOOST_REQUIRE(queue.empty());
+
+    // against a heap of all weights, pushes and pops interleaved
+    std::mt19937 rng(5);
+    std::priority_queue<Structures::HeuristicQueue::weighted_t> reference;
+    for(size_t id = 0; id < 20000; ++id)
+    {
+        if(rng() % 3 != 0)
+        {
+            uint32_t weight = rng() % 2 == 0 ? rng() % 100 : 65000 + rng() % 2000;
+            push_weighted(queue, id, weight);
+            reference.emplace(weight, id);
+        }
+        else if(!reference.empty())
+        {
+            BOOST_REQUIRE_EQUAL(queue.pop(), reference.top().item);
+            reference.pop();
+        }
+    }
+    for(; !reference.empty(); reference.pop())
+        BOOST_REQUIRE_EQUAL(queue.pop(), reference.top().item);
+    BOOST_REQUIRE(queue.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ConfigurationTableProbingAndGrowth) {
+    // only the addresses of the subformulas are used
+    std::vector<char> formulas(3);
+    auto query = [&](size_t i) {
+        return reinterpret_cast<Condition*>(&formulas[i]);
+    };
+
+    PetriNets::ConfigurationTable table;
+    std::vector<std::unique_ptr<PetriNets::PetriConfig>> configs;
+    // past the initial 64 slots, with equal markings and equal subformulas
+    for(uint32_t m = 0; m < 500; ++m)
+    {
+        for(size_t q = 0; q < formulas.size(); ++q)
+        {
+            BOOST_REQUIRE(table.find(m, query(q)) == nullptr);
+            configs.emplace_back(std::make_unique<PetriNets::PetriConfig>(m, query(q)));
+            table.insert(configs.back().get());
+        }
+    }
+    BOOST_REQUIRE_EQUAL(table.size(), configs.size());
+    for(auto& c : configs)
+        BOOST_REQUIRE(table.find(c->marking, c->query) == c.get());
+    BOOST_REQUIRE(table.find(500, query(0)) == nullptr);
+
+    size_t visited = 0;
+    table.foreach([&](PetriNets::PetriConfig*) { ++visited; });
+    BOOST_REQUIRE_EQUAL(visited, configs.size());
+}
+
+BOOST_AUTO_TEST_CASE(SubformulaCacheFormulas) {
+    auto ex = std::make_shared<EXCondition>(BooleanCondition::TRUE_CONSTANT);
+    auto af = std::make_shared<AFCondition>(BooleanCondition::TRUE_CONSTANT);
+    auto ex2 = std::make_shared<EXCondition>(BooleanCondition::TRUE_CONSTANT);
+
+    PetriNets::SubformulaCache cache;
+    auto id = cache.formula(ex.get());
+    BOOST_REQUIRE_EQUAL(cache.formula(ex2.get()), id);
+    BOOST_REQUIRE_NE(cache.formula(af.get()), id);
+}
+
+BOOST_AUTO_TEST_CASE(SubformulaCacheLookupAndCapacity) {
+    using namespace DependencyGraph;
+    // the encoded markings, with room for the formula
+    unsigned char a[8] = {1, 2, 3, 4};
+    unsigned char b[8] = {1, 2, 3, 5};
+    unsigned char c[8] = {1, 2, 3};
+
+    PetriNets::SubformulaCache cache(3);
+    BOOST_REQUIRE_EQUAL(cache.lookup(a, 4, 0), UNKNOWN);
+    cache.store(a, 4, 0, true);
+    cache.store(a, 4, 1, false);
+    BOOST_REQUIRE_EQUAL(cache.lookup(a, 4, 0), ONE);
+    BOOST_REQUIRE_EQUAL(cache.lookup(a, 4, 1), CZERO);
+    BOOST_REQUIRE_EQUAL(cache.lookup(b, 4, 0), UNKNOWN);
+    // a prefix of a cached marking is another marking
+    BOOST_REQUIRE_EQUAL(cache.lookup(c, 3, 0), UNKNOWN);
+
+    // storing again is not counted
+    cache.store(a, 4, 0, true);
+    BOOST_REQUIRE_EQUAL(cache.size(), 2);
+
+    cache.store(b, 4, 0, true);
+    cache.store(b, 4, 1, true);
+    BOOST_REQUIRE_EQUAL(cache.size(), 3);
+    BOOST_REQUIRE_EQUAL(cache.lookup(b, 4, 0), ONE);
+    BOOST_REQUIRE_EQUAL(cache.lookup(b, 4, 1), UNKNOWN);
+}
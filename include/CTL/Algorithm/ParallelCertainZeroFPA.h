@@ -0,0 +1,85 @@
+#ifndef PARALLELCERTAINZEROFPA_H
+#define PARALLELCERTAINZEROFPA_H
+
+#include "FixedPointAlgorithm.h"
+#include "CTL/DependencyGraph/Edge.h"
+#include "CTL/DependencyGraph/Configuration.h"
+#include "PetriEngine/Structures/linked_bucket.h"
+
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <vector>
+
+namespace Algorithm {
+
+/**
+ * The certain-zero algorithm run by several workers on one dependency graph,
+ * which must allow as many workers to compute successors concurrently.
+ *
+ * Assignments only increase and are updated by compare-and-swap, so a
+ * configuration is explored by the worker moving it from UNKNOWN to ZERO and
+ * assigned ONE or CZERO exactly once. An edge waiting for a target is pushed
+ * onto a lock-free list in the target, which is closed when the target is
+ * assigned; a worker finding the list closed rechecks the edge itself.
+ *
+ * Every worker has its own waiting list and steals from the others when it
+ * runs dry. Negation edges are postponed as in CertainZeroFPA, and released
+ * by the first worker noticing that no edges are pending anywhere.
+ */
+class ParallelCertainZeroFPA : public FixedPointAlgorithm
+{
+public:
+    ParallelCertainZeroFPA(Strategy type, uint32_t workers);
+    virtual ~ParallelCertainZeroFPA()
+    {
+    }
+    virtual bool search(DependencyGraph::BasicDependencyGraph &t_graph) override;
+protected:
+    struct worker_t {
+        worker_t(uint32_t index) : index(index), rng(index) {}
+        uint32_t index;
+        std::mutex lock;
+        std::deque<DependencyGraph::Edge*> waiting;
+        std::deque<DependencyGraph::Edge*> dependencies;
+        std::default_random_engine rng;
+        size_t processedEdges = 0;
+        size_t processedNegationEdges = 0;
+        size_t exploredConfigurations = 0;
+        size_t numberOfEdges = 0;
+    };
+
+    DependencyGraph::BasicDependencyGraph *graph;
+    DependencyGraph::Configuration* vertex;
+
+    void run(worker_t& w);
+    void checkEdge(worker_t& w, DependencyGraph::Edge* e, bool only_assign = false);
+    void fail(worker_t& w, DependencyGraph::Edge* e);
+    void finalAssign(worker_t& w, DependencyGraph::Configuration *c, DependencyGraph::Assignment a);
+    bool claim(worker_t& w, DependencyGraph::Configuration *c);
+    void explore(worker_t& w, DependencyGraph::Configuration *c);
+    void addDependency(worker_t& w, DependencyGraph::Edge* e, DependencyGraph::Configuration *target);
+    void push(worker_t& w, DependencyGraph::Edge* e, bool dependency);
+    DependencyGraph::Edge* pop(worker_t& w);
+    bool releaseNegations();
+
+private:
+    Strategy _type;
+    uint32_t _nworkers;
+    std::vector<std::unique_ptr<worker_t>> _workers;
+    std::unique_ptr<linked_bucket_t<DependencyGraph::Dependent, 1024*64>> _dependents;
+
+    // the edges pushed but not yet checked, zero when the workers are done
+    std::atomic<size_t> _pending = 0;
+    std::atomic<bool> _stop = false;
+    std::exception_ptr _error;
+
+    // guards the postponed negation edges
+    std::mutex _negation_lock;
+    std::vector<DependencyGraph::Edge*> _negations;
+};
+}
+#endif // PARALLELCERTAINZEROFPA_H
@@ -12,9 +12,14 @@
 
 #include <set>
 
+namespace PetriNets {
+    class SubformulaCache;
+}
+
 bool CTLSingleSolve(PetriEngine::PQL::Condition* query, PetriEngine::PetriNet* net,
                     CTL::CTLAlgorithmType algorithmtype,
-                    Strategy strategytype, bool partial_order, CTLResult& result);
+                    Strategy strategytype, bool partial_order, CTLResult& result, uint32_t workers = 1,
+                    PetriNets::SubformulaCache* cache = nullptr);
 
 ReturnValue CTLMain(PetriEngine::PetriNet* net,
                     CTL::CTLAlgorithmType algorithmtype,
@@ -27,13 +27,6 @@ struct CTLResult {
     size_t exploredConfigurations = 0;
     size_t numberOfEdges = 0;
     size_t maxTokens = 0;
-#ifdef VERIFYPNDIST
-    size_t numberOfRoundsComputingDistance = 0;
-    size_t numberOfTokensReceived = 0;
-    size_t numberOfRequestsReceived = 0;
-    size_t numberOfAnswersReceived = 0;
-    size_t numberOfMessagesSend = 0;
-#endif
     void print(const std::string& qname, bool statisticslevel, size_t index, options_t& options, std::ostream& out) const;
 };
 
@@ -13,10 +13,22 @@ class Edge;
 class BasicDependencyGraph {
 
 public:
-    virtual std::vector<Edge*> successors(Configuration *c) =0;
+    /**
+     * The out-going edges of c, in a buffer owned by the graph which the
+     * next call to successors for the same worker overwrites.
+     */
+    virtual std::vector<Edge*>& successors(Configuration *c) =0;
     virtual Configuration *initialConfiguration() =0;
     virtual void release(Edge* e) = 0;
     virtual void cleanUp() =0;
+
+    /**
+     * The number of workers which may use the graph concurrently, each
+     * passing its own index below this to the overloads taking a worker.
+     */
+    virtual uint32_t workers() const { return 1; }
+    virtual std::vector<Edge*>& successors(Configuration *c, uint32_t worker) { return successors(c); }
+    virtual void release(Edge* e, uint32_t worker) { release(e); }
 };
 
 }
@@ -3,33 +3,57 @@
 
 #include "Edge.h"
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <cstdio>
 #include <iostream>
 #include <vector>
-#include <forward_list>
 
 namespace DependencyGraph {
 
 class Edge;
 
+/** A node of the dependencies shared between concurrent workers */
+struct Dependent {
+    Edge* edge;
+    Dependent* next;
+};
+
 class Configuration
 {
 public:
-    std::forward_list<Edge*> dependency_set;   
-    uint32_t nsuccs = 0;
+    // the dependencies of the sequential algorithms, sorted by address
+    PetriEngine::Structures::SmallVector<Edge*, 1> dependency_set;
+private:
+    std::atomic<Dependent*> dependents = nullptr;
+public:
+    std::atomic<uint32_t> nsuccs = 0;
 private:
-    uint32_t distance = 0;
+    std::atomic<uint32_t> distance = 0;
+    uint16_t owner = 0;
     void setDistance(uint32_t value) { distance = value; }
 public:
-    int8_t assignment = UNKNOWN;
+    std::atomic<int8_t> assignment = UNKNOWN;
     Configuration() {}
     uint32_t getDistance() const { return distance; }
     bool isDone() const { return assignment == ONE || assignment == CZERO; }
     void addDependency(Edge* e);
-    void setOwner(uint32_t) { }
-    uint32_t getOwner() { return 0; }
-    
+    void setOwner(uint32_t worker) { assert(worker <= UINT16_MAX); owner = worker; }
+    uint32_t getOwner() const { return owner; }
+
+    /** Raises the distance to at least value, safe under concurrent updates */
+    void raiseDistance(uint32_t value);
+
+    /**
+     * Adds d to the dependencies shared between concurrent workers. This
+     * fails once the list has been closed by the assignment of the
+     * configuration, in which case the caller must recheck the edge itself.
+     */
+    bool addDependent(Dependent* d);
+
+    /** Closes the shared dependencies, returning those added until now */
+    Dependent* closeDependents();
 };
 
 
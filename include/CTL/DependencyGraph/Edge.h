@@ -5,8 +5,10 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
-#include <forward_list>
+
+#include "PetriEngine/Structures/SmallVector.h"
 
 namespace DependencyGraph {
 
@@ -16,7 +18,8 @@ enum Assignment {
 };
 
 class Edge {
-    typedef std::forward_list<Configuration*> container;
+    // most edges have one or two targets, which are then stored inline
+    typedef PetriEngine::Structures::SmallVector<Configuration*, 2> container;
 public:
     Edge(){}
     Edge(Configuration &t_source) : source(&t_source) {}
@@ -30,16 +33,18 @@ public:
             handled = true;
             targets.clear();
         }
-        else targets.push_front(conf);
+        // appended in O(1); the latest target is considered first (see reversed()),
+        // e.g. the left side of an until before the successors
+        else targets.push_back(conf);
         return handled;
     }
 
     container targets;
     Configuration* source;
     uint8_t status = 0;
-    bool processed = false;
+    std::atomic<bool> processed = false;
     bool is_negated = false;
-    bool handled = false;
+    std::atomic<bool> handled = false;
     int32_t refcnt = 0;
     /*size_t children;
     Assignment assignment;*/
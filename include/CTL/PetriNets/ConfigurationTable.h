@@ -0,0 +1,97 @@
+#ifndef CONFIGURATIONTABLE_H
+#define CONFIGURATIONTABLE_H
+
+#include "PetriConfig.h"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace PetriNets {
+
+/**
+ * The configurations of a dependency graph indexed by their marking and
+ * subformula, in an open-addressing table with linear probing.
+ *
+ * Only pointers are stored, as a configuration holds its own key. The table
+ * does not own the configurations.
+ */
+class ConfigurationTable {
+public:
+    using Condition = PetriEngine::PQL::Condition;
+
+    ConfigurationTable() : _slots(64, nullptr) {}
+
+    PetriConfig* find(uint32_t marking, const Condition* query) const
+    {
+        for(size_t i = slot(marking, query);; i = (i + 1) & mask())
+        {
+            auto c = _slots[i];
+            if(c == nullptr || (c->marking == marking && c->query == query))
+                return c;
+        }
+    }
+
+    /** Adds a configuration whose key is not in the table */
+    void insert(PetriConfig* config)
+    {
+        assert(find(config->marking, config->query) == nullptr);
+        // at most three quarters full keeps the probe sequences short
+        if((_size + 1) * 4 > _slots.size() * 3)
+            grow();
+        place(config);
+        ++_size;
+    }
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+    template<typename F>
+    void foreach(F&& fn) const
+    {
+        for(auto c : _slots)
+            if(c != nullptr)
+                fn(c);
+    }
+
+private:
+    size_t mask() const
+    {
+        return _slots.size() - 1;
+    }
+
+    size_t slot(uint32_t marking, const Condition* query) const
+    {
+        // the finalizer of splitmix64, spreading nearby ids and addresses
+        uint64_t h = (uint64_t{marking} << 32) ^ reinterpret_cast<uintptr_t>(query);
+        h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+        h ^= h >> 31;
+        return h & mask();
+    }
+
+    void place(PetriConfig* config)
+    {
+        auto i = slot(config->marking, config->query);
+        while(_slots[i] != nullptr)
+            i = (i + 1) & mask();
+        _slots[i] = config;
+    }
+
+    void grow()
+    {
+        std::vector<PetriConfig*> old(_slots.size() * 2, nullptr);
+        old.swap(_slots);
+        for(auto c : old)
+            if(c != nullptr)
+                place(c);
+    }
+
+    std::vector<PetriConfig*> _slots;
+    size_t _size = 0;
+};
+
+}
+#endif // CONFIGURATIONTABLE_H
@@ -1,16 +1,23 @@
 #ifndef ONTHEFLYDG_H
 #define ONTHEFLYDG_H
 
-#include <functional>
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <stack>
-#include <ptrie/ptrie_map.h>
+#include <unordered_map>
+#include <ptrie/ptrie_stable.h>
 
 #include "CTL/DependencyGraph/BasicDependencyGraph.h"
 #include "CTL/DependencyGraph/Configuration.h"
 #include "CTL/DependencyGraph/Edge.h"
 #include "PetriConfig.h"
+#include "ConfigurationTable.h"
+#include "SubformulaCache.h"
 #include "PetriParse/PNMLParser.h"
 #include "PetriEngine/PQL/PQL.h"
+#include "PetriEngine/PQL/Bytecode.h"
+#include "PetriEngine/PQL/Contexts.h"
 #include "PetriEngine/Structures/AlignedEncoder.h"
 #include "PetriEngine/Structures/linked_bucket.h"
 #include "PetriEngine/ReducingSuccessorGenerator.h"
@@ -22,17 +29,32 @@ public:
     using Condition = PetriEngine::PQL::Condition;
     using Condition_ptr = PetriEngine::PQL::Condition_ptr;
     using Marking = PetriEngine::Structures::State;
-    OnTheFlyDG(PetriEngine::PetriNet *t_net, bool partial_order);
+    OnTheFlyDG(PetriEngine::PetriNet *t_net, bool partial_order, uint32_t workers = 1, SubformulaCache* cache = nullptr);
 
     virtual ~OnTheFlyDG();
 
     //Dependency graph interface
-    virtual std::vector<DependencyGraph::Edge*> successors(DependencyGraph::Configuration *c) override;
+    virtual std::vector<DependencyGraph::Edge*>& successors(DependencyGraph::Configuration *c) override
+    {
+        return successors(c, 0);
+    }
+    virtual std::vector<DependencyGraph::Edge*>& successors(DependencyGraph::Configuration *c, uint32_t worker) override;
     virtual DependencyGraph::Configuration *initialConfiguration() override;
     virtual void cleanUp() override;
     void setQuery(Condition* query);
 
-    virtual void release(DependencyGraph::Edge* e) override;
+    /** Stores the decided configurations in the cache given at construction */
+    void cacheResults();
+
+    virtual void release(DependencyGraph::Edge* e) override
+    {
+        release(e, 0);
+    }
+    virtual void release(DependencyGraph::Edge* e, uint32_t worker) override;
+    virtual uint32_t workers() const override
+    {
+        return _workers.size();
+    }
 
     size_t owner(Marking& marking, Condition* cond);
     size_t owner(Marking& marking, const Condition_ptr& cond)
@@ -49,65 +71,103 @@ public:
 
 protected:
 
+    // the state of a worker, which computes successors without holding any lock
+    struct worker_t {
+        worker_t(PetriEngine::PetriNet *net, uint32_t index, std::mutex* query_lock);
+        uint32_t index;
+        AlignedEncoder encoder;
+        Marking working_marking;
+        Marking query_marking;
+        PetriEngine::PQL::DistanceContext context;
+        PetriEngine::SuccessorGenerator gen;
+        PetriEngine::ReducingSuccessorGenerator redgen;
+        // the edges returned by the last call to successors
+        std::vector<DependencyGraph::Edge*> succs;
+        std::stack<DependencyGraph::Edge*> recycle;
+        // an encoded marking followed by a subformula of the cache
+        std::vector<unsigned char> cache_key;
+        // the compiled subformulas of the query, nullptr for those which cannot be compiled
+        std::unordered_map<const Condition*, std::unique_ptr<PetriEngine::PQL::Bytecode>> programs;
+    };
+
+    // the markings are hash-partitioned, a marking is identified by its id
+    // within the shard shifted past the shard-bits, with the shard in the low bits.
+    // The configurations of a marking are kept in the shard of the marking.
+    struct shard_t {
+        std::mutex lock;
+        ptrie::set_stable<ptrie::uchar, size_t, 17, 128, 4> trie;
+        ConfigurationTable configurations;
+        size_t maxTokens = 0;
+    };
+
     //initialized from constructor
-    AlignedEncoder encoder;
     PetriEngine::PetriNet *net = nullptr;
     PetriConfig* initial_config;
-    Marking working_marking;
-    Marking query_marking;
     uint32_t n_transitions = 0;
     uint32_t n_places = 0;
-    size_t _markingCount = 0;
-    size_t _maxTokens = 0;
-    size_t _configurationCount = 0;
+    std::atomic<size_t> _markingCount = 0;
+    std::atomic<size_t> _configurationCount = 0;
     //used after query is set
     Condition* query = nullptr;
 
-    Condition::Result fastEval(Condition* query, Marking* unfolded);
-    Condition::Result fastEval(const Condition_ptr& query, Marking* unfolded)
+    Condition::Result fastEval(worker_t& w, Condition* query, Marking* unfolded);
+    Condition::Result fastEval(worker_t& w, const Condition_ptr& query, Marking* unfolded)
     {
-        return fastEval(query.get(), unfolded);
+        return fastEval(w, query.get(), unfolded);
     }
-    void nextStates(Marking& t_marking, Condition*,
-    std::function<void ()> pre,
-    std::function<bool (Marking&)> foreach,
-    std::function<void ()> post);
-    template<typename T>
-    void dowork(T& gen, bool& first,
-    std::function<void ()>& pre,
-    std::function<bool (Marking&)>& foreach)
+    template<typename Pre, typename Foreach, typename Post>
+    void nextStates(worker_t& w, Marking& t_marking, Condition*,
+    Pre&& pre,
+    Foreach&& foreach,
+    Post&& post);
+    template<typename T, typename Pre, typename Foreach>
+    void dowork(worker_t& w, T& gen, bool& first,
+    Pre& pre,
+    Foreach& foreach)
     {
-        gen.prepare(&query_marking);
+        gen.prepare(&w.query_marking);
 
-        while(gen.next(working_marking)){
+        while(gen.next(w.working_marking)){
             if(first) pre();
             first = false;
-            if(!foreach(working_marking))
+            if(!foreach(w.working_marking))
             {
                 gen.reset();
                 break;
             }
         }
     }
-    PetriConfig *createConfiguration(size_t marking, size_t own, Condition* query);
-    PetriConfig *createConfiguration(size_t marking, size_t own, const Condition_ptr& query)
+    PetriConfig *createConfiguration(worker_t& w, uint32_t marking, size_t own, Condition* query);
+    PetriConfig *createConfiguration(worker_t& w, uint32_t marking, size_t own, const Condition_ptr& query)
     {
-        return createConfiguration(marking, own, query.get());
+        return createConfiguration(w, marking, own, query.get());
     }
-    size_t createMarking(Marking &marking);
+    uint32_t createMarking(worker_t& w, Marking &marking);
     void markingStats(const uint32_t* marking, size_t& sum, bool& allsame, uint32_t& val, uint32_t& active, uint32_t& last);
 
-    DependencyGraph::Edge* newEdge(DependencyGraph::Configuration &t_source, uint32_t weight);
+    DependencyGraph::Edge* newEdge(worker_t& w, DependencyGraph::Configuration &t_source, uint32_t weight);
+
+    void numberFormulas(Condition* query);
+    uint32_t shardOf(const unsigned char* data, size_t length) const;
+    shard_t& shard(uint32_t marking)
+    {
+        return *_shards[marking & ((1u << _shardBits) - 1)];
+    }
 
-    std::stack<DependencyGraph::Edge*> recycle;
-    ptrie::map<ptrie::uchar, std::vector<PetriConfig*> > trie;
+    std::vector<std::unique_ptr<worker_t>> _workers;
+    std::vector<std::unique_ptr<shard_t>> _shards;
+    uint32_t _shardBits = 0;
     linked_bucket_t<DependencyGraph::Edge,1024*10>* edge_alloc = nullptr;
 
     // Problem  with linked bucket and complex constructor
     linked_bucket_t<char[sizeof(PetriConfig)], 1024*1024>* conf_alloc = nullptr;
 
-    PetriEngine::ReducingSuccessorGenerator _redgen;
     bool _partial_order = false;
+    SubformulaCache* _cache = nullptr;
+    // the ids in the cache of the temporal subformulas of the query
+    std::unordered_map<const Condition*, uint32_t> _formulas;
+    // serializes the evaluation of the query by the stubborn sets of concurrent workers
+    std::mutex _query_lock;
 
 };
 
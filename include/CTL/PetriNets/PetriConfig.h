@@ -16,11 +16,12 @@ public:
         DependencyGraph::Configuration(), marking(0), query(NULL) 
     {}
     
-    PetriConfig(size_t t_marking, Condition *t_query) :
+    PetriConfig(uint32_t t_marking, Condition *t_query) :
         DependencyGraph::Configuration(), marking(t_marking), query(t_query) {
     }
 
-    size_t marking;
+    // 32-bit so it packs into the padding of the configuration
+    uint32_t marking;
     Condition *query;
 
 };
@@ -0,0 +1,57 @@
+#ifndef SUBFORMULACACHE_H
+#define SUBFORMULACACHE_H
+
+#include "CTL/DependencyGraph/Edge.h"
+#include "PetriEngine/PQL/PQL.h"
+
+#include <ptrie/ptrie.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+namespace PetriNets {
+
+/**
+ * The decided assignments of configurations, kept between the dependency
+ * graphs of the queries on one net. A configuration is identified by its
+ * encoded marking and its subformula, where subformulas printed the same are
+ * the same, so the graph of a later query starts with the configurations
+ * shared with earlier queries already assigned ONE or CZERO.
+ *
+ * Lookups may run concurrently, stores must not overlap a search.
+ */
+class SubformulaCache {
+public:
+    using Condition = PetriEngine::PQL::Condition;
+
+    /** A cache of at most capacity assignments */
+    explicit SubformulaCache(size_t capacity = 1 << 22) : _capacity(capacity) {}
+
+    /** The id of the subformula, equal for all subformulas printed the same */
+    uint32_t formula(const Condition* condition);
+
+    /**
+     * The assignment of the subformula in the encoded marking, UNKNOWN if it
+     * is not cached. The marking must have room for four more bytes.
+     */
+    DependencyGraph::Assignment lookup(unsigned char* marking, size_t length, uint32_t formula) const;
+
+    /** As lookup, storing that the subformula is satisfied or not */
+    void store(unsigned char* marking, size_t length, uint32_t formula, bool satisfied);
+
+    size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    size_t _capacity;
+    size_t _size = 0;
+    std::unordered_map<std::string, uint32_t> _formulas;
+    ptrie::set<ptrie::uchar> _satisfied;
+    ptrie::set<ptrie::uchar> _unsatisfied;
+};
+
+}
+#endif // SUBFORMULACACHE_H
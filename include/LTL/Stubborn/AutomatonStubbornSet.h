@@ -36,6 +36,7 @@ namespace LTL {
             _place_checkpoint(new bool[net.numberOfPlaces()]),
             _gen(_net)
         {
+            _orMasks = false;
             _markbuf.setMarking(net.makeInitialMarking());
             _retarding_stubborn_set.setInterestingVisitor<PetriEngine::AutomatonInterestingTransitionVisitor>();
         }
@@ -52,11 +53,8 @@ namespace LTL {
 
 
     private:
-        static bool has_shared_mark(const bool* a, const bool* b, size_t size) {
-            for (size_t i = 0; i < size; ++i) {
-                if (a[i] && b[i]) return true;
-            }
-            return false;
+        static bool has_shared_mark(const light_bitset& a, const light_bitset& b) {
+            return a.intersects(b);
         }
 
     protected:
@@ -28,7 +28,9 @@ namespace LTL {
     public:
         SafeAutStubbornSet(const PetriEngine::PetriNet &net,
                            const std::vector<PetriEngine::PQL::Condition_ptr> &queries)
-                : StubbornSet(net, queries), _unsafe(std::make_unique<bool[]>(net.numberOfTransitions())) {}
+                : StubbornSet(net, queries), _unsafe(net.numberOfTransitions()) {
+            _orMasks = false;
+        }
 
         bool prepare(const PetriEngine::Structures::State *marking) override
         {
@@ -45,7 +47,7 @@ namespace LTL {
 
         void reset() override {
             StubbornSet::reset();
-            memset(_unsafe.get(), false, sizeof(bool) * _net.numberOfTransitions());
+            _unsafe.clear();
             _bad = false;
             _has_enabled_stubborn = false;
         }
@@ -73,7 +75,7 @@ namespace LTL {
         }
 
     private:
-        std::unique_ptr<bool[]> _unsafe;
+        light_bitset _unsafe;
         bool _bad = false;
         bool _has_enabled_stubborn = false;
         PetriEngine::PQL::Condition_ptr _ret_cond;
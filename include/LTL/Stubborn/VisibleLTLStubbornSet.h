@@ -37,6 +37,7 @@ namespace LTL {
                 : StubbornSet(net, queries), _visible(new bool[net.numberOfTransitions()])
         {
             assert(!_netContainsInhibitorArcs);
+            _orMasks = false;
             memset(_visible.get(), 0, sizeof(bool) * net.numberOfPlaces());
             VisibleTransitionVisitor visible{_visible};
             for (auto &q : queries) {
@@ -48,6 +49,7 @@ namespace LTL {
                 : StubbornSet(net, query), _visible(new bool[net.numberOfTransitions()])
         {
             assert(!_netContainsInhibitorArcs);
+            _orMasks = false;
             auto places = std::make_unique<bool[]>(net.numberOfPlaces());
             memset(places.get(), 0, sizeof(bool) * net.numberOfPlaces());
             memset(_visible.get(), 0, sizeof(bool) * net.numberOfTransitions());
@@ -65,7 +67,7 @@ namespace LTL {
         void visTrans(uint32_t place)
         {
             if (_places_seen[place] > 0) return;
-            _places_seen[place] = 1;
+            markSeen(place, 1);
             for (uint32_t t = _places[place].pre; t < _places[place].post; ++t) {
                 const auto& tr = _arcs[t];
                 _visible[tr.index] = true;
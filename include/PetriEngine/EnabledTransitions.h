@@ -0,0 +1,136 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ENABLEDTRANSITIONS_H
+#define ENABLEDTRANSITIONS_H
+
+#include "PetriNet.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace PetriEngine {
+
+    /**
+     * Incremental computation of the enabled transitions of a marking.
+     *
+     * The enabled transitions are kept as a bitvector of words() words.
+     * Firing t only changes the marking of the places where t has a
+     * non-zero token delta, so the enabled set of a successor is the set of
+     * its parent where only the transitions guarded by those places (via a
+     * preset or an inhibitor arc) are re-checked.
+     *
+     * The sets of markings waiting for expansion can be stored by id, within
+     * a budget of bytes. The budget covers the sets as well as the index
+     * from ids to sets, an open-addressed table kept at most 3/4 full.
+     * Markings whose set was not stored (the budget was exhausted) are
+     * computed from scratch on expansion instead.
+     */
+    class EnabledTransitions {
+    public:
+        using word_t = uint64_t;
+        static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+        /**
+         * @param budget the maximal number of bytes used for stored sets and
+         * their index, 0 disables storing.
+         */
+        EnabledTransitions(const PetriNet& net, size_t budget = 0);
+
+        size_t words() const {
+            return _words;
+        }
+
+        /** Computes the enabled transitions of marking from scratch */
+        void compute(const MarkVal* marking, word_t* enabled) const;
+
+        /**
+         * Turns the enabled transitions of the parent into those of the
+         * successor marking, obtained by firing transition fired.
+         */
+        void update(const MarkVal* marking, uint32_t fired, word_t* enabled) const;
+
+        bool enabled(uint32_t t, const MarkVal* marking) const;
+
+        static bool isSet(const word_t* enabled, uint32_t t) {
+            return (enabled[t / 64] >> (t % 64)) & 1;
+        }
+
+        /** The first set transition in [t, ntransitions), NONE if there is none */
+        static uint32_t next(const word_t* enabled, uint32_t t, uint32_t ntransitions) {
+            for (; t < ntransitions; ++t) {
+                word_t word = enabled[t / 64] >> (t % 64);
+                if (word == 0) {
+                    t |= 63;
+                    continue;
+                }
+                t += __builtin_ctzll(word);
+                return t < ntransitions ? t : NONE;
+            }
+            return NONE;
+        }
+
+        /**
+         * Stores the enabled transitions of the marking with the given id.
+         * @return false if the budget is exhausted.
+         */
+        bool store(size_t id, const word_t* enabled);
+
+        /**
+         * Retrieves and releases the set stored for id.
+         * @return false if nothing was stored for id.
+         */
+        bool load(size_t id, word_t* enabled);
+
+        /** Releases all stored sets */
+        void clear();
+
+        size_t stored() const {
+            return _stored;
+        }
+
+    private:
+        struct bucket_t {
+            size_t id;
+            uint32_t slot;
+        };
+        static constexpr size_t EMPTY = std::numeric_limits<size_t>::max();
+
+        size_t home(size_t id) const;
+        size_t find(size_t id) const;
+        void grow();
+
+        const PetriNet& _net;
+        size_t _words;
+
+        // the transitions to re-check after firing a transition, stored
+        // in _affected[_affectedPtrs[t] .. _affectedPtrs[t+1]], sorted
+        std::vector<uint32_t> _affected;
+        std::vector<size_t> _affectedPtrs;
+        // transitions affecting most of the net are recomputed from scratch
+        std::vector<bool> _recompute;
+
+        size_t _capacity = 0;
+        std::vector<word_t> _pool;
+        std::vector<uint32_t> _free;
+        // id -> slot in _pool, linear probing over a power of two buckets
+        std::vector<bucket_t> _buckets;
+        size_t _maxBuckets = 0;
+        size_t _stored = 0;
+    };
+}
+
+#endif // ENABLEDTRANSITIONS_H
@@ -0,0 +1,111 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef ATOMICCACHE_H
+#define ATOMICCACHE_H
+
+#include "PQL.h"
+#include "Bytecode.h"
+#include "../PetriNet.h"
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace PetriEngine {
+    namespace PQL {
+
+        /**
+         * Memoized values of the atomic propositions of a set of queries.
+         *
+         * The distinct comparisons of the queries (equal when printed the
+         * same) are evaluated once per marking into a bitvector, which the
+         * evaluation visitors read rather than evaluating the comparisons of
+         * every query again. Firing t only changes the places where t has a
+         * non-zero token delta, so the propositions of a successor are those
+         * of its parent where only the propositions over such places are
+         * re-evaluated.
+         *
+         * Comparisons below a PathSelectCondition are not cached.
+         */
+        class AtomicCache {
+        public:
+            AtomicCache(const PetriNet& net, const std::vector<Condition_ptr>& queries);
+
+            /** The number of distinct propositions */
+            size_t size() const {
+                return _atoms.size();
+            }
+
+            /** Evaluates all propositions in marking, the parent of the following successors */
+            void evaluate(const MarkVal* marking);
+
+            /**
+             * Derives the propositions of the successor marking of the last
+             * evaluated marking, obtained by firing transition fired.
+             */
+            void successor(const MarkVal* marking, uint32_t fired);
+
+            /**
+             * Only evaluates the propositions of the given queries from now on,
+             * the values of the other propositions are left stale.
+             */
+            void retain(const std::vector<Condition_ptr>& queries);
+
+            /** The proposition of the comparison, size() if it is not cached */
+            uint32_t index(const Condition* condition) const {
+                auto it = _index.find(condition);
+                return it == _index.end() ? _atoms.size() : it->second;
+            }
+
+            /** The value of the proposition in the current marking */
+            bool value(uint32_t atom) const {
+                return _current[atom];
+            }
+
+            /** The value of the comparison in the current marking, RUNKNOWN if it is not cached */
+            Condition::Result lookup(const Condition* condition) const {
+                auto atom = index(condition);
+                if (atom == _atoms.size())
+                    return Condition::RUNKNOWN;
+                return _current[atom] ? Condition::RTRUE : Condition::RFALSE;
+            }
+
+        private:
+            bool compute(uint32_t atom, const MarkVal* marking) const;
+
+            const PetriNet& _net;
+            // keeps the comparisons alive
+            std::vector<Condition_ptr> _queries;
+            std::vector<Condition*> _atoms;
+            std::vector<std::unique_ptr<Bytecode>> _programs;
+            std::unordered_map<const Condition*, uint32_t> _index;
+            // the propositions which are evaluated
+            std::vector<uint32_t> _live;
+
+            // the propositions to re-evaluate after firing a transition, stored
+            // in _affected[_affectedPtrs[t] .. _affectedPtrs[t+1]]
+            std::vector<uint32_t> _affected;
+            std::vector<size_t> _affectedPtrs;
+            std::vector<bool> _recompute;
+
+            std::vector<bool> _parent;
+            std::vector<bool> _current;
+        };
+    }
+}
+
+#endif // ATOMICCACHE_H
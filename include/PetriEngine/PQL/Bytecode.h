@@ -0,0 +1,125 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include "PQL.h"
+#include "../PetriNet.h"
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace PetriEngine {
+    namespace PQL {
+
+        class AtomicCache;
+        class DistanceContext;
+
+        /**
+         * A condition lowered into a flat program, evaluated without the
+         * visitors, virtual calls or shared pointers of the condition tree.
+         *
+         * The instructions are stored in prefix order, each knowing where its
+         * subtree ends, so the operands of an instruction are the instructions
+         * following it. Linear expressions, the common case, are folded into a
+         * single sum over a table of (place, coefficient) terms.
+         *
+         * Evaluation and distance give the same results as evaluate and
+         * Condition::distance on the compiled condition. Comparisons cached by
+         * an AtomicCache given at compile time are read from the cache.
+         */
+        class Bytecode {
+        public:
+            /**
+             * Compiles a condition after its context analysis.
+             * @return nullptr if the condition contains an element which
+             * cannot be compiled (upper bounds or path selection).
+             */
+            static std::unique_ptr<Bytecode> compile(const Condition* condition, const PetriNet* net,
+                                                     const AtomicCache* atoms = nullptr);
+
+            Condition::Result evaluate(const MarkVal* marking) const;
+
+            uint32_t distance(const MarkVal* marking, bool negated = false) const;
+
+            size_t size() const {
+                return _code.size();
+            }
+
+            enum op_t : uint8_t {
+                // conditions
+                CONST_TRUE, CONST_FALSE, DEADLOCK, CONJUNCTION, ATOM,
+                LESS, LESS_EQUAL, EQUAL, NOT_EQUAL,
+                NOT, AND, OR,
+                // quantifiers, concluding only on a true (false) operand
+                IF_TRUE, IF_FALSE, UNKNOWN, UNTIL,
+                // expressions
+                SUM, PRODUCT, SUBTRACT, MINUS
+            };
+
+            // how the distance of a quantifier is measured on its operands
+            enum distance_t : uint8_t {
+                OPERAND, NEGATED, NONE
+            };
+
+            struct instr_t {
+                op_t op;
+                distance_t dist = OPERAND;
+                bool negated = false;
+                // the terms (or constraints) [arg, arg + count), or the atom
+                uint32_t arg = 0;
+                uint32_t count = 0;
+                // the instruction following the subtree
+                uint32_t end = 0;
+                int64_t constant = 0;
+            };
+
+            struct term_t {
+                uint32_t place;
+                int64_t coefficient;
+            };
+
+            struct constraint_t {
+                uint32_t place;
+                uint32_t lower;
+                uint32_t upper;
+            };
+
+        private:
+            friend class BytecodeCompiler;
+            friend class IncrementalDistance;
+
+            Condition::Result evaluateAt(uint32_t pc, const MarkVal* marking) const;
+            int64_t valueAt(uint32_t pc, const MarkVal* marking) const;
+            uint32_t distanceAt(uint32_t pc, const MarkVal* marking, bool negated) const;
+
+            const PetriNet* _net = nullptr;
+            const AtomicCache* _atoms = nullptr;
+            std::vector<instr_t> _code;
+            std::vector<term_t> _terms;
+            std::vector<constraint_t> _constraints;
+        };
+
+        /**
+         * The distance of the query, taken from the incremental measure or
+         * the program of the context if it has one
+         */
+        uint32_t distance(const Condition* query, DistanceContext& context);
+    }
+}
+
+#endif // BYTECODE_H
@@ -40,6 +40,10 @@ namespace PetriEngine {
 
     namespace PQL {
 
+        class AtomicCache;
+        class Bytecode;
+        class IncrementalDistance;
+
         /** Context provided for context analysis */
         class AnalysisContext {
         protected:
@@ -139,10 +143,20 @@ namespace PetriEngine {
                 _offset = i;
             }
 
+            /** Read the atomic propositions from a cache holding their values in this marking */
+            void setAtoms(const AtomicCache* atoms) {
+                _atoms = atoms;
+            }
+
+            const AtomicCache* atoms() const {
+                return _atoms;
+            }
+
         private:
             const MarkVal* _marking = nullptr;
             const PetriNet* _net = nullptr;
             size_t _offset = 0;
+            const AtomicCache* _atoms = nullptr;
         };
 
         /** Context for distance computation */
@@ -164,8 +178,28 @@ namespace PetriEngine {
                 return _negated;
             }
 
+            /** Measure the distance with the compiled program of the query */
+            void setProgram(const Bytecode* program) {
+                _program = program;
+            }
+
+            const Bytecode* program() const {
+                return _program;
+            }
+
+            /** Take the distance of the marking from an incremental measure which has already derived it */
+            void setIncremental(const IncrementalDistance* incremental) {
+                _incremental = incremental;
+            }
+
+            const IncrementalDistance* incremental() const {
+                return _incremental;
+            }
+
         private:
             bool _negated;
+            const Bytecode* _program = nullptr;
+            const IncrementalDistance* _incremental = nullptr;
         };
 
         /** Context for condition to TAPAAL export */
@@ -0,0 +1,93 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef INCREMENTALDISTANCE_H
+#define INCREMENTALDISTANCE_H
+
+#include "Bytecode.h"
+#include "../PetriNet.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace PetriEngine {
+    namespace PQL {
+
+        /**
+         * The distance of a compiled query, maintained from parent to successor.
+         *
+         * The distance is a sum or minimum over the distances of the
+         * comparisons of the query (its leaves), which are kept for the
+         * parent marking. For a successor only the leaves over places where
+         * the fired transition has a non-zero token delta are measured again,
+         * after which the sums and minima above them are recombined.
+         *
+         * The distances are those of Bytecode::distance, not negated.
+         */
+        class IncrementalDistance {
+        public:
+            IncrementalDistance(const Bytecode& program, const PetriNet& net);
+
+            /** Measures the distance of marking, the parent of the following successors */
+            uint32_t evaluate(const MarkVal* marking);
+
+            /**
+             * Derives the distance of the successor marking of the last
+             * evaluated marking, obtained by firing transition fired.
+             */
+            uint32_t successor(const MarkVal* marking, uint32_t fired);
+
+            /** The distance of the last evaluated marking or successor */
+            uint32_t value() const {
+                return _current[0];
+            }
+
+        private:
+            enum combine_t : uint8_t {
+                SUM, MIN, FIRST, SECOND
+            };
+
+            struct leaf_t {
+                uint32_t pc;
+                bool negated;
+            };
+
+            struct node_t {
+                uint32_t pc;
+                combine_t combine;
+            };
+
+            void build(uint32_t pc, bool negated, std::vector<std::vector<uint32_t>>& placeLeaves);
+            void combine(std::vector<uint32_t>& values) const;
+
+            const Bytecode& _program;
+            std::vector<leaf_t> _leaves;
+            // the operators above the leaves in prefix order
+            std::vector<node_t> _nodes;
+
+            // the leaves to measure again after firing a transition, stored
+            // in _affected[_affectedPtrs[t] .. _affectedPtrs[t+1]]
+            std::vector<uint32_t> _affected;
+            std::vector<size_t> _affectedPtrs;
+            std::vector<bool> _recompute;
+
+            // the distance of every instruction, indexed by its position
+            std::vector<uint32_t> _parent;
+            std::vector<uint32_t> _current;
+        };
+    }
+}
+
+#endif // INCREMENTALDISTANCE_H
@@ -26,6 +26,7 @@
 #include <limits>
 #include <memory>
 #include <iostream>
+#include <type_traits>
 
 #include "utils/structures/shared_string.h"
 
@@ -55,6 +56,31 @@ namespace PetriEngine {
         // we can pack things here, but might give slowdown
     } /*__attribute__((packed))*/;
 
+    /**
+     * Compiled form of the arcs of a transition, merging the pre- and
+     * post-arc of a place into a single guard and token delta.
+     */
+    template<typename P, typename W>
+    struct BasicFiringArc {
+        P place;
+        W tokens; // tokens required by the guard, or disabling it for inhibitors
+        std::make_signed_t<W> delta; // change of the marking of place when fired
+        bool inhibitor;
+        bool selfloop; // guarded, but the marking of place is unchanged
+    };
+
+    using FiringArc = BasicFiringArc<uint32_t, uint32_t>;
+    // half the size, for nets with at most 2^16 places and weights below 2^15
+    using CompactFiringArc = BasicFiringArc<uint16_t, uint16_t>;
+    static_assert(sizeof(CompactFiringArc) == 8, "compact arcs are packed into 8 bytes");
+
+    struct FiringRecord {
+        uint32_t begin; // first arc
+        uint32_t guards; // end of the arcs with a guard, the remaining only produce
+        uint32_t end;
+        bool unit; // all guards require a single token and none are inhibitors
+    };
+
     /** Type used for holding markings values */
     typedef uint32_t MarkVal;
 
@@ -110,8 +136,39 @@ namespace PetriEngine {
 
         void sort();
 
+        /** Builds the firing records from the arcs, must be called once the arcs are final */
+        void compile();
+
+        const FiringRecord& firing(uint32_t t) const {
+            return _firing[t];
+        }
+
+        const FiringArc* firingArcs() const {
+            return _firingArcs.data();
+        }
+
+        /** The firing arcs are also stored as CompactFiringArc */
+        bool compact() const {
+            return !_compactArcs.empty();
+        }
+
+        /**
+         * Calls visitor with the firing arcs, the compact ones if the net
+         * has them. The visitor is instantiated for both layouts, so the
+         * loops firing transitions read half the memory on small nets.
+         */
+        template<typename V>
+        decltype(auto) visitFiringArcs(V&& visitor) const {
+            if (!_compactArcs.empty())
+                return visitor(_compactArcs.data());
+            return visitor(_firingArcs.data());
+        }
+
         void toXML(std::ostream& out);
 
+        /** Hash of the structure and initial marking, identifies the net across runs */
+        uint64_t hash() const;
+
         const MarkVal* initial() const {
             return _initialMarking;
         }
@@ -136,6 +193,9 @@ namespace PetriEngine {
         std::vector<Invariant> _invariants;
         std::vector<uint32_t> _placeToPtrs;
         std::vector<bool> _controllable;
+        std::vector<FiringRecord> _firing;
+        std::vector<FiringArc> _firingArcs;
+        std::vector<CompactFiringArc> _compactArcs;
         MarkVal* _initialMarking;
 
         std::vector<shared_const_string> _transitionnames;
@@ -145,6 +205,7 @@ namespace PetriEngine {
         std::vector< std::tuple<double, double> > _transitionlocations;
 
         friend class PetriNetBuilder;
+        friend class EnabledTransitions;
         friend class Reducer;
         friend class SuccessorGenerator;
         friend class ReducingSuccessorGenerator;
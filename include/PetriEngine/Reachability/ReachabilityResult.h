@@ -20,6 +20,7 @@
 #ifndef REACHABILITYRESULT_H
 #define REACHABILITYRESULT_H
 
+#include <ostream>
 #include <vector>
 #include "../PQL/PQL.h"
 #include "../Structures/StateSet.h"
@@ -83,6 +84,9 @@ namespace PetriEngine {
 
             void setReducer(Reducer* r) { this->reducer = r; }
 
+            /** Reports every query still Unknown after an inconclusive search as CANNOT_COMPUTE */
+            void printUnsolved(std::ostream& out, const std::vector<Result>& results, const char* reason) const;
+
             std::pair<Result, bool> handle(
                 size_t index,
                 PQL::Condition* query,
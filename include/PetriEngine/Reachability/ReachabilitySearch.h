@@ -23,17 +23,33 @@
 #include "../Structures/State.h"
 #include "ReachabilityResult.h"
 #include "../PQL/PQL.h"
+#include "../PQL/Evaluation.h"
+#include "../PQL/AtomicCache.h"
+#include "../PQL/Bytecode.h"
+#include "../PQL/IncrementalDistance.h"
 #include "../PetriNet.h"
 #include "../Structures/StateSet.h"
+#include "../Structures/ConcurrentStateSet.h"
+#include "../Structures/BitStateSet.h"
+#include "../Structures/ExternalStateSet.h"
 #include "../Structures/Queue.h"
+#include "../Structures/WorkStealingQueue.h"
 #include "../Structures/PotencyQueue.h"
+#include "../EnabledTransitions.h"
 #include "../SuccessorGenerator.h"
 #include "../ReducingSuccessorGenerator.h"
 #include "PetriEngine/Stubborn/ReachabilityStubbornSet.h"
 #include "PetriEngine/Stubborn/ReachabilityStubbornSet.h"
 #include "PetriEngine/options.h"
+#include "utils/MemoryLimit.h"
 
+#include <atomic>
+#include <chrono>
+#include <exception>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <typeinfo>
 #include <vector>
 
 
@@ -62,15 +78,104 @@ namespace PetriEngine {
                     bool statespacesearch,
                     bool printstats,
                     bool keep_trace,
-                    size_t seed);
+                    size_t seed,
+                    uint32_t cores = 1);
+
+            /**
+             * Runs workers independent searches at once, differing in their
+             * seed, strategy and use of stubborn sets; the first worker uses
+             * the given ones. The first answer to a query is the one reported,
+             * and the workers stop once every query has an answer.
+             * With a single worker (or upper-bound queries, which cannot be
+             * shared) this is a plain search on the given cores.
+             */
+            bool swarm(
+                    std::vector<std::shared_ptr<PQL::Condition > >& queries,
+                    std::vector<ResultPrinter::Result>& results,
+                    Strategy strategy,
+                    bool usestubborn,
+                    bool printstats,
+                    bool keep_trace,
+                    size_t seed,
+                    uint32_t workers,
+                    uint32_t cores = 1);
             size_t maxTokens() const;
+
+            /**
+             * Use bitstate hashing with 2^bits bits and the given number of
+             * hash-functions instead of storing the markings. At most frontier
+             * markings are kept waiting for expansion (0 for unbounded).
+             * Queries not satisfied during such a search are left Unknown.
+             */
+            void setBitstate(uint32_t bits, uint32_t hashes, size_t frontier)
+            {
+                _bitstate = {bits, hashes, frontier};
+            }
+
+            /**
+             * Use a disk-backed breadth-first search, writing its layers to
+             * directory and sorting successors in runs of buffer bytes.
+             * Traces are not supported by this search.
+             */
+            void setExternal(const std::string& directory, size_t buffer)
+            {
+                _external = {directory, buffer};
+            }
+
+            /**
+             * Periodically write the state of the search to file, at most
+             * every interval seconds. A search can be continued from such a
+             * file using setResume, given the same net, queries and options.
+             */
+            void setCheckpoint(const std::string& file, size_t interval)
+            {
+                _checkpoint.file = file;
+                _checkpoint.interval = interval;
+            }
+
+            void setResume(const std::string& file)
+            {
+                _checkpoint.resume = file;
+            }
+
+            /**
+             * Keep the enabled transitions of waiting markings, using at most
+             * bytes of memory, so those of a successor are derived from its
+             * parent rather than computed from scratch (0 disables it).
+             */
+            void setEnabledCache(size_t bytes)
+            {
+                _enabledCache = bytes;
+            }
         private:
+            using programs_t = std::vector<std::unique_ptr<PQL::Bytecode>>;
+
+            struct bitstate_t {
+                uint32_t bits = 0;
+                uint32_t hashes = 0;
+                size_t frontier = 0;
+            };
+
+            struct external_t {
+                std::string directory;
+                size_t buffer = 0;
+            };
+
+            struct checkpoint_t {
+                std::string file;
+                std::string resume;
+                size_t interval = 0;
+                std::chrono::steady_clock::time_point last = std::chrono::steady_clock::now();
+            };
+
             struct searchstate_t {
                 size_t expandedStates = 0;
                 size_t exploredStates = 1;
                 std::vector<size_t> enabledTransitionsCount;
                 size_t heurquery = 0;
                 bool usequeries;
+                // the queries without a result, in increasing order
+                std::vector<size_t> open;
             };
 
             template<typename Q, typename W = Structures::StateSet, typename G>
@@ -79,11 +184,41 @@ namespace PetriEngine {
                 std::vector<ResultPrinter::Result>& results,
                 bool usequeries,
                 bool printstats,
-                size_t seed);
+                size_t seed,
+                bool keep_trace = false);
+
+            template<typename G>
+            bool tryReachExternal(
+                std::vector<std::shared_ptr<PQL::Condition > >& queries,
+                std::vector<ResultPrinter::Result>& results,
+                bool usequeries,
+                bool printstats);
+
+            template<typename W>
+            W makeStateSet(bool keep_trace);
+
+            template<typename Q, typename G>
+            bool tryReachParallel(
+                std::vector<std::shared_ptr<PQL::Condition > >& queries,
+                std::vector<ResultPrinter::Result>& results,
+                bool usequeries,
+                bool printstats,
+                bool keep_trace,
+                size_t seed,
+                uint32_t cores);
             void printStats(searchstate_t& s, Structures::StateSetInterface*);
             bool checkQueries(  std::vector<std::shared_ptr<PQL::Condition > >&,
                                     std::vector<ResultPrinter::Result>&,
-                                    Structures::State&, searchstate_t&, Structures::StateSetInterface*);
+                                    Structures::State&, searchstate_t&, Structures::StateSetInterface*,
+                                    const PQL::AtomicCache* atoms = nullptr, const programs_t* programs = nullptr);
+            void retireQueries(searchstate_t& ss, const std::vector<ResultPrinter::Result>& results);
+            bool checkpointDue(searchstate_t& ss);
+            void writeCheckpoint(const std::string& kind, const std::vector<std::shared_ptr<PQL::Condition>>&,
+                                    std::vector<ResultPrinter::Result>&,
+                                    searchstate_t&, Structures::StateSetInterface&, Structures::Queue&);
+            void readCheckpoint(const std::string& kind, const std::vector<std::shared_ptr<PQL::Condition>>&,
+                                    std::vector<ResultPrinter::Result>&,
+                                    searchstate_t&, Structures::StateSetInterface&, Structures::Queue&);
             std::pair<ResultPrinter::Result,bool> doCallback(std::shared_ptr<PQL::Condition>& query, size_t i, ResultPrinter::Result r, searchstate_t &ss, Structures::StateSetInterface *states);
 
             PetriNet& _net;
@@ -92,23 +227,56 @@ namespace PetriEngine {
             Structures::State _initial;
             AbstractHandler& _callback;
             size_t _max_tokens = 0;
+            bitstate_t _bitstate;
+            external_t _external;
+            checkpoint_t _checkpoint;
+            size_t _enabledCache = 0;
+            // set by the swarm, stopping the search when another worker has answered all queries
+            const std::atomic<bool>* _cancel = nullptr;
+            std::mutex* _query_lock = nullptr;
         };
 
+        template<typename W>
+        inline W ReachabilitySearch::makeStateSet(bool) {
+            return W{_net, (uint32_t)_kbound};
+        }
+        template<>
+        inline Structures::BitStateSet ReachabilitySearch::makeStateSet(bool keep_trace) {
+            return Structures::BitStateSet{_net, (uint32_t)_kbound, _bitstate.bits, _bitstate.hashes, _bitstate.frontier, keep_trace};
+        }
+
         template <typename G>
-        inline G _makeSucGen(PetriNet &net, std::vector<PQL::Condition_ptr> &queries) {
+        inline G _makeSucGen(PetriNet &net, std::vector<PQL::Condition_ptr> &queries, std::mutex* query_lock = nullptr,
+                             const PQL::AtomicCache* atoms = nullptr) {
             return G{net, queries};
         }
         template <>
-        inline ReducingSuccessorGenerator _makeSucGen(PetriNet &net, std::vector<PQL::Condition_ptr> &queries) {
+        inline ReducingSuccessorGenerator _makeSucGen(PetriNet &net, std::vector<PQL::Condition_ptr> &queries, std::mutex* query_lock,
+                                                      const PQL::AtomicCache* atoms) {
             auto stubset = std::make_shared<ReachabilityStubbornSet>(net, queries);
             stubset->setInterestingVisitor<InterestingTransitionVisitor>();
+            stubset->setQueryLock(query_lock);
+            stubset->setAtoms(atoms);
             return ReducingSuccessorGenerator{net, stubset};
         }
 
+        /** Restricts the stubborn set to the queries without a result */
+        template <typename G>
+        inline void _setQueries(G&, const std::vector<PQL::Condition_ptr>&, const std::vector<size_t>&) {
+        }
+        template <>
+        inline void _setQueries(ReducingSuccessorGenerator& generator, const std::vector<PQL::Condition_ptr>& queries,
+                                const std::vector<size_t>& open) {
+            std::vector<PQL::Condition*> conditions;
+            for(auto i : open)
+                conditions.push_back(queries[i].get());
+            generator.setQueries(std::move(conditions));
+        }
+
         template<typename Q, typename W, typename G>
         bool ReachabilitySearch::tryReach(   std::vector<std::shared_ptr<PQL::Condition> >& queries,
                                         std::vector<ResultPrinter::Result>& results, bool usequeries,
-                                        bool printstats, size_t seed)
+                                        bool printstats, size_t seed, bool keep_trace)
         {
 
             // set up state
@@ -118,6 +286,8 @@ namespace PetriEngine {
             ss.exploredStates = 1;
             ss.heurquery = queries.size() >= 2 ? std::rand() % queries.size() : 0;
             ss.usequeries = usequeries;
+            for(size_t i = 0; i < queries.size(); ++i)
+                ss.open.push_back(i);
 
             // set up working area
             Structures::State state;
@@ -125,77 +295,456 @@ namespace PetriEngine {
             _initial.setMarking(_net.makeInitialMarking());
             state.setMarking(_net.makeInitialMarking());
             working.setMarking(_net.makeInitialMarking());
+            // the successors of an expanded marking, generated a batch at a time
+            SuccessorBatch batch(_net.numberOfPlaces(), 32);
 
-            W states(_net, _kbound);    // stateset
+            W states = makeStateSet<W>(keep_trace);    // stateset
             Q queue(seed);           // working queue
-            G generator = _makeSucGen<G>(_net, queries); // successor generator
-            auto r = states.add(state);
+            // the comparisons of the queries, shared by the stubborn set and checkQueries
+            std::unique_ptr<PQL::AtomicCache> atoms;
+            if(!queries.empty())
+                atoms = std::make_unique<PQL::AtomicCache>(_net, queries);
+            G generator = _makeSucGen<G>(_net, queries, _query_lock, atoms.get()); // successor generator
+            // the queries compiled for checkQueries and the heuristic (nullptr if they cannot be)
+            programs_t programs;
+            for(auto& q : queries)
+                programs.push_back(PQL::Bytecode::compile(q.get(), &_net, atoms.get()));
+            // the distances of the queries kept from parent to successor, for the queues ordering by them
+            constexpr bool heuristic = std::is_same_v<Q, Structures::HeuristicQueue> ||
+                                       std::is_base_of_v<Structures::PotencyQueue, Q>;
+            std::vector<std::unique_ptr<PQL::IncrementalDistance>> distances(queries.size());
+            if constexpr (heuristic)
+            {
+                for(size_t i = 0; i < queries.size(); ++i)
+                    if(programs[i])
+                        distances[i] = std::make_unique<PQL::IncrementalDistance>(*programs[i], _net);
+            }
+            std::unique_ptr<EnabledTransitions> enabled;
+            std::vector<EnabledTransitions::word_t> parentEnabled, childEnabled;
+            if(_enabledCache > 0)
+            {
+                enabled = std::make_unique<EnabledTransitions>(_net, _enabledCache);
+                parentEnabled.resize(enabled->words());
+                childEnabled.resize(enabled->words());
+            }
+
+            // identifies the configuration of the search in checkpoints
+            std::string kind = std::string(typeid(Q).name()) + typeid(W).name() + typeid(G).name();
+            bool resumed = false;
+            if constexpr (std::is_base_of_v<Structures::Queue, Q>)
+            {
+                if(!_checkpoint.resume.empty())
+                {
+                    readCheckpoint(kind, queries, results, ss, states, queue);
+                    resumed = true;
+                }
+            }
+
+            // answered queries are dropped from the stubborn set and the propositions as they are answered
+            size_t nopen = queries.size();
+            auto retire = [&]() {
+                if(ss.open.empty() || ss.open.size() == nopen)
+                    return;
+                nopen = ss.open.size();
+                _setQueries(generator, queries, ss.open);
+                if(atoms)
+                {
+                    std::vector<PQL::Condition_ptr> open;
+                    for(auto i : ss.open)
+                        open.push_back(queries[i]);
+                    atoms->retain(open);
+                }
+            };
+            retireQueries(ss, results);
+            retire();
+
+            auto r = resumed ? std::make_pair(true, size_t{0}) : states.add(state);
             // this can fail due to reductions; we push tokens around and violate K
             if(r.first){
-                // add initial to states, check queries on initial state
-                _satisfyingMarking = r.second;
-                // check initial marking
-                if(ss.usequeries)
+                if(!resumed)
                 {
-                    if(checkQueries(queries, results, working, ss, &states))
+                    // add initial to states, check queries on initial state
+                    _satisfyingMarking = r.second;
+                    // check initial marking
+                    if(ss.usequeries)
                     {
-                        if(printstats)
-                            printStats(ss, &states);
-                        _max_tokens = states.maxTokens();
-                        return true;
+                        if(atoms)
+                            atoms->evaluate(working.marking());
+                        if(checkQueries(queries, results, working, ss, &states, atoms.get(), &programs))
+                        {
+                            if(printstats)
+                                printStats(ss, &states);
+                            _max_tokens = states.maxTokens();
+                            return true;
+                        }
+                        retire();
+                    }
+                    // add initial to queue
+                    {
+                        PQL::DistanceContext dc(&_net, working.marking());
+                        dc.setProgram(programs[ss.heurquery].get());
+                        queue.push(r.second, &dc, queries[ss.heurquery].get());
                     }
-                }
-                // add initial to queue
-                {
-                    PQL::DistanceContext dc(&_net, working.marking());
-                    queue.push(r.second, &dc, queries[ss.heurquery].get());
                 }
 
                 // Search!
                 for(auto nid = queue.pop(); nid != Structures::Queue::EMPTY; nid = queue.pop()) {
+                    if(MemoryLimit::check() || (_cancel != nullptr && *_cancel))
+                        break;
                     states.decode(state, nid);
+                    if(enabled)
+                    {
+                        if(!enabled->load(nid, parentEnabled.data()))
+                            enabled->compute(state.marking(), parentEnabled.data());
+                        generator.setEnabled(parentEnabled.data());
+                    }
+                    if(atoms)
+                        atoms->evaluate(state.marking());
+                    // the query whose distance is measured for the parent
+                    size_t measured = queries.size();
                     generator.prepare(&state);
 
-                    while(generator.next(working)){
-                        ss.enabledTransitionsCount[generator.fired()]++;
-                        auto res = states.add(working);
-                        if (res.first) {
-                            {
-                                PQL::DistanceContext dc(&_net, working.marking());
-                                if constexpr (std::is_same_v<Q, Structures::RandomPotencyQueue>)
-                                    queue.push(res.second, &dc, queries[ss.heurquery].get(), generator.fired());
-                                else
-                                    queue.push(res.second, &dc, queries[ss.heurquery].get());
-                            }
-                            states.setHistory(res.second, generator.fired());
-                            _satisfyingMarking = res.second;
-                            ss.exploredStates++;
-                            if (checkQueries(queries, results, working, ss, &states)) {
-                                if(printstats)
-                                    printStats(ss, &states);
-                                _max_tokens = states.maxTokens();
-                                return true;
+                    while(generator.next(batch)){
+                        for(size_t b = 0; b < batch.size(); ++b){
+                            auto& child = batch[b];
+                            auto fired = batch.transition(b);
+                            ss.enabledTransitionsCount[fired]++;
+                            auto res = states.addSuccessor(child, nid, fired);
+                            if (res.first) {
+                                if(enabled)
+                                {
+                                    childEnabled = parentEnabled;
+                                    enabled->update(child.marking(), fired, childEnabled.data());
+                                    enabled->store(res.second, childEnabled.data());
+                                }
+                                {
+                                    PQL::DistanceContext dc(&_net, child.marking());
+                                    dc.setProgram(programs[ss.heurquery].get());
+                                    if(distances[ss.heurquery])
+                                    {
+                                        auto& distance = *distances[ss.heurquery];
+                                        // the heuristic query changes when the previous one is answered
+                                        if(measured != ss.heurquery)
+                                        {
+                                            distance.evaluate(state.marking());
+                                            measured = ss.heurquery;
+                                        }
+                                        distance.successor(child.marking(), fired);
+                                        dc.setIncremental(&distance);
+                                    }
+                                    if constexpr (std::is_same_v<Q, Structures::RandomPotencyQueue>)
+                                        queue.push(res.second, &dc, queries[ss.heurquery].get(), fired);
+                                    else
+                                        queue.push(res.second, &dc, queries[ss.heurquery].get());
+                                }
+                                states.setHistory(res.second, fired);
+                                _satisfyingMarking = res.second;
+                                ss.exploredStates++;
+                                if(atoms)
+                                    atoms->successor(child.marking(), fired);
+                                if (checkQueries(queries, results, child, ss, &states, atoms.get(), &programs)) {
+                                    if(printstats)
+                                        printStats(ss, &states);
+                                    _max_tokens = states.maxTokens();
+                                    return true;
+                                }
+                                retire();
                             }
                         }
                     }
                     ss.expandedStates++;
+                    if constexpr (std::is_base_of_v<Structures::Queue, Q>)
+                    {
+                        if(checkpointDue(ss))
+                            writeCheckpoint(kind, queries, results, ss, states, queue);
+                    }
                 }
             }
 
             // no more successors, print last results
+            // (bitstate hashing may have pruned unseen markings and an exhausted memory limit
+            // leaves the search incomplete, so nothing is concluded, as does cancelling it)
+            bool complete = !std::is_same_v<W, Structures::BitStateSet> && !MemoryLimit::exhausted() &&
+                            (_cancel == nullptr || !*_cancel);
             for(size_t i= 0; i < queries.size(); ++i)
             {
-                if(results[i] == ResultPrinter::Unknown)
+                if(results[i] == ResultPrinter::Unknown && complete)
                 {
                     results[i] = doCallback(queries[i], i, ResultPrinter::NotSatisfied, ss, &states).first;
                 }
             }
 
             if(printstats)
+            {
                 printStats(ss, &states);
+                if constexpr (std::is_same_v<W, Structures::BitStateSet>)
+                    std::cout << "\tbitstate dropped:  " << states.dropped() << std::endl << std::endl;
+            }
             _max_tokens = states.maxTokens();
             return false;
         }
+
+        template<typename G>
+        bool ReachabilitySearch::tryReachExternal(  std::vector<std::shared_ptr<PQL::Condition> >& queries,
+                                                    std::vector<ResultPrinter::Result>& results, bool usequeries,
+                                                    bool printstats)
+        {
+            // set up state
+            searchstate_t ss;
+            ss.enabledTransitionsCount.resize(_net.numberOfTransitions(), 0);
+            ss.expandedStates = 0;
+            ss.exploredStates = 0;
+            ss.heurquery = 0;
+            ss.usequeries = usequeries;
+            for(size_t i = 0; i < queries.size(); ++i)
+                ss.open.push_back(i);
+            retireQueries(ss, results);
+
+            // set up working area
+            Structures::State state;
+            Structures::State working;
+            _initial.setMarking(_net.makeInitialMarking());
+            state.setMarking(_net.makeInitialMarking());
+            working.setMarking(_net.makeInitialMarking());
+
+            Structures::ExternalStateSet states(_net, _kbound, _external.directory, _external.buffer);
+            G generator = _makeSucGen<G>(_net, queries);
+            if(!ss.open.empty() && ss.open.size() < queries.size())
+                _setQueries(generator, queries, ss.open);
+            // queries are checked when a layer is read back, as only then the markings are known to be new
+            bool more = states.add(state).first && states.nextLayer();
+            while(more)
+            {
+                while(states.nextFrontier(state))
+                {
+                    if(MemoryLimit::check())
+                        break;
+                    ss.exploredStates++;
+                    auto nopen = ss.open.size();
+                    if(checkQueries(queries, results, state, ss, &states))
+                    {
+                        if(printstats)
+                            printStats(ss, &states);
+                        _max_tokens = states.maxTokens();
+                        return true;
+                    }
+                    if(ss.open.size() != nopen)
+                        _setQueries(generator, queries, ss.open);
+                    generator.prepare(&state);
+                    while(generator.next(working)){
+                        ss.enabledTransitionsCount[generator.fired()]++;
+                        states.add(working);
+                    }
+                    ss.expandedStates++;
+                }
+                if(MemoryLimit::exhausted())
+                    break;
+                more = states.nextLayer();
+            }
+
+            // no more successors, print last results
+            for(size_t i= 0; i < queries.size(); ++i)
+            {
+                if(results[i] == ResultPrinter::Unknown && !MemoryLimit::exhausted())
+                {
+                    results[i] = doCallback(queries[i], i, ResultPrinter::NotSatisfied, ss, &states).first;
+                }
+            }
+
+            if(printstats)
+                printStats(ss, &states);
+            _max_tokens = states.maxTokens();
+            return false;
+        }
+
+        template<typename Q, typename G>
+        bool ReachabilitySearch::tryReachParallel(  std::vector<std::shared_ptr<PQL::Condition> >& queries,
+                                                    std::vector<ResultPrinter::Result>& results, bool usequeries,
+                                                    bool printstats, bool keep_trace, size_t seed, uint32_t cores)
+        {
+            // shared search state, per-worker transition statistics are merged when done
+            searchstate_t ss;
+            ss.enabledTransitionsCount.resize(_net.numberOfTransitions(), 0);
+            ss.heurquery = queries.size() >= 2 ? std::rand() % queries.size() : 0;
+            ss.usequeries = usequeries;
+            for(size_t i = 0; i < queries.size(); ++i)
+                ss.open.push_back(i);
+            // queries answered before the search (e.g. simplified to a constant) are
+            // neither checked nor reported again, nor followed by the heuristic
+            retireQueries(ss, results);
+            std::atomic<size_t> expanded = 0;
+            std::atomic<size_t> explored = 1;
+            std::atomic<size_t> heurquery = ss.heurquery;
+            std::atomic<bool> stop = false;
+            std::vector<std::vector<size_t>> enabled(cores, std::vector<size_t>(_net.numberOfTransitions(), 0));
+            std::vector<std::atomic<bool>> solved(queries.size());
+            for(size_t i = 0; i < queries.size(); ++i)
+                solved[i] = results[i] != ResultPrinter::Unknown;
+            // bumped as queries are answered, the workers then restrict their stubborn sets to the open ones
+            std::atomic<size_t> retired = 1;
+            std::mutex result_lock;
+            std::mutex query_lock;
+            std::exception_ptr error;
+
+            Structures::ConcurrentStateSet states(_net, _kbound, cores, keep_trace);
+            Structures::WorkStealingQueue<Q> queue(cores, seed);
+
+            // must be called with result_lock held
+            auto handle = [&](size_t i, ResultPrinter::Result result) {
+                states.collectStatistics(false);
+                ss.expandedStates = expanded;
+                ss.exploredStates = explored;
+                auto r = doCallback(queries[i], i, result, ss, &states);
+                results[i] = r.first;
+                if(results[i] != ResultPrinter::Unknown)
+                {
+                    solved[i] = true;
+                    ++retired;
+                }
+                return r.second;
+            };
+
+            auto check = [&](Structures::State& state, size_t id) {
+                if(!ss.usequeries) return;
+                bool alldone = true;
+                for(size_t i = 0; i < queries.size(); ++i)
+                {
+                    if(solved[i]) continue;
+                    PQL::EvaluationContext ec(state.marking(), &_net);
+                    if(PetriEngine::PQL::evaluate(queries[i].get(), ec) != PQL::Condition::RTRUE)
+                    {
+                        alldone = false;
+                        continue;
+                    }
+                    std::lock_guard<std::mutex> guard(result_lock);
+                    if(solved[i] || stop) continue;
+                    _satisfyingMarking = id;
+                    if(handle(i, ResultPrinter::Satisfied))
+                        stop = true;
+                    if(i == heurquery)
+                    {
+                        for(size_t n = 1; n < queries.size(); ++n)
+                        {
+                            if(!solved[(i + n) % queries.size()])
+                            {
+                                heurquery = (i + n) % queries.size();
+                                break;
+                            }
+                        }
+                    }
+                }
+                if(alldone) stop = true;
+            };
+
+            Structures::State initial;
+            _initial.setMarking(_net.makeInitialMarking());
+            initial.setMarking(_net.makeInitialMarking());
+            auto r = states.add(initial, 0);
+            // this can fail due to reductions; we push tokens around and violate K
+            if(r.first)
+            {
+                check(initial, r.second);
+                if(!stop)
+                {
+                    PQL::DistanceContext dc(&_net, initial.marking());
+                    queue.push(0, r.second, &dc, queries[heurquery].get());
+                }
+            }
+
+            auto worker = [&](uint32_t w) {
+                try {
+                    Structures::State state;
+                    Structures::State working;
+                    state.setMarking(_net.makeInitialMarking());
+                    working.setMarking(_net.makeInitialMarking());
+                    G generator = _makeSucGen<G>(_net, queries, &query_lock);
+                    size_t nretired = 0;
+                    auto& count = enabled[w];
+                    while(!stop)
+                    {
+                        if(MemoryLimit::check())
+                            break;
+                        auto nid = queue.pop(w);
+                        if(nid == Structures::Queue::EMPTY)
+                        {
+                            if(queue.finished()) break;
+                            std::this_thread::yield();
+                            continue;
+                        }
+                        states.decode(state, nid, w);
+                        if(nretired != retired)
+                        {
+                            nretired = retired;
+                            std::vector<size_t> open;
+                            for(size_t i = 0; i < queries.size(); ++i)
+                                if(!solved[i])
+                                    open.push_back(i);
+                            if(!open.empty() && open.size() < queries.size())
+                                _setQueries(generator, queries, open);
+                        }
+                        generator.prepare(&state);
+
+                        while(!stop && generator.next(working)){
+                            count[generator.fired()]++;
+                            auto res = states.add(working, w);
+                            if (res.first) {
+                                states.setHistory(res.second, generator.fired(), w);
+                                {
+                                    PQL::DistanceContext dc(&_net, working.marking());
+                                    if constexpr (std::is_same_v<Q, Structures::RandomPotencyQueue>)
+                                        queue.push(w, res.second, &dc, queries[heurquery].get(), generator.fired());
+                                    else
+                                        queue.push(w, res.second, &dc, queries[heurquery].get());
+                                }
+                                ++explored;
+                                check(working, res.second);
+                            }
+                        }
+                        ++expanded;
+                        queue.expanded();
+                    }
+                }
+                catch(...)
+                {
+                    std::lock_guard<std::mutex> guard(result_lock);
+                    if(!error) error = std::current_exception();
+                    stop = true;
+                }
+            };
+
+            std::vector<std::thread> threads;
+            for(uint32_t w = 0; w < cores; ++w)
+                threads.emplace_back(worker, w);
+            for(auto& t : threads)
+                t.join();
+            if(error)
+                std::rethrow_exception(error);
+
+            states.collectStatistics(true);
+            for(auto& count : enabled)
+                for(size_t t = 0; t < count.size(); ++t)
+                    ss.enabledTransitionsCount[t] += count[t];
+            ss.expandedStates = expanded;
+            ss.exploredStates = explored;
+
+            bool done = stop;
+            if(!done && !MemoryLimit::exhausted())
+            {
+                // no more successors, print last results
+                for(size_t i= 0; i < queries.size(); ++i)
+                {
+                    if(results[i] == ResultPrinter::Unknown)
+                    {
+                        results[i] = doCallback(queries[i], i, ResultPrinter::NotSatisfied, ss, &states).first;
+                    }
+                }
+            }
+
+            if(printstats)
+                printStats(ss, &states);
+            _max_tokens = states.maxTokens();
+            return done;
+        }
     }
 } // Namespaces
 
@@ -26,9 +26,13 @@ namespace PetriEngine {
 
         void setQuery(PQL::Condition *ptr) { _stubSet->setQuery(ptr); }
 
+        void setQueries(std::vector<PQL::Condition *> queries) { _stubSet->setQueries(std::move(queries)); }
+
         bool prepare(const Structures::State *state) override;
 
-        bool next(Structures::State &write);
+        bool next(Structures::State &write) override;
+
+        size_t next(SuccessorBatch &batch) override;
 
         auto fired() const { return _current; }
     private:
@@ -34,6 +34,19 @@ class AlignedEncoder
 
         unsigned char getType(uint32_t sum, uint32_t pwt, bool same, uint32_t val) const;
 
+        /**
+         * True if the encoding of the given type stores every place at a
+         * fixed position, so a single place can be updated by patch.
+         */
+        bool positional(unsigned char type) const;
+
+        /**
+         * Sets the token count of place in an encoding of a positional type.
+         * The value must be representable by that type, i.e. the type of the
+         * modified marking must be the same.
+         */
+        void patch(unsigned char* data, uint32_t place, uint32_t value) const;
+
         size_t size(const uchar* data) const;
     private:
         uint32_t tokenBytes(uint32_t ntokens) const;
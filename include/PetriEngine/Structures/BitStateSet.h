@@ -0,0 +1,268 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef BITSTATESET_H
+#define BITSTATESET_H
+
+#include "StateSet.h"
+
+#include <cstring>
+#include <vector>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * Bitstate hashing (supertrace). Instead of storing the markings, a
+         * marking is only remembered by setting k bits in a fixed-size bit
+         * array; a marking is considered seen if all its k bits are set.
+         * Hash-collisions may thus wrongly prune unseen markings, so a search
+         * using this set is an under-approximation: any marking found is
+         * reachable, but exhausting the search proves nothing.
+         *
+         * Only markings which are waiting to be expanded are stored (encoded),
+         * and at most frontier of them; markings beyond this bound are dropped
+         * without setting their bits. A marking is released when decoded, so
+         * every id can only be decoded once, and the id may then be reused.
+         * The encoded markings share one buffer, which is compacted once most
+         * of it is released.
+         *
+         * With traces enabled, ids are not reused and the parent and
+         * transition of every added marking are kept, which costs memory
+         * linear in the number of states.
+         */
+        class BitStateSet : public StateSetInterface {
+        public:
+            BitStateSet(const PetriNet& net, uint32_t kbound, uint32_t bits, uint32_t hashes, size_t frontier, bool traces = false)
+            : StateSetInterface(net, kbound), _hashes(std::max<uint32_t>(hashes, 1)),
+              _frontier(frontier), _traces(traces)
+            {
+                if(bits < 6 || bits > 40)
+                    throw base_error("Bitstate size must be between 2^6 and 2^40 bits, got 2^", bits);
+                _mask = (uint64_t{1} << bits) - 1;
+                _bits.resize((_mask + 1) / 64, 0);
+            }
+
+            virtual std::pair<bool, size_t> add(const State& state) override
+            {
+                _discovered++;
+                MarkVal sum = 0;
+                bool allsame = true;
+                uint32_t val = 0;
+                uint32_t active = 0;
+                uint32_t last = 0;
+                markingStats(state.marking(), sum, allsame, val, active, last);
+
+                if (_maxTokens < sum)
+                    _maxTokens = sum;
+
+                //Check that we're within k-bound
+                if (_kbound != 0 && sum > _kbound)
+                    return std::pair<bool, size_t>(false, std::numeric_limits<size_t>::max());
+
+                unsigned char type = _encoder.getType(sum, active, allsame, val);
+                size_t length = _encoder.encode(state.marking(), type);
+                const unsigned char* data = (const unsigned char*)_encoder.scratchpad().const_raw();
+
+                if(test(data, length))
+                    return std::pair<bool, size_t>(false, std::numeric_limits<size_t>::max());
+                if(_frontier != 0 && _live >= _frontier)
+                {
+                    ++_dropped;
+                    return std::pair<bool, size_t>(false, std::numeric_limits<size_t>::max());
+                }
+                set(data, length);
+
+                ++_next;
+                size_t id = store(data, length);
+                if(_traces)
+                    _history.emplace_back();
+
+                MarkingKernels::updateBounds(_maxPlaceBound.data(), state.marking(), _net.numberOfPlaces());
+                return std::pair<bool, size_t>(true, id);
+            }
+
+            virtual void decode(State& state, size_t id) override
+            {
+                assert(id < _entries.size() && _entries[id].length != 0);
+                _parent = id;
+                auto& e = _entries[id];
+                memcpy(_encoder.scratchpad().raw(), _buffer.data() + e.offset, e.length);
+                release(id);
+                _encoder.decode(state.marking(), _encoder.scratchpad().raw());
+            }
+
+            /** The id of a marking is not stored, only whether it was (likely) seen */
+            virtual std::pair<bool, size_t> lookup(State& state) override
+            {
+                MarkVal sum = 0;
+                bool allsame = true;
+                uint32_t val = 0;
+                uint32_t active = 0;
+                uint32_t last = 0;
+                markingStats(state.marking(), sum, allsame, val, active, last);
+                unsigned char type = _encoder.getType(sum, active, allsame, val);
+                size_t length = _encoder.encode(state.marking(), type);
+                bool seen = test((const unsigned char*)_encoder.scratchpad().const_raw(), length);
+                return std::make_pair(seen, std::numeric_limits<size_t>::max());
+            }
+
+            virtual void setHistory(size_t id, size_t transition) override
+            {
+                if(!_traces) return;
+                _history[id].parent = _parent;
+                _history[id].transition = transition;
+            }
+
+            virtual std::pair<size_t, size_t> getHistory(size_t markingid) override
+            {
+                assert(_traces);
+                auto& t = _history[markingid];
+                return std::pair<size_t, size_t>(t.parent, t.transition);
+            }
+
+            /** The number of markings admitted to the set */
+            virtual size_t size() const override
+            {
+                return _next;
+            }
+
+            /** The number of markings dropped due to the frontier bound */
+            size_t dropped() const
+            {
+                return _dropped;
+            }
+
+        private:
+            struct entry_t {
+                size_t offset;
+                // zero once released
+                uint32_t length;
+            };
+
+            size_t store(const unsigned char* data, size_t length)
+            {
+                assert(length != 0);
+                size_t id;
+                if(_free.empty())
+                {
+                    id = _entries.size();
+                    _entries.emplace_back();
+                }
+                else
+                {
+                    id = _free.back();
+                    _free.pop_back();
+                }
+                _entries[id] = {_buffer.size(), (uint32_t)length};
+                _buffer.insert(_buffer.end(), data, data + length);
+                ++_live;
+                return id;
+            }
+
+            void release(size_t id)
+            {
+                auto& e = _entries[id];
+                // a depth-first search mostly releases the latest marking
+                if(e.offset + e.length == _buffer.size())
+                    _buffer.resize(e.offset);
+                else
+                    _released += e.length;
+                e.length = 0;
+                --_live;
+                if(!_traces)
+                    _free.push_back(id);
+                if(_live == 0)
+                {
+                    _buffer.clear();
+                    _released = 0;
+                }
+                else if(_released > 4096 && _released * 2 > _buffer.size())
+                    compact();
+            }
+
+            void compact()
+            {
+                std::vector<unsigned char> buffer;
+                buffer.reserve(_buffer.size() - _released);
+                for(auto& e : _entries)
+                {
+                    if(e.length == 0) continue;
+                    auto from = _buffer.data() + e.offset;
+                    e.offset = buffer.size();
+                    buffer.insert(buffer.end(), from, from + e.length);
+                }
+                _buffer.swap(buffer);
+                _released = 0;
+            }
+
+            // double hashing; h2 is forced odd so all k probes differ
+            template<typename F>
+            bool probe(const unsigned char* data, size_t length, F&& f) const
+            {
+                uint64_t h1 = 14695981039346656037ULL;
+                for(size_t i = 0; i < length; ++i)
+                {
+                    h1 ^= data[i];
+                    h1 *= 1099511628211ULL;
+                }
+                uint64_t h2 = h1;
+                h2 ^= h2 >> 33;
+                h2 *= 0xff51afd7ed558ccdULL;
+                h2 ^= h2 >> 33;
+                h2 |= 1;
+                for(uint32_t k = 0; k < _hashes; ++k)
+                {
+                    if(!f((h1 + k * h2) & _mask))
+                        return false;
+                }
+                return true;
+            }
+
+            bool test(const unsigned char* data, size_t length) const
+            {
+                return probe(data, length, [this](uint64_t b) {
+                    return (_bits[b / 64] & (uint64_t{1} << (b % 64))) != 0;
+                });
+            }
+
+            void set(const unsigned char* data, size_t length)
+            {
+                probe(data, length, [this](uint64_t b) {
+                    _bits[b / 64] |= uint64_t{1} << (b % 64);
+                    return true;
+                });
+            }
+
+            std::vector<uint64_t> _bits;
+            uint64_t _mask;
+            uint32_t _hashes;
+            size_t _frontier;
+            size_t _next = 0;
+            size_t _dropped = 0;
+            size_t _parent = 0;
+            bool _traces;
+            // the encoded markings waiting to be expanded, by id
+            std::vector<unsigned char> _buffer;
+            std::vector<entry_t> _entries;
+            std::vector<size_t> _free;
+            size_t _live = 0;
+            size_t _released = 0;
+            std::vector<traceable_t> _history;
+        };
+    }
+}
+
+#endif // BITSTATESET_H
@@ -0,0 +1,268 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef CONCURRENTSTATESET_H
+#define CONCURRENTSTATESET_H
+
+#include "StateSet.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * State set which can be shared between several search workers.
+         * Every worker owns its own encoder (and scratchpad), so encoding and
+         * decoding happens outside of any critical section.
+         *
+         * The encoded markings are hash-partitioned into a power-of-two number
+         * of shards, each with its own trie, history and lock. The global id of
+         * a marking is its id within the shard shifted past the shard-bits,
+         * with the shard-index in the low bits. The shard-indices are rotated
+         * such that the first marking added is given the id 0, which the
+         * trace-printing relies on.
+         *
+         * The overloads without a worker-argument act as worker 0, making the
+         * set usable wherever a StateSetInterface is expected.
+         */
+        class ConcurrentStateSet : public StateSetInterface {
+        private:
+            using ptrie_t = ptrie::set_stable<ptrie::uchar,size_t,17,128,4>;
+
+            struct shard_t {
+                std::mutex _lock;
+                ptrie_t _trie;
+                std::vector<traceable_t> _history;
+            };
+
+            struct worker_t {
+                worker_t(uint32_t nplaces, uint32_t kbound)
+                : _encoder(nplaces, kbound), _maxPlaceBound(nplaces, 0) {}
+                AlignedEncoder _encoder;
+                size_t _parent = 0;
+                std::atomic<size_t> _discovered = 0;
+                std::atomic<uint32_t> _maxTokens = 0;
+                std::vector<uint32_t> _maxPlaceBound;
+            };
+
+        public:
+            /**
+             * @param shards number of partitions, rounded up to a power of two.
+             * Defaults to four per worker to keep contention low.
+             */
+            ConcurrentStateSet(const PetriNet& net, uint32_t kbound, uint32_t workers, bool traces = false, uint32_t shards = 0)
+            : StateSetInterface(net, kbound), _traces(traces)
+            {
+                workers = std::max<uint32_t>(workers, 1);
+                if(shards == 0)
+                    shards = workers == 1 ? 1 : workers * 4;
+                while((1u << _bits) < shards)
+                    ++_bits;
+                for(uint32_t s = 0; s < (1u << _bits); ++s)
+                    _shards.emplace_back(std::make_unique<shard_t>());
+                for(uint32_t w = 0; w < workers; ++w)
+                    _workers.emplace_back(std::make_unique<worker_t>(_nplaces, kbound));
+            }
+
+            virtual std::pair<bool, size_t> add(const State& state) override
+            {
+                return add(state, 0);
+            }
+
+            std::pair<bool, size_t> add(const State& state, uint32_t worker)
+            {
+                auto& w = *_workers[worker];
+                ++w._discovered;
+
+                MarkVal sum = 0;
+                bool allsame = true;
+                uint32_t val = 0;
+                uint32_t active = 0;
+                uint32_t last = 0;
+                markingStats(state.marking(), sum, allsame, val, active, last);
+
+                if (w._maxTokens < sum)
+                    w._maxTokens = sum;
+
+                //Check that we're within k-bound
+                if (_kbound != 0 && sum > _kbound)
+                    return std::pair<bool, size_t>(false, std::numeric_limits<size_t>::max());
+
+                unsigned char type = w._encoder.getType(sum, active, allsame, val);
+                size_t length = w._encoder.encode(state.marking(), type);
+                if(length*8 >= std::numeric_limits<uint16_t>::max())
+                {
+                    throw base_error("Marking could not be encoded into less than 2^16 bytes, current limit of PTries");
+                }
+                binarywrapper_t bw = binarywrapper_t(w._encoder.scratchpad().raw(), length*8);
+                auto sid = shardOf(bw.raw(), length);
+                uint32_t unset = NO_ROTATION;
+                _rotation.compare_exchange_strong(unset, sid);
+                auto& shard = *_shards[sid];
+                std::pair<bool, size_t> tit;
+                {
+                    std::lock_guard<std::mutex> guard(shard._lock);
+                    tit = shard._trie.insert(bw.raw(), bw.size());
+                    if(tit.first && _traces)
+                        shard._history.emplace_back();
+                }
+
+                if(!tit.first)
+                    return std::pair<bool, size_t>(false, globalId(sid, tit.second));
+                ++_size;
+
+                MarkingKernels::updateBounds(w._maxPlaceBound.data(), state.marking(), _net.numberOfPlaces());
+                return std::pair<bool, size_t>(true, globalId(sid, tit.second));
+            }
+
+            virtual void decode(State& state, size_t id) override
+            {
+                decode(state, id, 0);
+            }
+
+            void decode(State& state, size_t id, uint32_t worker)
+            {
+                auto& w = *_workers[worker];
+                w._parent = id;
+                auto& shard = *_shards[shardOf(id)];
+                {
+                    std::lock_guard<std::mutex> guard(shard._lock);
+                    shard._trie.unpack(id >> _bits, w._encoder.scratchpad().raw());
+                }
+                w._encoder.decode(state.marking(), w._encoder.scratchpad().raw());
+            }
+
+            virtual std::pair<bool, size_t> lookup(State& state) override
+            {
+                return lookup(state, 0);
+            }
+
+            std::pair<bool, size_t> lookup(State& state, uint32_t worker)
+            {
+                auto& w = *_workers[worker];
+                MarkVal sum = 0;
+                bool allsame = true;
+                uint32_t val = 0;
+                uint32_t active = 0;
+                uint32_t last = 0;
+                markingStats(state.marking(), sum, allsame, val, active, last);
+
+                unsigned char type = w._encoder.getType(sum, active, allsame, val);
+                size_t length = w._encoder.encode(state.marking(), type);
+                binarywrapper_t bw = binarywrapper_t(w._encoder.scratchpad().raw(), length*8);
+                auto sid = shardOf(bw.raw(), length);
+                auto& shard = *_shards[sid];
+                std::lock_guard<std::mutex> guard(shard._lock);
+                auto tit = shard._trie.exists(bw.raw(), bw.size());
+                if (tit.first && _rotation != NO_ROTATION)
+                    return std::make_pair(true, globalId(sid, tit.second));
+                return std::make_pair(false, std::numeric_limits<size_t>::max());
+            }
+
+            virtual void setHistory(size_t id, size_t transition) override
+            {
+                setHistory(id, transition, 0);
+            }
+
+            /** Records that id was reached from the marking last decoded by worker */
+            void setHistory(size_t id, size_t transition, uint32_t worker)
+            {
+                if(!_traces) return;
+                auto& shard = *_shards[shardOf(id)];
+                std::lock_guard<std::mutex> guard(shard._lock);
+                auto& t = shard._history[id >> _bits];
+                t.parent = _workers[worker]->_parent;
+                t.transition = transition;
+            }
+
+            virtual std::pair<size_t, size_t> getHistory(size_t markingid) override
+            {
+                assert(_traces);
+                auto& shard = *_shards[shardOf(markingid)];
+                std::lock_guard<std::mutex> guard(shard._lock);
+                auto& t = shard._history[markingid >> _bits];
+                return std::pair<size_t, size_t>(t.parent, t.transition);
+            }
+
+            virtual size_t size() const override
+            {
+                return _size;
+            }
+
+            /**
+             * Folds the statistics of the individual workers into the
+             * statistics exposed by the StateSetInterface. The place-bounds are
+             * only folded when bounds is set, in which case no worker may be
+             * running.
+             */
+            void collectStatistics(bool bounds)
+            {
+                _discovered = 0;
+                for(auto& w : _workers)
+                {
+                    _discovered += w->_discovered;
+                    _maxTokens = std::max<uint32_t>(_maxTokens, w->_maxTokens);
+                    if(bounds)
+                    {
+                        for(size_t p = 0; p < _maxPlaceBound.size(); ++p)
+                            _maxPlaceBound[p] = std::max(_maxPlaceBound[p], w->_maxPlaceBound[p]);
+                    }
+                }
+            }
+
+            size_t shards() const
+            {
+                return _shards.size();
+            }
+
+        private:
+            static constexpr uint32_t NO_ROTATION = std::numeric_limits<uint32_t>::max();
+
+            // FNV-1a over the encoded marking
+            uint32_t shardOf(const unsigned char* data, size_t length) const
+            {
+                if(_bits == 0) return 0;
+                uint64_t h = 14695981039346656037ULL;
+                for(size_t i = 0; i < length; ++i)
+                {
+                    h ^= data[i];
+                    h *= 1099511628211ULL;
+                }
+                return (h ^ (h >> 32)) & ((1u << _bits) - 1);
+            }
+
+            uint32_t shardOf(size_t id) const
+            {
+                return (id + _rotation) & ((1u << _bits) - 1);
+            }
+
+            size_t globalId(uint32_t shard, size_t local) const
+            {
+                return (local << _bits) | ((shard - _rotation) & ((1u << _bits) - 1));
+            }
+
+            uint32_t _bits = 0;
+            std::atomic<uint32_t> _rotation = NO_ROTATION;
+            std::atomic<size_t> _size = 0;
+            std::vector<std::unique_ptr<shard_t>> _shards;
+            std::vector<std::unique_ptr<worker_t>> _workers;
+            bool _traces;
+        };
+    }
+}
+
+#endif // CONCURRENTSTATESET_H
@@ -0,0 +1,107 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef EXTERNALSTATESET_H
+#define EXTERNALSTATESET_H
+
+#include "StateSet.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * Disk-backed state set for layered (breadth-first) exploration with
+         * delayed duplicate detection.
+         *
+         * Markings are stored as AlignedEncoder-records, prefixed by their
+         * length. Successors passed to add are collected in a memory buffer,
+         * which is sorted and written as a run once full. When a layer is
+         * done, nextLayer merges the runs with the (sorted) visited file,
+         * producing a new visited file and the next frontier; only the new
+         * frontier is read back via nextFrontier. All file accesses are
+         * sequential.
+         *
+         * As markings are not addressable, decode, lookup and traces are not
+         * supported.
+         */
+        class ExternalStateSet : public StateSetInterface {
+        public:
+            struct reader_t;
+
+            /**
+             * @param directory where the layers and runs are written.
+             * @param buffer size of the in-memory run buffer in bytes.
+             */
+            ExternalStateSet(const PetriNet& net, uint32_t kbound, const std::string& directory, size_t buffer);
+            virtual ~ExternalStateSet();
+
+            /** Adds a successor of the current layer; the id is not addressable */
+            virtual std::pair<bool, size_t> add(const State& state) override;
+            virtual void decode(State& state, size_t id) override;
+            virtual std::pair<bool, size_t> lookup(State& state) override;
+            virtual void setHistory(size_t id, size_t transition) override {}
+            virtual std::pair<size_t, size_t> getHistory(size_t markingid) override;
+
+            /** The number of distinct markings seen in completed layers */
+            virtual size_t size() const override
+            {
+                return _visitedCount;
+            }
+
+            /**
+             * Reads the next marking of the current frontier into state.
+             * @return false when the frontier is exhausted.
+             */
+            bool nextFrontier(State& state);
+
+            /**
+             * Removes duplicates from the markings added since the last call,
+             * and makes the new markings the frontier.
+             * @return false if no new markings were found.
+             */
+            bool nextLayer();
+
+            size_t layers() const
+            {
+                return _layer;
+            }
+
+        private:
+            std::string fileName(const char* kind, size_t n) const;
+            void flushRun();
+
+            std::string _directory;
+            std::string _prefix;
+            size_t _bufferSize;
+            std::vector<unsigned char> _buffer;
+            std::vector<size_t> _offsets;
+            std::vector<std::string> _runs;
+            std::string _visited;
+            std::string _frontier;
+            std::unique_ptr<reader_t> _reader;
+            size_t _layer = 0;
+            size_t _files = 0;
+            size_t _added = 0;
+            size_t _visitedCount = 0;
+        };
+    }
+}
+
+#endif // EXTERNALSTATESET_H
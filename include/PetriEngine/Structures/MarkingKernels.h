@@ -0,0 +1,66 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef MARKINGKERNELS_H
+#define MARKINGKERNELS_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * The loops over all places of a marking which are run for every
+         * discovered state. The implementation is selected once, at runtime,
+         * for the widest instruction set the CPU supports (AVX2, SSE4.1 or
+         * plain C++).
+         */
+        namespace MarkingKernels {
+
+            struct stats_t {
+                uint64_t sum = 0;
+                uint32_t active = 0; // number of places with tokens
+                uint32_t max = 0;
+                uint32_t last = 0; // index of the last place with tokens
+                bool allsame = true; // all places with tokens hold max tokens
+            };
+
+            stats_t stats(const uint32_t* marking, size_t places);
+
+            /** bounds[i] = max(bounds[i], marking[i]) */
+            void updateBounds(uint32_t* bounds, const uint32_t* marking, size_t places);
+
+            /** One bit per place, set if the place has tokens; most significant bit first */
+            void packBits(unsigned char* dest, const uint32_t* marking, size_t places);
+
+            /** Two bits per place holding at most 3 tokens; most significant bit first */
+            void packTwoBits(unsigned char* dest, const uint32_t* marking, size_t places);
+
+            /** The instruction set of the selected implementation */
+            const char* name();
+
+            /**
+             * Selects the implementation for the given instruction set ("avx2",
+             * "sse4.1" or "generic"), e.g. to test them against each other.
+             * Not thread-safe, call it before searching.
+             * @return false if it is not compiled in or the CPU lacks it.
+             */
+            bool use(const char* name);
+        }
+    }
+}
+
+#endif // MARKINGKERNELS_H
@@ -14,12 +14,15 @@
 #ifndef QUEUE_H
 #define QUEUE_H
 
+#include <iostream>
 #include <memory>
 #include <queue>
 #include <stack>
 #include <random>
 
 #include "../PQL/PQL.h"
+#include "SegmentedStack.h"
+#include "StateId.h"
 
 namespace PetriEngine {
     namespace Structures {
@@ -33,6 +36,11 @@ namespace PetriEngine {
                 const PQL::Condition* query = nullptr) = 0;
             virtual bool empty() const = 0;
             static constexpr size_t EMPTY = std::numeric_limits<size_t>::max();
+
+            /** Serializes the waiting elements, used for checkpoints */
+            virtual void write(std::ostream& out) const;
+            /** Restores elements written by write into this (empty) queue */
+            virtual void read(std::istream& in);
         };
 
         class BFSQueue : public Queue {
@@ -44,6 +52,8 @@ namespace PetriEngine {
             virtual void push(size_t id, PQL::DistanceContext*,
                 const PQL::Condition* query) override;
             virtual bool empty() const override;
+            virtual void write(std::ostream& out) const override;
+            virtual void read(std::istream& in) override;
         private:
             std::queue<size_t> _queue;
         };
@@ -58,8 +68,10 @@ namespace PetriEngine {
             virtual void push(size_t id, PQL::DistanceContext*,
                 const PQL::Condition* query);
             virtual bool empty() const override;
+            virtual void write(std::ostream& out) const override;
+            virtual void read(std::istream& in) override;
         private:
-            std::stack<uint32_t> _stack;
+            SegmentedStack<stored_id_t> _stack;
         };
 
         class RDFSQueue : public Queue {
@@ -71,18 +83,29 @@ namespace PetriEngine {
             virtual void push(size_t id, PQL::DistanceContext*,
                 const PQL::Condition* query);
             virtual bool empty() const override;
+            virtual void write(std::ostream& out) const override;
+            virtual void read(std::istream& in) override;
         private:
-            std::stack<uint32_t> _stack;
-            std::vector<uint32_t> _cache;
+            SegmentedStack<stored_id_t> _stack;
+            std::vector<size_t> _cache;
             std::default_random_engine _rng;
         };
 
+        /**
+         * Pops the state with the smallest distance first, and among equal
+         * distances the one pushed last (depth first).
+         *
+         * Distances are small integers, so states are kept in one stack per
+         * distance below BUCKETS, with a bitmap of the non-empty buckets; push
+         * and pop are then constant time (amortized) and mostly touch the top
+         * of a single vector. Larger distances fall back to a heap.
+         */
         class HeuristicQueue : public Queue {
         public:
             struct weighted_t {
                 uint32_t weight;
-                uint32_t item;
-                weighted_t(uint32_t w, uint32_t i) : weight(w), item(i) {};
+                size_t item;
+                weighted_t(uint32_t w, size_t i) : weight(w), item(i) {};
                 bool operator <(const weighted_t& y) const {
                     if(weight == y.weight) return item < y.item;// do dfs if they match
 //                    if(weight == y.weight) return item > y.item;// do bfs if they match
@@ -97,8 +120,17 @@ namespace PetriEngine {
             virtual void push(size_t id, PQL::DistanceContext*,
                 const PQL::Condition* query);
             virtual bool empty() const override;
+            virtual void write(std::ostream& out) const override;
+            virtual void read(std::istream& in) override;
         private:
-            std::priority_queue<weighted_t> _queue;
+            static constexpr uint32_t BUCKETS = 1 << 16;
+            void insert(uint32_t weight, size_t item);
+
+            std::vector<std::vector<stored_id_t>> _buckets;
+            std::vector<uint64_t> _nonempty; // bit per bucket
+            uint32_t _min = 0; // no non-empty bucket below _min
+            size_t _size = 0;
+            std::priority_queue<weighted_t> _overflow;
         };
     }
 }
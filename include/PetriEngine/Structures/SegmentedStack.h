@@ -0,0 +1,97 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SEGMENTEDSTACK_H
+#define SEGMENTEDSTACK_H
+
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * A stack stored in fixed-size chunks. Unlike a std::vector it never
+         * copies its elements when growing, and unlike a std::deque it returns
+         * the memory of chunks to the allocator as the stack shrinks, keeping
+         * only one spare chunk to avoid thrashing at a chunk boundary.
+         */
+        template<typename T, size_t CHUNK = 8192>
+        class SegmentedStack {
+        public:
+            void push(const T& element)
+            {
+                if(_top == CHUNK * _chunks.size())
+                {
+                    if(_spare)
+                        _chunks.emplace_back(std::move(_spare));
+                    else
+                        _chunks.emplace_back(std::make_unique<T[]>(CHUNK));
+                }
+                _chunks[_top / CHUNK][_top % CHUNK] = element;
+                ++_top;
+            }
+
+            const T& top() const
+            {
+                assert(_top > 0);
+                return (*this)[_top - 1];
+            }
+
+            void pop()
+            {
+                assert(_top > 0);
+                --_top;
+                // release the chunk above the new top
+                if(_top % CHUNK == 0)
+                {
+                    _spare = std::move(_chunks.back());
+                    _chunks.pop_back();
+                }
+            }
+
+            /** The element at depth index from the bottom */
+            const T& operator[](size_t index) const
+            {
+                return _chunks[index / CHUNK][index % CHUNK];
+            }
+
+            bool empty() const
+            {
+                return _top == 0;
+            }
+
+            size_t size() const
+            {
+                return _top;
+            }
+
+            /** The number of elements the allocated chunks, including the spare, can hold */
+            size_t capacity() const
+            {
+                return (_chunks.size() + (_spare ? 1 : 0)) * CHUNK;
+            }
+
+        private:
+            std::vector<std::unique_ptr<T[]>> _chunks;
+            std::unique_ptr<T[]> _spare;
+            size_t _top = 0;
+        };
+    }
+}
+
+#endif // SEGMENTEDSTACK_H
@@ -0,0 +1,158 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SMALLVECTOR_H
+#define SMALLVECTOR_H
+
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <new>
+#include <type_traits>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * A vector of trivially copyable elements, storing up to N of them
+         * inline and the rest in a single heap block. Size and capacity are
+         * 32-bit, so a SmallVector of pointers with N = 1 takes 16 bytes.
+         *
+         * All-zero bytes are a valid empty vector, so it may live in memory
+         * which is zeroed rather than constructed, such as a linked_bucket_t.
+         * Such a vector is never destroyed, so clear() returns the heap block.
+         */
+        template<typename T, uint32_t N>
+        class SmallVector {
+            static_assert(std::is_trivially_copyable<T>::value, "SmallVector only moves its elements by memcpy");
+            static_assert(N > 0 && N * sizeof(T) >= sizeof(T*), "the inline storage also holds the heap pointer");
+        public:
+            SmallVector() {}
+            SmallVector(const SmallVector&) = delete;
+            SmallVector& operator=(const SmallVector&) = delete;
+
+            ~SmallVector()
+            {
+                clear();
+            }
+
+            T* begin() { return data(); }
+            T* end() { return data() + _size; }
+            const T* begin() const { return data(); }
+            const T* end() const { return data() + _size; }
+
+            /** The elements from the last to the first, for a range-based for */
+            auto reversed() const
+            {
+                struct range_t {
+                    std::reverse_iterator<const T*> first, last;
+                    auto begin() const { return first; }
+                    auto end() const { return last; }
+                };
+                return range_t{std::reverse_iterator<const T*>(end()), std::reverse_iterator<const T*>(begin())};
+            }
+
+            T& operator[](uint32_t i)
+            {
+                assert(i < _size);
+                return data()[i];
+            }
+
+            const T& operator[](uint32_t i) const
+            {
+                assert(i < _size);
+                return data()[i];
+            }
+
+            uint32_t size() const { return _size; }
+            bool empty() const { return _size == 0; }
+
+            void push_back(const T& element)
+            {
+                // element may live in the storage which grow() frees
+                T copy = element;
+                if(_size == capacity())
+                    grow();
+                data()[_size++] = copy;
+            }
+
+            /** Inserts element before pos, shifting the following elements */
+            T* insert(T* pos, const T& element)
+            {
+                auto index = pos - begin();
+                // element may live in the storage which grow() frees or memmove shifts
+                T copy = element;
+                if(_size == capacity())
+                    grow();
+                T* at = data() + index;
+                std::memmove(at + 1, at, (_size - index) * sizeof(T));
+                *at = copy;
+                ++_size;
+                return at;
+            }
+
+            /** Removes the elements in [first, last), keeping the order of the others */
+            T* erase(T* first, T* last)
+            {
+                std::memmove(first, last, (end() - last) * sizeof(T));
+                _size -= last - first;
+                return first;
+            }
+
+            void clear()
+            {
+                if(_capacity != 0)
+                    std::free(_heap);
+                _size = 0;
+                _capacity = 0;
+            }
+
+        private:
+            T* data() { return _capacity == 0 ? _inline : _heap; }
+            const T* data() const { return _capacity == 0 ? _inline : _heap; }
+            uint32_t capacity() const { return _capacity == 0 ? N : _capacity; }
+
+            void grow()
+            {
+                uint32_t ncap = capacity() * 2;
+                T* mem;
+                if(_capacity == 0)
+                {
+                    mem = static_cast<T*>(std::malloc(ncap * sizeof(T)));
+                    if(mem != nullptr)
+                        std::memcpy(mem, _inline, _size * sizeof(T));
+                }
+                else
+                    mem = static_cast<T*>(std::realloc(_heap, ncap * sizeof(T)));
+                if(mem == nullptr)
+                    throw std::bad_alloc();
+                _heap = mem;
+                _capacity = ncap;
+            }
+
+            union {
+                T _inline[N];
+                T* _heap;
+            };
+            uint32_t _size = 0;
+            // zero while the elements are inline
+            uint32_t _capacity = 0;
+        };
+    }
+}
+
+#endif // SMALLVECTOR_H
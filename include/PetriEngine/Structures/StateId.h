@@ -0,0 +1,75 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef STATEID_H
+#define STATEID_H
+
+#include "utils/errors.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * An unsigned integer stored in BYTES bytes without alignment, so
+         * structures of them have no padding.
+         */
+        template<size_t BYTES>
+        class packed_uint_t {
+        public:
+            static constexpr uint64_t LIMIT = uint64_t{1} << (8 * BYTES);
+
+            packed_uint_t() = default;
+
+            packed_uint_t(uint64_t id)
+            {
+                if(id >= LIMIT)
+                    throw base_error("Value ", id, " does not fit in ", 8 * BYTES, " bits, rebuild with VERIFYPN_PACKED_IDS=OFF");
+                for(size_t i = 0; i < sizeof(_bytes); ++i)
+                    _bytes[i] = (unsigned char)(id >> (8 * i));
+            }
+
+            operator uint64_t() const
+            {
+                uint64_t id = 0;
+                for(size_t i = 0; i < sizeof(_bytes); ++i)
+                    id |= uint64_t{_bytes[i]} << (8 * i);
+                return id;
+            }
+
+        private:
+            unsigned char _bytes[BYTES] = {};
+        };
+
+        /**
+         * A state id packed into 40 bits, enough for 2^40 states while
+         * costing one byte more than a 32-bit id.
+         */
+        using packed_id_t = packed_uint_t<5>;
+
+        /** The types ids are stored as in the waiting lists and traces */
+#ifdef VERIFYPN_PACKED_IDS
+        using stored_id_t = packed_id_t;
+        using stored_transition_t = packed_uint_t<4>;
+#else
+        using stored_id_t = uint64_t;
+        using stored_transition_t = uint32_t;
+#endif
+    }
+}
+
+#endif // STATEID_H
@@ -22,6 +22,8 @@
 #include <iostream>
 #include "State.h"
 #include "AlignedEncoder.h"
+#include "MarkingKernels.h"
+#include "StateId.h"
 #include "utils/structures/binarywrapper.h"
 #include "utils/errors.h"
 
@@ -52,6 +54,17 @@ namespace PetriEngine {
 
             virtual std::pair<bool, size_t> add(const State& state) = 0;
 
+            /**
+             * Adds a successor of the marking parent, reached by firing
+             * transition. If parent was the last marking decoded, only the
+             * places touched by transition are inspected, and the successor
+             * is encoded by patching the encoding of parent where possible.
+             */
+            virtual std::pair<bool, size_t> addSuccessor(const State& state, size_t parent, uint32_t transition)
+            {
+                return add(state);
+            }
+
             virtual void decode(State* state, size_t id) { decode(*state, id); }
 
             virtual void decode(State& state, size_t id) = 0;
@@ -68,6 +81,18 @@ namespace PetriEngine {
 
             virtual size_t size() const = 0;
 
+            /** Serializes the stored markings and statistics, used for checkpoints */
+            virtual void write(std::ostream& out)
+            {
+                throw base_error("Checkpointing is not supported by this state-set");
+            }
+
+            /** Restores a set written by write into this (empty) set */
+            virtual void read(std::istream& in)
+            {
+                throw base_error("Checkpointing is not supported by this state-set");
+            }
+
         protected:
             size_t _discovered;
             uint32_t _kbound;
@@ -77,20 +102,79 @@ namespace PetriEngine {
             AlignedEncoder _encoder;
             const PetriNet& _net;
             binarywrapper_t _sp;
+
+            // the last decoded marking, kept for addSuccessor
+            struct parent_t {
+                size_t id = std::numeric_limits<size_t>::max();
+                std::vector<uint32_t> marking;
+                std::vector<unsigned char> encoding;
+                MarkVal sum = 0;
+                uint32_t active = 0;
+                uint32_t max = 0;
+                uint32_t nmax = 0; // number of places holding max tokens
+            };
+            bool _incremental = false;
+            parent_t _parentCache;
+            std::vector<uint32_t> _touched;
+            std::vector<uint32_t> _changed;
+            uint32_t _stamp = 0;
 #ifdef DEBUG
             std::vector<uint32_t*> _dbg;
 #endif
             template<typename T>
             void _decode(State& state, size_t id, T& _trie)
             {
-                    _trie.unpack(id, _encoder.scratchpad().raw());
+                    size_t length = _trie.unpack(id, _encoder.scratchpad().raw());
                     _encoder.decode(state.marking(), _encoder.scratchpad().raw());
+                    if(_incremental)
+                        cacheParent(id, state.marking(), length);
 
 #ifdef DEBUG
                     assert(memcmp(state.marking(), _dbg[id], sizeof(uint32_t)*_net.numberOfPlaces()) == 0);
 #endif
             }
 
+            template<typename T>
+            void _write(std::ostream& out, T& _trie)
+            {
+                auto put = [&out](auto v) { out.write(reinterpret_cast<const char*>(&v), sizeof(v)); };
+                put((uint64_t)_discovered);
+                put(_maxTokens);
+                for(auto b : _maxPlaceBound)
+                    put(b);
+                put((uint64_t)_trie.size());
+                for(size_t id = 0; id < _trie.size(); ++id)
+                {
+                    uint16_t length = _trie.unpack(id, _encoder.scratchpad().raw());
+                    put(length);
+                    out.write(reinterpret_cast<const char*>(_encoder.scratchpad().const_raw()), length);
+                }
+            }
+
+            template<typename T>
+            void _read(std::istream& in, T& _trie)
+            {
+                auto get = [&in](auto& v) { in.read(reinterpret_cast<char*>(&v), sizeof(v)); };
+                uint64_t discovered, size;
+                get(discovered);
+                _discovered = discovered;
+                get(_maxTokens);
+                for(auto& b : _maxPlaceBound)
+                    get(b);
+                get(size);
+                for(size_t id = 0; id < size; ++id)
+                {
+                    uint16_t length;
+                    get(length);
+                    in.read(reinterpret_cast<char*>(_encoder.scratchpad().raw()), length);
+                    if(!in)
+                        throw base_error("Checkpoint is truncated");
+                    auto res = _trie.insert(_encoder.scratchpad().raw(), length);
+                    if(!res.first || res.second != id)
+                        throw base_error("Checkpoint contains duplicate markings");
+                }
+            }
+
             template<typename T>
             std::pair<bool, size_t> _add(const State& state, T& _trie) {
                 _discovered++;
@@ -137,18 +221,164 @@ namespace PetriEngine {
 #endif
 
                 // update the max token bound for each place in the net (only for newly discovered markings)
-                for (uint32_t i = 0; i < _net.numberOfPlaces(); i++)
+                MarkingKernels::updateBounds(_maxPlaceBound.data(), state.marking(), _net.numberOfPlaces());
+
+#ifdef DEBUG
+                if(_trie.size() % 100000 == 0) std::cout << "Inserted " << _trie.size() << std::endl;
+#endif
+                return std::pair<bool, size_t>(true, tit.second);
+            }
+
+            template<typename T>
+            std::pair<bool, size_t> _addSuccessor(const State& state, size_t parent, uint32_t transition, T& _trie) {
+                _incremental = true;
+                auto& p = _parentCache;
+                if(p.id != parent || _nplaces != _net.numberOfPlaces())
+                    return _add(state, _trie);
+                _discovered++;
+
+                MarkVal sum = p.sum;
+                uint32_t active = p.active;
+                uint32_t max = p.max;
+                uint32_t nmax = p.nmax;
+
+                // update the statistics of the parent by the places which changed
+                if(++_stamp == 0)
                 {
-                    _maxPlaceBound[i] = std::max<MarkVal>( state.marking()[i],
-                                                            _maxPlaceBound[i]);
+                    std::fill(_touched.begin(), _touched.end(), 0);
+                    _stamp = 1;
+                }
+                _changed.clear();
+                auto visit = [&](const Invariant* it, const Invariant* end) {
+                    for(; it != end; ++it)
+                    {
+                        auto place = it->place;
+                        if(_touched[place] == _stamp) continue;
+                        _touched[place] = _stamp;
+                        uint32_t o = p.marking[place];
+                        uint32_t n = state.marking()[place];
+                        if(o == n) continue;
+                        _changed.push_back(place);
+                        sum = sum - o + n;
+                        if(o == 0) ++active;
+                        else if(n == 0) --active;
+                        if(o != 0 && o == max) --nmax;
+                        if(n > max)
+                        {
+                            max = n;
+                            nmax = 1;
+                        }
+                        else if(n != 0 && n == max)
+                            ++nmax;
+                    }
+                };
+                auto pre = _net.preset(transition);
+                visit(pre.first, pre.second);
+                auto post = _net.postset(transition);
+                visit(post.first, post.second);
+
+                // the last place holding the maximum lost tokens
+                if(active > 0 && nmax == 0)
+                {
+                    max = 0;
+                    for(size_t i = 0; i < _nplaces; ++i)
+                    {
+                        auto v = state.marking()[i];
+                        if(v > max)
+                        {
+                            max = v;
+                            nmax = 1;
+                        }
+                        else if(v != 0 && v == max)
+                            ++nmax;
+                    }
+                }
+                else if(active == 0)
+                    max = 0;
+
+                if (_maxTokens < sum)
+                    _maxTokens = sum;
+
+                //Check that we're within k-bound
+                if (_kbound != 0 && sum > _kbound)
+                    return std::pair<bool, size_t>(false, std::numeric_limits<size_t>::max());
+
+                bool allsame = (uint64_t)sum == (uint64_t)active * max;
+                unsigned char type = _encoder.getType(sum, active, allsame, max);
+
+                // positional encodings of the same type only differ in the changed places
+                bool patch = p.encoding[0] == type && _encoder.positional(type);
+                const unsigned char* data;
+                size_t length;
+                if(patch)
+                {
+                    for(auto place : _changed)
+                        _encoder.patch(p.encoding.data(), place, state.marking()[place]);
+                    data = p.encoding.data();
+                    length = p.encoding.size();
+                }
+                else
+                {
+                    length = _encoder.encode(state.marking(), type);
+                    data = _encoder.scratchpad().const_raw();
+                }
+                if(length*8 >= std::numeric_limits<uint16_t>::max())
+                {
+                    throw base_error("Marking could not be encoded into less than 2^16 bytes, current limit of PTries");
+                }
+                auto tit = _trie.insert(data, length);
+                if(patch)
+                {
+                    for(auto place : _changed)
+                        _encoder.patch(p.encoding.data(), place, p.marking[place]);
+                }
+
+                if(!tit.first)
+                {
+                    return std::pair<bool, size_t>(false, tit.second);
                 }
 
 #ifdef DEBUG
-                if(_trie.size() % 100000 == 0) std::cout << "Inserted " << _trie.size() << std::endl;
+                _dbg.push_back(new uint32_t[_net.numberOfPlaces()]);
+                memcpy(_dbg.back(), state.marking(), _net.numberOfPlaces()*sizeof(uint32_t));
 #endif
+
+                // the parent already contributed to the bounds of the untouched places
+                for(auto place : _changed)
+                {
+                    _maxPlaceBound[place] = std::max<MarkVal>(state.marking()[place],
+                                                              _maxPlaceBound[place]);
+                }
                 return std::pair<bool, size_t>(true, tit.second);
             }
 
+            void cacheParent(size_t id, const uint32_t* marking, size_t length)
+            {
+                auto& p = _parentCache;
+                p.id = id;
+                p.marking.assign(marking, marking + _nplaces);
+                p.encoding.assign(_encoder.scratchpad().const_raw(), _encoder.scratchpad().const_raw() + length);
+                p.sum = 0;
+                p.active = 0;
+                p.max = 0;
+                p.nmax = 0;
+                for(size_t i = 0; i < _nplaces; ++i)
+                {
+                    auto v = marking[i];
+                    if(v == 0) continue;
+                    ++p.active;
+                    p.sum += v;
+                    if(v > p.max)
+                    {
+                        p.max = v;
+                        p.nmax = 1;
+                    }
+                    else if(v == p.max)
+                        ++p.nmax;
+                }
+                _touched.resize(_nplaces, 0);
+            }
+
             template <typename T>
             std::pair<bool, size_t> _lookup(const State& state, T& _trie) {
                 MarkVal sum = 0;
@@ -189,21 +419,12 @@ namespace PetriEngine {
 
             void markingStats(const uint32_t* marking, MarkVal& sum, bool& allsame, uint32_t& val, uint32_t& active, uint32_t& last)
             {
-                uint32_t cnt = 0;
-
-                for (uint32_t i = 0; i < _nplaces; i++)
-                {
-                    uint32_t old = val;
-                    if(marking[i] != 0)
-                    {
-                        ++cnt;
-                        last = std::max(last, i);
-                        val = std::max(marking[i], val);
-                        if(old != 0 && marking[i] != old) allsame = false;
-                        ++active;
-                        sum += marking[i];
-                    }
-                }
+                auto stats = MarkingKernels::stats(marking, _nplaces);
+                sum = stats.sum;
+                allsame = stats.allsame;
+                val = stats.max;
+                active = stats.active;
+                last = stats.last;
             }
         };
 
@@ -221,6 +442,11 @@ namespace PetriEngine {
                 return _add(state, _trie);
             }
 
+            virtual std::pair<bool, size_t> addSuccessor(const State& state, size_t parent, uint32_t transition) override
+            {
+                return _addSuccessor(state, parent, transition, _trie);
+            }
+
             virtual void decode(State& state, size_t id) override
             {
                 _decode(state, id, _trie);
@@ -243,6 +469,16 @@ namespace PetriEngine {
                 return _trie.size();
             }
 
+            virtual void write(std::ostream& out) override
+            {
+                _write(out, _trie);
+            }
+
+            virtual void read(std::istream& in) override
+            {
+                _read(in, _trie);
+            }
+
         private:
             ptrie_t _trie;
         };
@@ -260,6 +496,11 @@ namespace PetriEngine {
                 return _add(state, _trie);
             }
 
+            virtual std::pair<bool, size_t> addSuccessor(const State& state, size_t parent, uint32_t transition) override
+            {
+                return _addSuccessor(state, parent, transition, _trie);
+            }
+
             virtual void decode(State& state, size_t id) override
             {
                 _decode(state, id, _trie);
@@ -293,8 +534,8 @@ namespace PetriEngine {
 
         struct traceable_t
         {
-            ptrie::uint parent;
-            ptrie::uint transition;
+            stored_id_t parent;
+            stored_transition_t transition;
         };
 
         class TracableStateSet : public AnnotatedStateSet<traceable_t>
@@ -322,6 +563,20 @@ namespace PetriEngine {
                 return std::pair<size_t, size_t>(t.parent, t.transition);
             }
 
+            virtual void write(std::ostream& out) override
+            {
+                _write(out, _trie);
+                for(size_t id = 0; id < _trie.size(); ++id)
+                    out.write(reinterpret_cast<const char*>(&get_data(id)), sizeof(traceable_t));
+            }
+
+            virtual void read(std::istream& in) override
+            {
+                _read(in, _trie);
+                for(size_t id = 0; id < _trie.size(); ++id)
+                    in.read(reinterpret_cast<char*>(&get_data(id)), sizeof(traceable_t));
+            }
+
         private:
             size_t _parent = 0;
         };
@@ -0,0 +1,92 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef WORKSTEALINGQUEUE_H
+#define WORKSTEALINGQUEUE_H
+
+#include "Queue.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        /**
+         * Wraps one search queue of type Q per worker. A worker pushes to and
+         * pops from its own queue, and only when that runs dry it attempts to
+         * steal from the queues of the other workers.
+         *
+         * Termination is detected by counting the states which have been
+         * pushed but not yet fully expanded; a worker must call expanded()
+         * once all successors of a popped state have been pushed.
+         */
+        template<typename Q>
+        class WorkStealingQueue {
+        private:
+            struct local_t {
+                local_t(size_t seed) : _queue(seed) {}
+                std::mutex _lock;
+                Q _queue;
+            };
+        public:
+            WorkStealingQueue(uint32_t workers, size_t seed)
+            {
+                for(uint32_t w = 0; w < std::max<uint32_t>(workers, 1); ++w)
+                    _locals.emplace_back(std::make_unique<local_t>(seed + w));
+            }
+
+            template<typename... Args>
+            void push(uint32_t worker, size_t id, Args&&... args)
+            {
+                ++_pending;
+                auto& l = *_locals[worker];
+                std::lock_guard<std::mutex> guard(l._lock);
+                l._queue.push(id, std::forward<Args>(args)...);
+            }
+
+            size_t pop(uint32_t worker)
+            {
+                for(size_t n = 0; n < _locals.size(); ++n)
+                {
+                    auto& l = *_locals[(worker + n) % _locals.size()];
+                    std::lock_guard<std::mutex> guard(l._lock);
+                    auto id = l._queue.pop();
+                    if(id != Queue::EMPTY)
+                        return id;
+                }
+                return Queue::EMPTY;
+            }
+
+            void expanded()
+            {
+                --_pending;
+            }
+
+            bool finished() const
+            {
+                return _pending == 0;
+            }
+
+        private:
+            std::vector<std::unique_ptr<local_t>> _locals;
+            std::atomic<size_t> _pending = 0;
+        };
+    }
+}
+
+#endif // WORKSTEALINGQUEUE_H
@@ -21,6 +21,9 @@
 
 #include "PetriEngine/Stubborn/StubbornSet.h"
 #include "InterestingTransitionVisitor.h"
+#include "PetriEngine/PQL/AtomicCache.h"
+
+#include <mutex>
 
 namespace PetriEngine {
     class ReachabilityStubbornSet : public StubbornSet {
@@ -43,10 +46,27 @@ namespace PetriEngine {
             _interesting = std::make_unique<TVisitor>(*this, _closure);
         }
 
+        /**
+         * Evaluating the queries annotates the shared query-objects, so when
+         * several stubborn sets share the queries this lock must be provided.
+         */
+        void setQueryLock(std::mutex* lock)
+        {
+            _query_lock = lock;
+        }
+
+        /** Read the atomic propositions of the queries from atoms, evaluated in the prepared marking */
+        void setAtoms(const PQL::AtomicCache* atoms)
+        {
+            _atoms = atoms;
+        }
+
     private:
         std::unique_ptr<InterestingTransitionVisitor> _interesting;
 
         bool _closure;
+        std::mutex* _query_lock = nullptr;
+        const PQL::AtomicCache* _atoms = nullptr;
     };
 }
 
@@ -19,10 +19,13 @@
 #define VERIFYPN_STUBBORNSET_H
 
 #include "PetriEngine/PetriNet.h"
+#include "PetriEngine/EnabledTransitions.h"
 #include "PetriEngine/Structures/State.h"
+#include "utils/structures/light_bitset.h"
 #include "utils/structures/light_deque.h"
 #include "PetriEngine/PQL/PQL.h"
 
+#include <cassert>
 #include <memory>
 #include <vector>
 
@@ -30,10 +33,8 @@ namespace PetriEngine {
     class StubbornSet {
     public:
         StubbornSet(const PetriEngine::PetriNet &net)
-                : _net(net), _inhibpost(net._nplaces) {
+                : _net(net), _enabled(net._ntransitions), _stubborn(net._ntransitions) {
             _current = 0;
-            _enabled = std::make_unique<bool[]>(net._ntransitions);
-            _stubborn = std::make_unique<bool[]>(net._ntransitions);
             _dependency = std::make_unique<uint32_t[]>(net._ntransitions);
             _places_seen = std::make_unique<uint8_t[]>(_net.numberOfPlaces());
             StubbornSet::reset();
@@ -98,13 +99,20 @@ namespace PetriEngine {
         }
 
         void setQueries(std::vector<PQL::Condition*> conds) {
-            _queries = conds;
+            _queries = std::move(conds);
         }
 
         [[nodiscard]] size_t nenabled() const { return _nenabled; }
 
-        [[nodiscard]] bool *enabled() const { return _enabled.get(); };
-        [[nodiscard]] bool *stubborn() const { return _stubborn.get(); };
+        /**
+         * The transitions enabled in the next prepared marking, as computed
+         * by EnabledTransitions, sparing the scan of the marking; nullptr to
+         * compute them from the marking.
+         */
+        void setEnabled(const uint64_t* enabled) { _knownEnabled = enabled; }
+
+        [[nodiscard]] const light_bitset &enabled() const { return _enabled; };
+        [[nodiscard]] const light_bitset &stubborn() const { return _stubborn; };
 
         const PetriEngine::PetriNet &_net;
 
@@ -119,6 +127,22 @@ namespace PetriEngine {
             uint32_t pre, post;
         };
 
+        // a word of a set of transitions, sets are stored as their non-zero words
+        struct mask_t {
+            uint32_t word;
+            light_bitset::word_t bits;
+        };
+
+        // a set of transitions per place
+        struct place_masks_t {
+            std::vector<uint32_t> offsets;
+            std::vector<mask_t> masks;
+
+            std::pair<const mask_t *, const mask_t *> operator[](uint32_t place) const {
+                return {masks.data() + offsets[place], masks.data() + offsets[place + 1]};
+            }
+        };
+
         struct trans_t {
             uint32_t index;
             int8_t direction;
@@ -151,6 +175,20 @@ namespace PetriEngine {
 
         virtual void addToStub(uint32_t t);
 
+        void addToStub(std::pair<const mask_t *, const mask_t *> masks);
+
+        void markSeen(uint32_t place, uint8_t flags) {
+            if (_places_seen[place] == 0)
+                _seen.push_back(place);
+            _places_seen[place] |= flags;
+        }
+
+        void resetSeen() {
+            for (auto p : _seen)
+                _places_seen[p] = 0;
+            _seen.clear();
+        }
+
         template <typename T = std::nullptr_t>
         void closure(T&& callback = nullptr) {
             while (!_unprocessed.empty()) {
@@ -162,11 +200,8 @@ namespace PetriEngine {
                 auto [finv, linv] = _net.preset(tr);
                 if (_enabled[tr]) {
                     for (; finv < linv; ++finv) {
-                        if (finv->direction < 0) {
-                            auto place = finv->place;
-                            for (uint32_t t = _places[place].post; t < _places[place + 1].pre; t++)
-                                addToStub(_arcs[t].index);
-                        }
+                        if (finv->direction < 0)
+                            addToStub(_consumers[finv->place]);
                     }
                     if (_netContainsInhibitorArcs) {
                         auto [linv, ninv] = _net.postset(tr);
@@ -226,23 +261,44 @@ namespace PetriEngine {
             }
         }
 
-        std::unique_ptr<bool[]> _enabled, _stubborn;
+        light_bitset _enabled, _stubborn;
         size_t _nenabled;
         std::unique_ptr<uint8_t[]> _places_seen;
+        std::vector<uint32_t> _seen; // the places with non-zero _places_seen, to reset
         std::unique_ptr<place_t[]> _places;
         std::unique_ptr<trans_t[]> _arcs;
+        // producers, consumers, decreasing consumers and inhibited transitions of each place
+        place_masks_t _producers, _consumers, _decreasing, _inhibited;
         light_deque<uint32_t> _unprocessed, _ordering;
         std::unique_ptr<uint32_t[]> _dependency;
         bool _netContainsInhibitorArcs, _done;
-        std::vector<std::vector<uint32_t>> _inhibpost;
+        // Whether the masks of a place are ORed into _stubborn directly. Subclasses
+        // overriding addToStub must clear it, addToStub then sees every transition.
+        bool _orMasks = true;
 
         std::vector<PQL::Condition *> _queries;
+        const uint64_t* _knownEnabled = nullptr;
 
         template <typename T = std::nullptr_t>
         void constructEnabled(T&& callback = nullptr){
             _ordering.clear();
-            memset(_enabled.get(), 0, _net.numberOfTransitions());
-            memset(_stubborn.get(), 0, _net.numberOfTransitions());
+            _enabled.clear();
+            _stubborn.clear();
+            if (_knownEnabled != nullptr) {
+                const uint32_t ntrans = _net.numberOfTransitions();
+                for (uint32_t t = EnabledTransitions::next(_knownEnabled, 0, ntrans);
+                     t != EnabledTransitions::NONE;
+                     t = EnabledTransitions::next(_knownEnabled, t + 1, ntrans)) {
+                    assert(checkPreset(t));
+                    if constexpr (!std::is_null_pointer_v<T>)
+                        if(!callback(t))
+                            return;
+                    _enabled[t] = true;
+                    _ordering.push_back(t);
+                    ++_nenabled;
+                }
+                return;
+            }
             for (uint32_t p = 0; p < _net.numberOfPlaces(); ++p) {
                 // orphans are currently under "place 0" as a special case
                 if (p == 0 || _parent->marking()[p] > 0) {
@@ -271,7 +327,7 @@ namespace PetriEngine {
         void checkForInhibitor();
 
         void set_all_stubborn() {
-            std::fill(_stubborn.get(), _stubborn.get() + _net.numberOfTransitions(), true);
+            _stubborn.set();
             _done = true;
         }
     };
@@ -15,12 +15,47 @@
 #define SUCCESSORGENERATOR_H
 
 #include "PetriNet.h"
+#include "EnabledTransitions.h"
 #include "Structures/State.h"
+#include <cassert>
 #include <memory>
 #include "Stubborn/StubbornSet.h"
 
 namespace PetriEngine {
 
+    /**
+     * Successor markings of one parent, generated together into a single
+     * contiguous buffer. Each is seen as a state whose marking lives in the
+     * buffer, valid until the batch is generated into again.
+     */
+    class SuccessorBatch {
+    public:
+        SuccessorBatch(uint32_t nplaces, size_t capacity);
+        ~SuccessorBatch();
+
+        SuccessorBatch(const SuccessorBatch&) = delete;
+        SuccessorBatch& operator=(const SuccessorBatch&) = delete;
+
+        size_t size() const { return _size; }
+        size_t capacity() const { return _states.size(); }
+
+        Structures::State& operator[](size_t i) { return _states[i]; }
+        const Structures::State& operator[](size_t i) const { return _states[i]; }
+
+        /** The transition fired to obtain the i'th successor */
+        uint32_t transition(size_t i) const { return _transitions[i]; }
+
+    private:
+        friend class SuccessorGenerator;
+        friend class ReducingSuccessorGenerator;
+
+        std::vector<MarkVal> _markings;
+        // views of _markings, released rather than freed
+        std::vector<Structures::State> _states;
+        std::vector<uint32_t> _transitions;
+        size_t _size = 0;
+    };
+
     class SuccessorGenerator {
 public:
     SuccessorGenerator(const PetriNet& net);
@@ -42,6 +77,13 @@ public:
         return _next(write, [](size_t){ return true; });
     }
 
+    /**
+     * Generates the following successors of the prepared marking into
+     * batch, as many as fit, in the order of next(write).
+     * @return the number of successors generated, 0 when there are no more
+     */
+    virtual size_t next(SuccessorBatch& batch);
+
     uint32_t fired() const
     {
         return _suc_tcounter == std::numeric_limits<uint32_t>::max() ? std::numeric_limits<uint32_t>::max() : _suc_tcounter - 1;
@@ -55,6 +97,14 @@ public:
 
     void reset();
 
+    /**
+     * Limits the successors of the following prepared markings to the
+     * transitions set in enabled, which must hold exactly the transitions
+     * enabled in these markings (see EnabledTransitions). Successors are
+     * generated in the same order as without; nullptr disables it again.
+     */
+    void setEnabled(const uint64_t* enabled) { _enabled = enabled; }
+
     /**
      * Checks if the conditions are met for fireing t, if write != NULL,
      * then also consumes tokens from write while checking
@@ -65,7 +115,9 @@ public:
     bool checkPreset(uint32_t t);
 
     /**
-     * Consumes tokens in preset of t without from marking write checking
+     * Consumes tokens in preset of t without from marking write checking.
+     * Arcs to and from the same place are merged, so only the net loss of
+     * tokens is consumed; producePostset then adds the net gain.
      * @param write, a marking to consume from
      * @param t, a transition to fire
      */
@@ -85,6 +137,22 @@ protected:
 
     template<typename T>
     bool _next(Structures::State& write, T&& predicate) {
+        if (_enabled != nullptr) {
+            // transitions are grouped by place in increasing order, so this
+            // is the order of the scan below
+            uint32_t t = _suc_tcounter == std::numeric_limits<uint32_t>::max() ? 0 : _suc_tcounter;
+            for (t = EnabledTransitions::next(_enabled, t, _net._ntransitions);
+                 t != EnabledTransitions::NONE;
+                 t = EnabledTransitions::next(_enabled, t + 1, _net._ntransitions)) {
+                assert(checkPreset(t));
+                if (!predicate(t)) continue;
+                _fire(write, t); // <-- also updated _suc_tcounter
+                return true;
+            }
+            _suc_pcounter = _net._nplaces;
+            _suc_tcounter = std::numeric_limits<uint32_t>::max();
+            return false;
+        }
         for (; _suc_pcounter < _net._nplaces; ++_suc_pcounter) {
             // orphans are currently under "place 0" as a special case
             if (_suc_pcounter == 0 || (*_parent).marking()[_suc_pcounter] > 0) {
@@ -107,6 +175,7 @@ protected:
     }
 
     const Structures::State* _parent;
+    const uint64_t* _enabled = nullptr;
 
     uint32_t _suc_pcounter;
     uint32_t _suc_tcounter;
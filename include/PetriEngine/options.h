@@ -54,6 +54,17 @@ struct options_t {
     uint32_t siphontrapTimeout = 0;
     uint32_t siphonDepth = 0;
     uint32_t cores = 1;
+    uint32_t swarm = 0; // number of independent reachability searches, 0 ... disabled
+    size_t memoryLimit = 0; // in MB, 0 ... disabled
+    uint32_t bitstate = 0; // log2 of the bitstate size, 0 ... disabled
+    uint32_t bitstateHashes = 3;
+    size_t bitstateFrontier = 1 << 22;
+    std::string externalDirectory; // empty ... disabled
+    size_t externalBuffer = 256; // in MB
+    std::string checkpointFile; // empty ... disabled
+    size_t checkpointInterval = 600; // in seconds
+    std::string resumeFile; // empty ... start from the initial marking
+    size_t enabledCache = 64; // in MB, 0 ... disabled
     bool doVerification = true;
     bool doUnfolding = true;
 
@@ -0,0 +1,151 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * File:   MemoryLimit.h
+ *
+ * Process-wide memory limit. Rather than instrumenting every allocator
+ * (the ptrie nodes, the dependency-graph buckets, the queues, ...) the
+ * resident set size of the process is sampled, which accounts for all of
+ * them at once. Searches poll check() in their main loop and stop once the
+ * limit is exhausted, leaving the open queries unanswered. Exhaustion lasts
+ * until the next reset(), which the engines call before each query.
+ */
+
+#ifndef MEMORYLIMIT_H
+#define MEMORYLIMIT_H
+
+#include "errors.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#if defined(__linux__)
+#include <cstdio>
+#include <unistd.h>
+#elif defined(__APPLE__)
+#include <mach/mach.h>
+#elif defined(_WIN32)
+#define PSAPI_VERSION 2
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#endif
+
+struct memory_limit_error : public base_error {
+    memory_limit_error() : base_error("Memory limit exceeded") {}
+};
+
+class MemoryLimit {
+public:
+    /** Sets the limit in megabytes, 0 disables the limit */
+    static void set(size_t megabytes)
+    {
+        _limit = megabytes * 1024 * 1024;
+        _exhausted = false;
+    }
+
+    static bool enabled()
+    {
+        return _limit != 0;
+    }
+
+    /** True once a search has run into the limit, until the next reset() */
+    static bool exhausted()
+    {
+        return _exhausted;
+    }
+
+    /**
+     * Called before each query, so running into the limit only stops the
+     * search for that query. The resident size is sampled at once, so a
+     * query starting with the memory still in use above the limit stops at
+     * its first check().
+     */
+    static void reset()
+    {
+        _exhausted = _limit != 0 && resident() >= _limit;
+    }
+
+    /** Resident set size of the process in bytes, 0 if unsupported */
+    static size_t resident()
+    {
+#if defined(__linux__)
+        FILE* f = fopen("/proc/self/statm", "r");
+        if(f == nullptr) return 0;
+        unsigned long size = 0, rss = 0;
+        int read = fscanf(f, "%lu %lu", &size, &rss);
+        fclose(f);
+        if(read != 2) return 0;
+        return rss * (size_t)sysconf(_SC_PAGESIZE);
+#elif defined(__APPLE__)
+        mach_task_basic_info info;
+        mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+        if(task_info(mach_task_self(), MACH_TASK_BASIC_INFO, (task_info_t)&info, &count) != KERN_SUCCESS)
+            return 0;
+        return info.resident_size;
+#elif defined(_WIN32)
+        PROCESS_MEMORY_COUNTERS info;
+        if(!GetProcessMemoryInfo(GetCurrentProcess(), &info, sizeof(info)))
+            return 0;
+        return info.WorkingSetSize;
+#else
+        return 0;
+#endif
+    }
+
+    /**
+     * Cheap enough for the inner loop of a search; the resident size is only
+     * sampled every 4096 calls (per thread).
+     * @return true if the search should stop.
+     */
+    static bool check()
+    {
+        if(_limit == 0) return false;
+        if(_exhausted) return true;
+        thread_local uint32_t calls = 0;
+        if((++calls & 4095) != 0) return false;
+        if(resident() >= _limit)
+            _exhausted = true;
+        return _exhausted;
+    }
+
+    /** Reports a query left open because the limit was exhausted (or for another reason) */
+    static void printUnsolved(std::ostream& out, const std::string& name, size_t index,
+                              const char* reason = "within the memory limit")
+    {
+        out << "\nFORMULA " << name << " CANNOT_COMPUTE\n\n"
+            << "Query index " << index << " could not be solved " << reason << "\n" << std::endl;
+    }
+
+    /** As check(), but throws memory_limit_error for engines without a clean exit */
+    static void enforce()
+    {
+        if(check())
+            throw memory_limit_error();
+    }
+
+private:
+    static inline std::atomic<size_t> _limit = 0;
+    static inline std::atomic<bool> _exhausted = false;
+};
+
+#endif /* MEMORYLIMIT_H */
@@ -0,0 +1,161 @@
+/*
+ * File:   light_bitset.h
+ *
+ * Fixed-size set of bits stored in 64-bit words, which remembers the words
+ * it has written since the last clear. Clearing it only touches those
+ * words, so a set which is refilled for every state of a search costs in
+ * proportion to what was set rather than to its size.
+ */
+
+#ifndef LIGHT_BITSET_H
+#define LIGHT_BITSET_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class light_bitset
+{
+    public:
+        using word_t = uint64_t;
+        static constexpr size_t BITS = 64;
+
+        class reference {
+            public:
+                reference(light_bitset& set, size_t index) : _set(set), _index(index) {}
+
+                operator bool() const { return _set.test(_index); }
+
+                reference& operator=(bool value)
+                {
+                    if(value) _set.set(_index);
+                    else _set.reset(_index);
+                    return *this;
+                }
+
+                reference& operator=(const reference& other)
+                {
+                    return *this = (bool)other;
+                }
+
+            private:
+                light_bitset& _set;
+                size_t _index;
+        };
+
+        light_bitset(size_t size = 0)
+        : _size(size), _data((size + BITS - 1) / BITS, 0) {}
+
+        size_t size() const { return _size; }
+        size_t words() const { return _data.size(); }
+        const word_t* data() const { return _data.data(); }
+
+        bool test(size_t index) const
+        {
+            return (_data[index / BITS] >> (index % BITS)) & 1;
+        }
+
+        bool operator[](size_t index) const { return test(index); }
+        reference operator[](size_t index) { return reference(*this, index); }
+
+        void set(size_t index)
+        {
+            or_word(index / BITS, word_t{1} << (index % BITS));
+        }
+
+        void reset(size_t index)
+        {
+            _data[index / BITS] &= ~(word_t{1} << (index % BITS));
+        }
+
+        /**
+         * Sets the given bits of word w.
+         * @return the bits which were not set before.
+         */
+        word_t or_word(size_t w, word_t bits)
+        {
+            word_t old = _data[w];
+            if(old == 0 && bits != 0) touch(w);
+            _data[w] = old | bits;
+            return bits & ~old;
+        }
+
+        word_t word(size_t w) const { return _data[w]; }
+
+        /** Sets all bits */
+        void set()
+        {
+            if(_data.empty()) return;
+            std::fill(_data.begin(), _data.end(), ~word_t{0});
+            if(_size % BITS != 0)
+                _data.back() = (word_t{1} << (_size % BITS)) - 1;
+            _full = true;
+            _touched.clear();
+        }
+
+        /** Clears all bits, only visiting the words written since the last clear */
+        void clear()
+        {
+            if(_full)
+                std::fill(_data.begin(), _data.end(), 0);
+            else
+                for(auto w : _touched)
+                    _data[w] = 0;
+            _touched.clear();
+            _full = false;
+        }
+
+        bool intersects(const light_bitset& other) const
+        {
+            size_t n = std::min(words(), other.words());
+            for(size_t w = 0; w < n; ++w)
+                if(_data[w] & other._data[w]) return true;
+            return false;
+        }
+
+        /** The first set bit at index or above, size() if there is none */
+        size_t next(size_t index) const
+        {
+            if(index >= _size) return _size;
+            size_t w = index / BITS;
+            word_t word = _data[w] & (~word_t{0} << (index % BITS));
+            while(word == 0)
+            {
+                if(++w == _data.size()) return _size;
+                word = _data[w];
+            }
+            return w * BITS + __builtin_ctzll(word);
+        }
+
+        void swap(light_bitset& other)
+        {
+            std::swap(_size, other._size);
+            _data.swap(other._data);
+            _touched.swap(other._touched);
+            std::swap(_full, other._full);
+        }
+
+    private:
+        void touch(size_t w)
+        {
+            if(_full) return;
+            // a word cleared and set again is listed twice, past the number of
+            // words clearing them all is cheaper anyway
+            if(_touched.size() >= _data.size())
+            {
+                _full = true;
+                _touched.clear();
+            }
+            else
+                _touched.push_back(w);
+        }
+
+        size_t _size;
+        std::vector<word_t> _data;
+        std::vector<uint32_t> _touched;
+        bool _full = false;
+};
+
+#endif /* LIGHT_BITSET_H */
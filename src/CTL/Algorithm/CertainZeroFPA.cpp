@@ -1,5 +1,7 @@
 #include "CTL/Algorithm/CertainZeroFPA.h"
+#include "utils/MemoryLimit.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
@@ -12,6 +14,8 @@ bool Algorithm::CertainZeroFPA::search(DependencyGraph::BasicDependencyGraph &t_
 
 
     vertex = graph->initialConfiguration();
+    // the graph may know the answer already
+    if(vertex->isDone()) return vertex->assignment == ONE;
     {
         explore(vertex);
     }
@@ -21,6 +25,7 @@ bool Algorithm::CertainZeroFPA::search(DependencyGraph::BasicDependencyGraph &t_
     {
         while (auto e = strategy->popEdge(false))
         {
+            MemoryLimit::enforce();
             ++e->refcnt;
             assert(e->refcnt >= 1);
             checkEdge(e);
@@ -72,35 +77,24 @@ void Algorithm::CertainZeroFPA::checkEdge(Edge* e, bool only_assign)
     bool hasCZero = false;
     //auto pre_empty = e->targets.empty();
     Configuration *lastUndecided = nullptr;
+    // targets assigned ONE need not be checked again
+    e->targets.erase(std::remove_if(e->targets.begin(), e->targets.end(),
+        [](Configuration* c) { return c->assignment == ONE; }), e->targets.end());
+    for(auto t : e->targets.reversed())
     {
-        auto it = e->targets.begin();
-        auto pit = e->targets.before_begin();
-        while(it != e->targets.end())
+        allOne = false;
+        if (t->assignment == CZERO) {
+            hasCZero = true;
+            //assert(e->assignment == CZERO || only_assign);
+            break;
+        }
+        else if(lastUndecided == nullptr)
         {
-            if ((*it)->assignment == ONE)
-            {
-                e->targets.erase_after(pit);
-                it = pit;
-            }
-            else
-            {
-                allOne = false;
-                if ((*it)->assignment == CZERO) {
-                    hasCZero = true;
-                    //assert(e->assignment == CZERO || only_assign);
-                    break;
-                }
-                else if(lastUndecided == nullptr)
-                {
-                    lastUndecided = *it;
-                }
-                else if(lastUndecided != nullptr && lastUndecided->assignment == UNKNOWN && (*it)->assignment == ZERO)
-                {
-                    lastUndecided = *it;
-                }
-            }
-            pit = it;
-            ++it;
+            lastUndecided = t;
+        }
+        else if(lastUndecided != nullptr && lastUndecided->assignment == UNKNOWN && t->assignment == ZERO)
+        {
+            lastUndecided = t;
         }
     }
     /*if(e->targets.empty())
@@ -158,7 +152,7 @@ void Algorithm::CertainZeroFPA::checkEdge(Edge* e, bool only_assign)
             if(!e->processed) {
                 if(!lastUndecided->isDone())
                 {
-                    for (auto t : e->targets)
+                    for (auto t : e->targets.reversed())
                         t->addDependency(e);
                 }
             }
@@ -217,7 +211,7 @@ void Algorithm::CertainZeroFPA::explore(Configuration *c)
     c->assignment = ZERO;
 
     {
-        auto succs = graph->successors(c);
+        auto& succs = graph->successors(c);
         c->nsuccs = succs.size();
 
         _exploredConfigurations += 1;
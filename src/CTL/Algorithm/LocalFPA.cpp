@@ -1,6 +1,7 @@
 #include "CTL/Algorithm/LocalFPA.h"
 #include "CTL/DependencyGraph/Configuration.h"
 #include "CTL/DependencyGraph/Edge.h"
+#include "utils/MemoryLimit.h"
 
 #include <cassert>
 #include <iostream>
@@ -11,11 +12,14 @@ bool Algorithm::LocalFPA::search(DependencyGraph::BasicDependencyGraph &t_graph)
     graph = &t_graph;
 
     Configuration *v = graph->initialConfiguration();
+    // the graph may know the answer already
+    if(v->isDone()) return v->assignment == ONE;
     explore(v);
 
     while (!strategy->empty())
     {
         while (auto e = strategy->popEdge()) {
+            MemoryLimit::enforce();
 
             if (v->assignment == DependencyGraph::ONE) {
                 break;
@@ -24,7 +28,7 @@ bool Algorithm::LocalFPA::search(DependencyGraph::BasicDependencyGraph &t_graph)
             bool allOne = true;
             Configuration *lastUndecided = nullptr;
 
-            for (DependencyGraph::Configuration *c : e->targets) {
+            for (DependencyGraph::Configuration *c : e->targets.reversed()) {
                 if (c->assignment != DependencyGraph::ONE) {
                     allOne = false;
                     lastUndecided = c;
@@ -95,7 +99,7 @@ void Algorithm::LocalFPA::explore(DependencyGraph::Configuration *c)
 {
     assert(c->assignment == DependencyGraph::UNKNOWN);
     c->assignment = DependencyGraph::ZERO;
-    auto succs = graph->successors(c);
+    auto& succs = graph->successors(c);
 
     for (DependencyGraph::Edge *succ : succs) {
         strategy->pushEdge(succ);
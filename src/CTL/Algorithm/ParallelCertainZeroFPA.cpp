@@ -0,0 +1,316 @@
+#include "CTL/Algorithm/ParallelCertainZeroFPA.h"
+#include "utils/MemoryLimit.h"
+
+#include <algorithm>
+#include <cassert>
+#include <thread>
+
+using namespace DependencyGraph;
+
+Algorithm::ParallelCertainZeroFPA::ParallelCertainZeroFPA(Strategy type, uint32_t workers)
+: FixedPointAlgorithm(type), _type(type), _nworkers(std::max<uint32_t>(workers, 1))
+{
+}
+
+bool Algorithm::ParallelCertainZeroFPA::search(DependencyGraph::BasicDependencyGraph &t_graph)
+{
+    graph = &t_graph;
+    auto nworkers = std::min(_nworkers, graph->workers());
+    for(uint32_t i = 0; i < nworkers; ++i)
+        _workers.emplace_back(std::make_unique<worker_t>(i));
+    _dependents = std::make_unique<linked_bucket_t<Dependent, 1024*64>>(nworkers);
+
+    vertex = graph->initialConfiguration();
+    if(claim(*_workers[0], vertex))
+        explore(*_workers[0], vertex);
+
+    if(!vertex->isDone())
+    {
+        std::vector<std::thread> threads;
+        for(auto& w : _workers)
+            threads.emplace_back([this, &w]() { run(*w); });
+        for(auto& t : threads)
+            t.join();
+    }
+
+    for(auto& w : _workers)
+    {
+        _processedEdges += w->processedEdges;
+        _processedNegationEdges += w->processedNegationEdges;
+        _exploredConfigurations += w->exploredConfigurations;
+        _numberOfEdges += w->numberOfEdges;
+    }
+    if(_error)
+        std::rethrow_exception(_error);
+    return vertex->assignment == ONE;
+}
+
+void Algorithm::ParallelCertainZeroFPA::run(worker_t& w)
+{
+    try {
+        while(!_stop && !vertex->isDone())
+        {
+            MemoryLimit::enforce();
+            if(auto e = pop(w))
+            {
+                checkEdge(w, e);
+                --_pending;
+            }
+            else if(_pending == 0)
+            {
+                if(!releaseNegations())
+                    break;
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+    catch(...)
+    {
+        std::lock_guard<std::mutex> guard(_negation_lock);
+        if(!_error) _error = std::current_exception();
+    }
+    _stop = true;
+}
+
+void Algorithm::ParallelCertainZeroFPA::checkEdge(worker_t& w, Edge* e, bool only_assign)
+{
+    auto source = e->source;
+    if(e->handled || source->isDone()) return;
+
+    bool allOne = true;
+    bool hasCZero = false;
+    Configuration *lastUndecided = nullptr;
+    for(auto t : e->targets.reversed())
+    {
+        int8_t a = t->assignment;
+        if(a == ONE) continue;
+        allOne = false;
+        if(a == CZERO)
+        {
+            hasCZero = true;
+            break;
+        }
+        if(lastUndecided == nullptr || (lastUndecided->assignment == UNKNOWN && a == ZERO))
+            lastUndecided = t;
+    }
+
+    if (e->is_negated) {
+        w.processedNegationEdges += 1;
+        if (allOne) {
+            fail(w, e);
+        } else if (hasCZero) {
+            finalAssign(w, source, ONE);
+        } else if (!only_assign) {
+            if (lastUndecided->assignment == ZERO && e->processed) {
+                // released with no edges pending anywhere
+                finalAssign(w, source, ONE);
+            } else if (!e->processed.exchange(true)) {
+                {
+                    std::lock_guard<std::mutex> guard(_negation_lock);
+                    _negations.push_back(e);
+                }
+                addDependency(w, e, lastUndecided);
+                if (claim(w, lastUndecided))
+                    explore(w, lastUndecided);
+            }
+        }
+    } else {
+        w.processedEdges += 1;
+        if (allOne) {
+            finalAssign(w, source, ONE);
+        } else if (hasCZero) {
+            fail(w, e);
+        } else if (!only_assign) {
+            if (!e->processed.exchange(true)) {
+                for (auto t : e->targets.reversed())
+                    addDependency(w, e, t);
+            }
+            if (claim(w, lastUndecided))
+                explore(w, lastUndecided);
+        }
+    }
+}
+
+void Algorithm::ParallelCertainZeroFPA::fail(worker_t& w, Edge* e)
+{
+    if(e->handled.exchange(true)) return;
+    if(--e->source->nsuccs == 0)
+        finalAssign(w, e->source, CZERO);
+}
+
+void Algorithm::ParallelCertainZeroFPA::finalAssign(worker_t& w, Configuration *c, Assignment a)
+{
+    assert(a == ONE || a == CZERO);
+    int8_t current = c->assignment;
+    do {
+        if(current == ONE || current == CZERO) return;
+    } while(!c->assignment.compare_exchange_weak(current, a));
+
+    for(auto d = c->closeDependents(); d != nullptr; d = d->next)
+    {
+        if(!d->edge->source->isDone())
+            push(w, d->edge, true);
+    }
+}
+
+bool Algorithm::ParallelCertainZeroFPA::claim(worker_t& w, Configuration *c)
+{
+    int8_t expected = UNKNOWN;
+    if(!c->assignment.compare_exchange_strong(expected, ZERO))
+        return false;
+    c->setOwner(w.index);
+    return true;
+}
+
+void Algorithm::ParallelCertainZeroFPA::explore(worker_t& w, Configuration *c)
+{
+    auto& succs = graph->successors(c, w.index);
+    c->nsuccs = succs.size();
+
+    w.exploredConfigurations += 1;
+    w.numberOfEdges += succs.size();
+
+    // the edges are not shared with other workers until pushed, so we can
+    // check if any of them determine the outcome already
+    for(auto i = succs.size(); i-- > 0 && !c->isDone();)
+        checkEdge(w, succs[i], true);
+    if(succs.empty())
+        finalAssign(w, c, CZERO);
+
+    auto end = succs.begin();
+    for(auto e : succs)
+    {
+        if(c->isDone() || e->handled)
+        {
+            --e->refcnt;
+            graph->release(e, w.index);
+        }
+        else
+            *end++ = e;
+    }
+    succs.erase(end, succs.end());
+    if(succs.empty()) return;
+
+    if(_type == Strategy::RDFS)
+        std::shuffle(succs.begin(), succs.end(), w.rng);
+    _pending += succs.size();
+    std::lock_guard<std::mutex> guard(w.lock);
+    w.waiting.insert(w.waiting.end(), succs.begin(), succs.end());
+}
+
+void Algorithm::ParallelCertainZeroFPA::addDependency(worker_t& w, Edge* e, Configuration *target)
+{
+    // no early return for decided targets, the closed list makes us recheck
+    target->raiseDistance(e->is_negated ? e->source->getDistance() + 1 : e->source->getDistance());
+    auto d = &(*_dependents)[_dependents->next(w.index)];
+    d->edge = e;
+    if(!target->addDependent(d))
+    {
+        // assigned since we looked, so nobody else will push the edge
+        _dependents->pop_back(w.index);
+        push(w, e, true);
+    }
+}
+
+void Algorithm::ParallelCertainZeroFPA::push(worker_t& w, Edge* e, bool dependency)
+{
+    ++_pending;
+    std::lock_guard<std::mutex> guard(w.lock);
+    if(dependency)
+        w.dependencies.push_back(e);
+    else
+        w.waiting.push_back(e);
+}
+
+Edge* Algorithm::ParallelCertainZeroFPA::pop(worker_t& w)
+{
+    {
+        std::lock_guard<std::mutex> guard(w.lock);
+        Edge* e = nullptr;
+        if(!w.dependencies.empty())
+        {
+            e = w.dependencies.back();
+            w.dependencies.pop_back();
+        }
+        else if(!w.waiting.empty())
+        {
+            // the sequential heuristic search also takes the oldest edge
+            if(_type == Strategy::BFS || _type == Strategy::HEUR)
+            {
+                e = w.waiting.front();
+                w.waiting.pop_front();
+            }
+            else
+            {
+                e = w.waiting.back();
+                w.waiting.pop_back();
+            }
+        }
+        if(e) return e;
+    }
+
+    // steal the oldest edges, which are the most likely to lead to more work
+    for(size_t n = 1; n < _workers.size(); ++n)
+    {
+        auto& other = *_workers[(w.index + n) % _workers.size()];
+        std::lock_guard<std::mutex> guard(other.lock);
+        auto& from = other.waiting.empty() ? other.dependencies : other.waiting;
+        if(!from.empty())
+        {
+            auto e = from.front();
+            from.pop_front();
+            return e;
+        }
+    }
+    return nullptr;
+}
+
+bool Algorithm::ParallelCertainZeroFPA::releaseNegations()
+{
+    std::lock_guard<std::mutex> guard(_negation_lock);
+    // another worker may have released some while we waited
+    if(_pending != 0 || _stop) return true;
+
+    auto decided = [](Edge* e) {
+        for(auto t : e->targets.reversed())
+            if(t->assignment != ONE)
+                return t->assignment == CZERO;
+        return true;
+    };
+
+    // first the negations which were decided since they were postponed
+    bool any = false;
+    size_t n = 0;
+    for(auto e : _negations)
+    {
+        if(e->source->isDone()) continue;
+        if(decided(e))
+        {
+            push(*_workers[e->source->getOwner()], e, true);
+            any = true;
+        }
+        else
+            _negations[n++] = e;
+    }
+    _negations.resize(n);
+    if(any) return true;
+    if(_negations.empty()) return false;
+
+    // then those furthest from the root, with their targets left at ZERO
+    uint32_t dist = 0;
+    for(auto e : _negations)
+        dist = std::max(dist, e->source->getDistance());
+    n = 0;
+    for(auto e : _negations)
+    {
+        if(e->source->getDistance() >= dist)
+            push(*_workers[e->source->getOwner()], e, false);
+        else
+            _negations[n++] = e;
+    }
+    _negations.resize(n);
+    return true;
+}
@@ -1,12 +1,15 @@
 #include "CTL/CTLEngine.h"
 
 #include "CTL/PetriNets/OnTheFlyDG.h"
+#include "CTL/PetriNets/SubformulaCache.h"
 #include "CTL/CTLResult.h"
 
 #include "CTL/Algorithm/CertainZeroFPA.h"
 #include "CTL/Algorithm/LocalFPA.h"
+#include "CTL/Algorithm/ParallelCertainZeroFPA.h"
 
 #include "utils/stopwatch.h"
+#include "utils/MemoryLimit.h"
 #include "PetriEngine/options.h"
 #include "PetriEngine/Reachability/ReachabilityResult.h"
 #include "PetriEngine/TAR/TARReachability.h"
@@ -27,7 +30,7 @@ using namespace PetriEngine::Reachability;
 using namespace PetriNets;
 
 ReturnValue getAlgorithm(std::shared_ptr<Algorithm::FixedPointAlgorithm>& algorithm,
-                         CTLAlgorithmType algorithmtype, Strategy search)
+                         CTLAlgorithmType algorithmtype, Strategy search, uint32_t workers)
 {
     switch(algorithmtype)
     {
@@ -35,7 +38,10 @@ ReturnValue getAlgorithm(std::shared_ptr<Algorithm::FixedPointAlgorithm>& algori
             algorithm = std::make_shared<Algorithm::LocalFPA>(search);
             break;
         case CTLAlgorithmType::CZero:
-            algorithm = std::make_shared<Algorithm::CertainZeroFPA>(search);
+            if(workers > 1)
+                algorithm = std::make_shared<Algorithm::ParallelCertainZeroFPA>(search, workers);
+            else
+                algorithm = std::make_shared<Algorithm::CertainZeroFPA>(search);
             break;
         default:
             throw base_error("Unknown or unsupported algorithm");
@@ -45,24 +51,31 @@ ReturnValue getAlgorithm(std::shared_ptr<Algorithm::FixedPointAlgorithm>& algori
 
 bool CTLSingleSolve(const Condition_ptr& query, PetriNet* net,
                  CTLAlgorithmType algorithmtype,
-                 Strategy strategytype, bool partial_order, CTLResult& result)
+                 Strategy strategytype, bool partial_order, CTLResult& result, uint32_t workers,
+                 SubformulaCache* cache)
 {
-    return CTLSingleSolve(query.get(), net, algorithmtype, strategytype, partial_order, result);
+    return CTLSingleSolve(query.get(), net, algorithmtype, strategytype, partial_order, result, workers, cache);
 }
 
 bool CTLSingleSolve(Condition* query, PetriNet* net,
                  CTLAlgorithmType algorithmtype,
-                 Strategy strategytype, bool partial_order, CTLResult& result)
+                 Strategy strategytype, bool partial_order, CTLResult& result, uint32_t workers,
+                 SubformulaCache* cache)
 {
-    OnTheFlyDG graph(net, partial_order);
+    // only the certain-zero algorithm runs in parallel
+    if(algorithmtype != CTLAlgorithmType::CZero)
+        workers = 1;
+    OnTheFlyDG graph(net, partial_order, workers, cache);
     graph.setQuery(query);
     std::shared_ptr<Algorithm::FixedPointAlgorithm> alg = nullptr;
-    getAlgorithm(alg, algorithmtype,  strategytype);
+    getAlgorithm(alg, algorithmtype,  strategytype, workers);
 
     stopwatch timer;
     timer.start();
     auto res = alg->search(graph);
     timer.stop();
+    if(cache)
+        graph.cacheResults();
 
     result.duration += timer.duration();
     result.numberOfConfigurations += graph.configurationCount();
@@ -77,7 +90,8 @@ bool CTLSingleSolve(Condition* query, PetriNet* net,
 
 bool recursiveSolve(const Condition_ptr& query, PetriNet* net,
                     CTLAlgorithmType algorithmtype,
-                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options);
+                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options,
+                    SubformulaCache* cache);
 
 class SimpleResultHandler : public AbstractHandler
 {
@@ -143,7 +157,8 @@ class ResultHandler : public SimpleResultHandler {
 
 bool solveLogicalCondition(LogicalCondition* query, bool is_conj, PetriNet* net,
                            CTLAlgorithmType algorithmtype,
-                           Strategy strategytype, bool partial_order, CTLResult& result, options_t& options)
+                           Strategy strategytype, bool partial_order, CTLResult& result, options_t& options,
+                           SubformulaCache* cache)
 {
     std::vector<int8_t> state(query->size(), 0);
     std::vector<int8_t> lstate;
@@ -202,7 +217,7 @@ bool solveLogicalCondition(LogicalCondition* query, bool is_conj, PetriNet* net,
     for(size_t i = 0; i < query->size(); ++i) {
         if (state[i] == 0)
         {
-            if(recursiveSolve((*query)[i], net, algorithmtype, strategytype, partial_order, result, options) xor is_conj)
+            if(recursiveSolve((*query)[i], net, algorithmtype, strategytype, partial_order, result, options, cache) xor is_conj)
             {
                 return !is_conj;
             }
@@ -213,30 +228,33 @@ bool solveLogicalCondition(LogicalCondition* query, bool is_conj, PetriNet* net,
 
 bool recursiveSolve(Condition* query, PetriEngine::PetriNet* net,
                     CTL::CTLAlgorithmType algorithmtype,
-                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options);
+                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options,
+                    SubformulaCache* cache);
 
 bool recursiveSolve(const Condition_ptr& query, PetriEngine::PetriNet* net,
                     CTL::CTLAlgorithmType algorithmtype,
-                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options)
+                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options,
+                    SubformulaCache* cache)
 {
-    return recursiveSolve(query.get(), net, algorithmtype, strategytype, partial_order, result, options);
+    return recursiveSolve(query.get(), net, algorithmtype, strategytype, partial_order, result, options, cache);
 }
 
 bool recursiveSolve(Condition* query, PetriEngine::PetriNet* net,
                     CTL::CTLAlgorithmType algorithmtype,
-                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options)
+                    Strategy strategytype, bool partial_order, CTLResult& result, options_t& options,
+                    SubformulaCache* cache)
 {
     if(auto q = dynamic_cast<NotCondition*>(query))
     {
-        return ! recursiveSolve((*q)[0], net, algorithmtype, strategytype, partial_order, result, options);
+        return ! recursiveSolve((*q)[0], net, algorithmtype, strategytype, partial_order, result, options, cache);
     }
     else if(auto q = dynamic_cast<AndCondition*>(query))
     {
-        return solveLogicalCondition(q, true, net, algorithmtype, strategytype, partial_order, result, options);
+        return solveLogicalCondition(q, true, net, algorithmtype, strategytype, partial_order, result, options, cache);
     }
     else if(auto q = dynamic_cast<OrCondition*>(query))
     {
-        return solveLogicalCondition(q, false, net, algorithmtype, strategytype, partial_order, result, options);
+        return solveLogicalCondition(q, false, net, algorithmtype, strategytype, partial_order, result, options, cache);
     }
     else if(PetriEngine::PQL::isReachability(query))
     {
@@ -264,6 +282,8 @@ bool recursiveSolve(Condition* query, PetriEngine::PetriNet* net,
             result.numberOfConfigurations += handler._stored;
             result.numberOfMarkings += handler._stored;
         }
+        if(res.back() == AbstractHandler::Unknown && MemoryLimit::exhausted())
+            throw memory_limit_error();
         return (res.back() == AbstractHandler::Satisfied) xor query->isInvariant();
     }
     else if(!containsNext(query)) {
@@ -304,7 +324,7 @@ bool recursiveSolve(Condition* query, PetriEngine::PetriNet* net,
     }
     //else
     {
-        return CTLSingleSolve(query, net, algorithmtype, strategytype, partial_order, result);
+        return CTLSingleSolve(query, net, algorithmtype, strategytype, partial_order, result, options.cores, cache);
     }
 }
 
@@ -320,7 +340,10 @@ ReturnValue CTLMain(PetriNet* net,
                     options_t& options
         )
 {
+    // the queries on the net share the assignments of their common subformulas
+    SubformulaCache cache;
     for(auto qnum : querynumbers){
+        MemoryLimit::reset();
         CTLResult result(queries[qnum]);
         bool solved = false;
 
@@ -350,10 +373,16 @@ ReturnValue CTLMain(PetriNet* net,
         result.maxTokens = 0;
         if(!solved)
         {
-            if(options.strategy == Strategy::BFS || options.strategy == Strategy::RDFS)
-                result.result = CTLSingleSolve(result.query, net, algorithmtype, options.strategy, options.stubbornreduction, result);
-            else
-                result.result = recursiveSolve(result.query, net, algorithmtype, strategytype, partial_order, result, options);
+            try {
+                if(options.strategy == Strategy::BFS || options.strategy == Strategy::RDFS)
+                    result.result = CTLSingleSolve(result.query, net, algorithmtype, options.strategy, options.stubbornreduction, result, options.cores, &cache);
+                else
+                    result.result = recursiveSolve(result.query, net, algorithmtype, strategytype, partial_order, result, options, &cache);
+            }
+            catch (const memory_limit_error&) {
+                MemoryLimit::printUnsolved(std::cout, querynames[qnum], qnum);
+                continue;
+            }
         }
         result.print(querynames[qnum], printstatistics, qnum, options, std::cout);
     }
@@ -1,5 +1,7 @@
 #include "CTL/DependencyGraph/Configuration.h"
 
+#include <algorithm>
+
 
 namespace DependencyGraph {
 
@@ -9,16 +11,33 @@ namespace DependencyGraph {
         unsigned int tDist = getDistance();
 
         setDistance(std::max(sDist, tDist));
-        auto it = dependency_set.begin();
-        auto pit = dependency_set.before_begin();
-        while(it != dependency_set.end())
-        {
-            if(*it == e) return;
-            if(*it > e) break;
-            pit = it;
-            ++it;
-        }
-        dependency_set.insert_after(pit, e);
+        auto it = std::lower_bound(dependency_set.begin(), dependency_set.end(), e);
+        if(it != dependency_set.end() && *it == e) return;
+        dependency_set.insert(it, e);
         ++e->refcnt;
     }
-}
\ No newline at end of file
+
+    namespace {
+        // marks the dependencies of an assigned configuration
+        Dependent closed{nullptr, nullptr};
+    }
+
+    void Configuration::raiseDistance(uint32_t value) {
+        auto current = distance.load();
+        while(current < value && !distance.compare_exchange_weak(current, value)) {}
+    }
+
+    bool Configuration::addDependent(Dependent* d) {
+        auto head = dependents.load();
+        do {
+            if(head == &closed) return false;
+            d->next = head;
+        } while(!dependents.compare_exchange_weak(head, d));
+        return true;
+    }
+
+    Dependent* Configuration::closeDependents() {
+        auto head = dependents.exchange(&closed);
+        return head == &closed ? nullptr : head;
+    }
+}
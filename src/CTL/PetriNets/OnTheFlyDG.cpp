@@ -13,19 +13,47 @@
 #include "PetriEngine/Stubborn/ReachabilityStubbornSet.h"
 #include "PetriEngine/PQL/PredicateCheckers.h"
 #include "PetriEngine/PQL/Evaluation.h"
+#include "PetriEngine/Structures/MarkingKernels.h"
+#include "utils/errors.h"
 
 using namespace PetriEngine::PQL;
 using namespace DependencyGraph;
 
 namespace PetriNets {
 
-OnTheFlyDG::OnTheFlyDG(PetriEngine::PetriNet *t_net, bool partial_order) : encoder(t_net->numberOfPlaces(), 0),
-        edge_alloc(new linked_bucket_t<DependencyGraph::Edge,1024*10>(1)),
-        conf_alloc(new linked_bucket_t<char[sizeof(PetriConfig)], 1024*1024>(1)),
-        _redgen(*t_net, std::make_shared<PetriEngine::ReachabilityStubbornSet>(*t_net)), _partial_order(partial_order) {
+namespace {
+    std::shared_ptr<PetriEngine::StubbornSet> makeStubbornSet(PetriEngine::PetriNet *net, std::mutex* query_lock)
+    {
+        auto stubset = std::make_shared<PetriEngine::ReachabilityStubbornSet>(*net);
+        stubset->setQueryLock(query_lock);
+        return stubset;
+    }
+}
+
+OnTheFlyDG::worker_t::worker_t(PetriEngine::PetriNet *net, uint32_t index, std::mutex* query_lock) : index(index),
+        encoder(net->numberOfPlaces(), 0),
+        context(net, nullptr),
+        gen(*net),
+        redgen(*net, makeStubbornSet(net, query_lock)),
+        cache_key(encoder.scratchpad().size() + sizeof(uint32_t)) {
+}
+
+OnTheFlyDG::OnTheFlyDG(PetriEngine::PetriNet *t_net, bool partial_order, uint32_t workers, SubformulaCache* cache) :
+        edge_alloc(new linked_bucket_t<DependencyGraph::Edge,1024*10>(std::max<uint32_t>(workers, 1))),
+        conf_alloc(new linked_bucket_t<char[sizeof(PetriConfig)], 1024*1024>(std::max<uint32_t>(workers, 1))),
+        _partial_order(partial_order), _cache(cache) {
     net = t_net;
     n_places = t_net->numberOfPlaces();
     n_transitions = t_net->numberOfTransitions();
+    // the owner of a configuration is stored in 16 bits
+    workers = std::clamp<uint32_t>(workers, 1, std::numeric_limits<uint16_t>::max());
+    for(uint32_t i = 0; i < workers; ++i)
+        _workers.emplace_back(std::make_unique<worker_t>(t_net, i, workers > 1 ? &_query_lock : nullptr));
+    // four shards per worker keeps the contention low
+    while(workers > 1 && (1u << _shardBits) < workers * 4)
+        ++_shardBits;
+    for(uint32_t s = 0; s < (1u << _shardBits); ++s)
+        _shards.emplace_back(std::make_unique<shard_t>());
 }
 
 
@@ -33,12 +61,8 @@ OnTheFlyDG::~OnTheFlyDG()
 {
     cleanUp();
     //Note: initial marking is in the markings set, therefore it will be deleted by the for loop
-    //TODO: Ensure we don't leak memory here, when code moving is done
-    size_t s = conf_alloc->size();
-    for(size_t i = 0; i < s; ++i)
-    {
-        ((PetriConfig*)&(*conf_alloc)[i])->~PetriConfig();
-    }
+    for(auto& s : _shards)
+        s->configurations.foreach([](PetriConfig* c) { c->~PetriConfig(); });
     delete conf_alloc;
     delete edge_alloc;
 }
@@ -46,45 +70,77 @@ OnTheFlyDG::~OnTheFlyDG()
 Condition::Result OnTheFlyDG::initialEval()
 {
     initialConfiguration();
-    EvaluationContext e(query_marking.marking(), net);
+    EvaluationContext e(_workers[0]->query_marking.marking(), net);
     return PetriEngine::PQL::evaluate(query, e);
 }
 
-Condition::Result OnTheFlyDG::fastEval(Condition* query, Marking* unfolded)
+Condition::Result OnTheFlyDG::fastEval(worker_t& w, Condition* query, Marking* unfolded)
 {
+    auto it = w.programs.find(query);
+    if(it == w.programs.end())
+        it = w.programs.emplace(query, PetriEngine::PQL::Bytecode::compile(query, net)).first;
+    if(it->second)
+        return it->second->evaluate(unfolded->marking());
     EvaluationContext e(unfolded->marking(), net);
     return PetriEngine::PQL::evaluate(query, e);
 }
 
-std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
+template<typename Pre, typename Foreach, typename Post>
+void OnTheFlyDG::nextStates(worker_t& w, Marking& t_marking, Condition* ptr,
+    Pre&& pre,
+    Foreach&& foreach,
+    Post&& post)
 {
-    PetriEngine::PQL::DistanceContext context(net, query_marking.marking());
+    bool first = true;
+    memcpy(w.working_marking.marking(), w.query_marking.marking(), n_places*sizeof(PetriEngine::MarkVal));
+    auto qf = static_cast<QuantifierCondition*>(ptr);
+    if(!_partial_order || ptr->getQuantifier() != E || ptr->getPath() != F || PetriEngine::PQL::isTemporal((*qf)[0]))
+    {
+        dowork<PetriEngine::SuccessorGenerator>(w, w.gen, first, pre, foreach);
+    }
+    else
+    {
+        w.redgen.setQuery(ptr);
+        dowork<PetriEngine::ReducingSuccessorGenerator>(w, w.redgen, first, pre, foreach);
+    }
+
+    if(!first) post();
+}
+
+std::vector<DependencyGraph::Edge*>& OnTheFlyDG::successors(Configuration *c, uint32_t worker)
+{
+    auto& w = *_workers[worker];
     PetriConfig *v = static_cast<PetriConfig*>(c);
-    trie.unpack(v->marking, encoder.scratchpad().raw());
-    encoder.decode(query_marking.marking(), encoder.scratchpad().raw());
+    {
+        auto& s = shard(v->marking);
+        std::lock_guard<std::mutex> guard(s.lock);
+        s.trie.unpack(v->marking >> _shardBits, w.encoder.scratchpad().raw());
+    }
+    w.encoder.decode(w.query_marking.marking(), w.encoder.scratchpad().raw());
     //    v->printConfiguration();
-    std::vector<Edge*> succs;
+    auto& succs = w.succs;
+    succs.clear();
     auto query_type = v->query->getQueryType();
     if(query_type == EVAL){
         assert(false);
         //assert(false && "Someone told me, this was a bad place to be.");
-        if (fastEval(query, &query_marking) == Condition::RTRUE){
-            succs.push_back(newEdge(*v, 0));///*v->query->distance(context))*/0);
+        if (fastEval(w, query, &w.query_marking) == Condition::RTRUE){
+            succs.push_back(newEdge(w, *v, 0));///*v->query->distance(context))*/0);
         }
     }
     else if (query_type == LOPERATOR){
         if(v->query->getQuantifier() == NEG){
             // no need to try to evaluate here -- this is already transient in other evaluations.
             auto cond = static_cast<NotCondition*>(v->query);
-            Configuration* c = createConfiguration(v->marking, v->getOwner(), (*cond)[0]);
-            Edge* e = newEdge(*v, /*v->query->distance(context)*/0);
+            Configuration* c = createConfiguration(w, v->marking, v->getOwner(), (*cond)[0]);
+            Edge* e = newEdge(w, *v, /*v->query->distance(context)*/0);
             e->is_negated = true;
             if (!e->addTarget(c)) {
                 succs.push_back(e);
             }
             else {
                 --e->refcnt;
-                release(e);
+                release(e, w.index);
             }
         }
         else if(v->query->getQuantifier() == AND){
@@ -93,7 +149,7 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             std::vector<Condition*> conds;
             for(auto& c : *cond)
             {
-                auto res = fastEval(c.get(), &query_marking);
+                auto res = fastEval(w, c.get(), &w.query_marking);
                 if(res == Condition::RFALSE)
                 {
                     return succs;
@@ -104,7 +160,7 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
                 }
             }
 
-            Edge *e = newEdge(*v, /*cond->distance(context)*/0);
+            Edge *e = newEdge(w, *v, /*cond->distance(context)*/0);
 
             //If we get here, then either both propositions are true (shouldn't be possible)
             //Or a temporal operator and a true proposition
@@ -112,12 +168,12 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             for(auto c : conds)
             {
                 assert(PetriEngine::PQL::isTemporal(c));
-                if (e->addTarget(createConfiguration(v->marking, v->getOwner(), c)))
+                if (e->addTarget(createConfiguration(w, v->marking, v->getOwner(), c)))
                     break;
             }
             if (e->handled) {
                 --e->refcnt;
-                release(e);
+                release(e, w.index);
             }
             else
                 succs.push_back(e);
@@ -128,10 +184,10 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             std::vector<Condition*> conds;
             for(auto& c : *cond)
             {
-                auto res = fastEval(c.get(), &query_marking);
+                auto res = fastEval(w, c.get(), &w.query_marking);
                 if(res == Condition::RTRUE)
                 {
-                    succs.push_back(newEdge(*v, 0));
+                    succs.push_back(newEdge(w, *v, 0));
                     return succs;
                 }
                 if(res == Condition::RUNKNOWN)
@@ -146,10 +202,10 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             for(auto c : conds)
             {
                 assert(PetriEngine::PQL::isTemporal(c));
-                Edge *e = newEdge(*v, /*cond->distance(context)*/0);
-                if (e->addTarget(createConfiguration(v->marking, v->getOwner(), c))) {
+                Edge *e = newEdge(w, *v, /*cond->distance(context)*/0);
+                if (e->addTarget(createConfiguration(w, v->marking, v->getOwner(), c))) {
                     --e->refcnt;
-                    release(e);
+                    release(e, w.index);
                 }
                 else
                     succs.push_back(e);
@@ -164,48 +220,48 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             if (v->query->getPath() == U){
                 auto cond = static_cast<AUCondition*>(v->query);
                 Edge *right = nullptr;
-                auto r1 = fastEval((*cond)[1], &query_marking);
+                auto r1 = fastEval(w, (*cond)[1], &w.query_marking);
                 if (r1 != Condition::RUNKNOWN){
                     //right side is not temporal, eval it right now!
                     if (r1 == Condition::RTRUE) {    //satisfied, no need to go through successors
-                        succs.push_back(newEdge(*v, 0));
+                        succs.push_back(newEdge(w, *v, 0));
                         return succs;
                     }//else: It's not valid, no need to add any edge, just add successors
                 }
                 else {
                     //right side is temporal, we need to evaluate it as normal
-                    Configuration* c = createConfiguration(v->marking, v->getOwner(), (*cond)[1]);
-                    right = newEdge(*v, /*(*cond)[1]->distance(context)*/0);
+                    Configuration* c = createConfiguration(w, v->marking, v->getOwner(), (*cond)[1]);
+                    right = newEdge(w, *v, /*(*cond)[1]->distance(context)*/0);
                     right->addTarget(c);
                 }
                 bool valid = false;
                 Configuration *left = nullptr;
-                auto r0 = fastEval((*cond)[0], &query_marking);
+                auto r0 = fastEval(w, (*cond)[0], &w.query_marking);
                 if (r0 != Condition::RUNKNOWN) {
                     //left side is not temporal, eval it right now!
                     valid = r0 == Condition::RTRUE;
                 } else {
                     //left side is temporal, include it in the edge
-                    left = createConfiguration(v->marking, v->getOwner(), (*cond)[0]);
+                    left = createConfiguration(w, v->marking, v->getOwner(), (*cond)[0]);
                 }
                 if (valid || left != nullptr) {
                     //if left side is guaranteed to be not satisfied, skip successor generation
                     Edge* leftEdge = nullptr;
-                    nextStates (query_marking, cond,
-                                [&](){ leftEdge = newEdge(*v, std::numeric_limits<uint32_t>::max());},
+                    nextStates(w, w.query_marking, cond,
+                                [&](){ leftEdge = newEdge(w, *v, std::numeric_limits<uint32_t>::max());},
                                 [&](Marking& mark){
-                                    auto res = fastEval(cond, &mark);
+                                    auto res = fastEval(w, cond, &mark);
                                     if(res == Condition::RTRUE) return true;
                                     if(res == Condition::RFALSE)
                                     {
                                         left = nullptr;
                                         --leftEdge->refcnt;
-                                        release(leftEdge);
+                                        release(leftEdge, w.index);
                                         leftEdge = nullptr;
                                         return false;
                                     }
-                                    context.setMarking(mark.marking());
-                                    Configuration* c = createConfiguration(createMarking(mark), owner(mark, cond), cond);
+                                    w.context.setMarking(mark.marking());
+                                    Configuration* c = createConfiguration(w, createMarking(w, mark), owner(mark, cond), cond);
                                     return !leftEdge->addTarget(c);
                                 },
                                 [&]()
@@ -217,7 +273,7 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
                                         }
                                         if (leftEdge->handled){
                                             --leftEdge->refcnt;
-                                            release(leftEdge);
+                                            release(leftEdge, w.index);
                                             leftEdge = nullptr;
                                         }
                                         else
@@ -230,7 +286,7 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
                 if (right != nullptr) {
                     if (right->handled){
                         --right->refcnt;
-                        release(right);
+                        release(right, w.index);
                     }
                     else
                         succs.push_back(right);
@@ -239,45 +295,45 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             else if(v->query->getPath() == F){
                 auto cond = static_cast<AFCondition*>(v->query);
                 Edge *subquery = nullptr;
-                auto r = fastEval((*cond)[0], &query_marking);
+                auto r = fastEval(w, (*cond)[0], &w.query_marking);
                 if (r != Condition::RUNKNOWN) {
                     bool valid = r == Condition::RTRUE;
                     if (valid) {
-                        succs.push_back(newEdge(*v, 0));
+                        succs.push_back(newEdge(w, *v, 0));
                         return succs;
                     }
                 } else {
-                    subquery = newEdge(*v, /*cond->distance(context)*/0);
-                    Configuration* c = createConfiguration(v->marking, v->getOwner(), (*cond)[0]);
+                    subquery = newEdge(w, *v, /*cond->distance(context)*/0);
+                    Configuration* c = createConfiguration(w, v->marking, v->getOwner(), (*cond)[0]);
                     subquery->addTarget(c); // cannot be self-loop since the formula is smaller
                 }
                 Edge* e1 = nullptr;
-                nextStates(query_marking, cond,
-                        [&](){e1 = newEdge(*v, std::numeric_limits<uint32_t>::max());},
+                nextStates(w, w.query_marking, cond,
+                        [&](){e1 = newEdge(w, *v, std::numeric_limits<uint32_t>::max());},
                         [&](Marking& mark)
                         {
-                            auto res = fastEval(cond, &mark);
+                            auto res = fastEval(w, cond, &mark);
                             if(res == Condition::RTRUE) return true;
                             if(res == Condition::RFALSE)
                             {
                                 if(subquery)
                                 {
                                     --subquery->refcnt;
-                                    release(subquery);
+                                    release(subquery, w.index);
                                     subquery = nullptr;
                                 }
                                 e1->targets.clear();
                                 return false;
                             }
-                            context.setMarking(mark.marking());
-                            Configuration* c = createConfiguration(createMarking(mark), owner(mark, cond), cond);
+                            w.context.setMarking(mark.marking());
+                            Configuration* c = createConfiguration(w, createMarking(w, mark), owner(mark, cond), cond);
                             return !e1->addTarget(c);
                         },
                         [&]()
                         {
                             if (e1->handled) {
                                 --e1->refcnt;
-                                release(e1);
+                                release(e1, w.index);
                             }
                             else
                                 succs.push_back(e1);
@@ -290,13 +346,13 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             }
             else if(v->query->getPath() == X){
                 auto cond = static_cast<AXCondition*>(v->query);
-                Edge* e = newEdge(*v, std::numeric_limits<uint32_t>::max());
+                Edge* e = newEdge(w, *v, std::numeric_limits<uint32_t>::max());
                 Condition::Result allValid = Condition::RTRUE;
                 // no possible self-loops from AX q
-                nextStates(query_marking, cond,
+                nextStates(w, w.query_marking, cond,
                         [](){},
                         [&](Marking& mark){
-                            auto res = fastEval((*cond)[0], &mark);
+                            auto res = fastEval(w, (*cond)[0], &mark);
                             if(res != Condition::RUNKNOWN)
                             {
                                 if (res == Condition::RFALSE) {
@@ -307,8 +363,8 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
                             else
                             {
                                 allValid = Condition::RUNKNOWN;
-                                context.setMarking(mark.marking());
-                                Configuration* c = createConfiguration(createMarking(mark), v->getOwner(), (*cond)[0]);
+                                w.context.setMarking(mark.marking());
+                                Configuration* c = createConfiguration(w, createMarking(w, mark), v->getOwner(), (*cond)[0]);
                                 e->addTarget(c);
                             }
                             return true;
@@ -338,15 +394,15 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             if (v->query->getPath() == U){
                 auto cond = static_cast<EUCondition*>(v->query);
                 Edge *right = nullptr;
-                auto r1 = fastEval((*cond)[1], &query_marking);
+                auto r1 = fastEval(w, (*cond)[1], &w.query_marking);
                 if (r1 == Condition::RUNKNOWN) {
-                    Configuration* c = createConfiguration(v->marking, v->getOwner(), (*cond)[1]);
-                    right = newEdge(*v, /*(*cond)[1]->distance(context)*/0);
+                    Configuration* c = createConfiguration(w, v->marking, v->getOwner(), (*cond)[1]);
+                    right = newEdge(w, *v, /*(*cond)[1]->distance(context)*/0);
                     right->addTarget(c);
                 } else {
                     bool valid = r1 == Condition::RTRUE;
                     if (valid) {
-                        succs.push_back(newEdge(*v, 0));
+                        succs.push_back(newEdge(w, *v, 0));
                         return succs;
                     }   // else: right condition is not satisfied, no need to add an edge
                 }
@@ -354,31 +410,31 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
 
                 Configuration *left = nullptr;
                 bool valid = false;
-                nextStates(query_marking, cond,
+                nextStates(w, w.query_marking, cond,
                     [&](){
-                        auto r0 = fastEval((*cond)[0], &query_marking);
+                        auto r0 = fastEval(w, (*cond)[0], &w.query_marking);
                         if (r0 == Condition::RUNKNOWN) {
-                            left = createConfiguration(v->marking, v->getOwner(), (*cond)[0]);
+                            left = createConfiguration(w, v->marking, v->getOwner(), (*cond)[0]);
                         } else {
                             valid = r0 == Condition::RTRUE;
                         }
                     },
                     [&](Marking& marking){
                         if(left == nullptr && !valid) return false;
-                        auto res = fastEval(cond, &marking);
+                        auto res = fastEval(w, cond, &marking);
                         if(res == Condition::RFALSE) return true;
                         if(res == Condition::RTRUE)
                         {
-                            for(auto s : succs){ --s->refcnt; release(s);}
+                            for(auto s : succs){ --s->refcnt; release(s, w.index);}
                             succs.clear();
-                            succs.push_back(newEdge(*v, 0));
+                            succs.push_back(newEdge(w, *v, 0));
                             if(right && (left == nullptr && valid))
                             {
                                 // we don't need to validate right IF left
                                 // is trivially satisfied and we have a satisfied
                                 // successor.
                                 --right->refcnt;
-                                release(right);
+                                release(right, w.index);
                                 right = nullptr;
                             }
 
@@ -387,16 +443,16 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
 
                             return false;
                         }
-                        context.setMarking(marking.marking());
-                        Edge* e = newEdge(*v, /*cond->distance(context)*/0);
-                        Configuration* c1 = createConfiguration(createMarking(marking), owner(marking, cond), cond);
+                        w.context.setMarking(marking.marking());
+                        Edge* e = newEdge(w, *v, /*cond->distance(context)*/0);
+                        Configuration* c1 = createConfiguration(w, createMarking(w, marking), owner(marking, cond), cond);
                         e->addTarget(c1);
                         if (left != nullptr) {
                             e->addTarget(left);
                         }
                         if (e->handled) {
                             --e->refcnt;
-                            release(e);
+                            release(e, w.index);
                             // we _don't_ abort suc generation, since EU will have many out-edges
                         }
                         else
@@ -407,7 +463,7 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
                 if (right != nullptr) {
                     if (right->handled) {
                         --right->refcnt;
-                        release(right);
+                        release(right, w.index);
                     }
                     else
                         succs.push_back(right);
@@ -416,46 +472,46 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             else if(v->query->getPath() == F){
                 auto cond = static_cast<EFCondition*>(v->query);
                 Edge *subquery = nullptr;
-                auto r = fastEval((*cond)[0], &query_marking);
+                auto r = fastEval(w, (*cond)[0], &w.query_marking);
                 if (r != Condition::RUNKNOWN) {
                     bool valid = r == Condition::RTRUE;
                     if (valid) {
-                        succs.push_back(newEdge(*v, 0));
+                        succs.push_back(newEdge(w, *v, 0));
                         return succs;
                     }
                 } else {
-                    Configuration* c = createConfiguration(v->marking, v->getOwner(), (*cond)[0]);
-                    subquery = newEdge(*v, /*cond->distance(context)*/0);
+                    Configuration* c = createConfiguration(w, v->marking, v->getOwner(), (*cond)[0]);
+                    subquery = newEdge(w, *v, /*cond->distance(context)*/0);
                     subquery->addTarget(c);
                 }
 
-                nextStates(query_marking, cond,
+                nextStates(w, w.query_marking, cond,
                             [](){},
                             [&](Marking& mark){
-                                auto res = fastEval(cond, &mark);
+                                auto res = fastEval(w, cond, &mark);
                                 if(res == Condition::RFALSE) return true;
                                 if(res == Condition::RTRUE)
                                 {
-                                    for(auto s : succs){ --s->refcnt; release(s);}
+                                    for(auto s : succs){ --s->refcnt; release(s, w.index);}
                                     succs.clear();
-                                    succs.push_back(newEdge(*v, 0));
+                                    succs.push_back(newEdge(w, *v, 0));
                                     if(subquery)
                                     {
                                         --subquery->refcnt;
-                                        release(subquery);
+                                        release(subquery, w.index);
                                     }
                                     subquery = nullptr;
                                     return false;
                                 }
-                                context.setMarking(mark.marking());
-                                Edge* e = newEdge(*v, /*cond->distance(context)*/0);
-                                Configuration* c = createConfiguration(createMarking(mark), owner(mark, cond), cond);
+                                w.context.setMarking(mark.marking());
+                                Edge* e = newEdge(w, *v, /*cond->distance(context)*/0);
+                                Configuration* c = createConfiguration(w, createMarking(w, mark), owner(mark, cond), cond);
                                 e->addTarget(c);
                                 if (!e->handled)
                                     succs.push_back(e);
                                 else {
                                     --e->refcnt;
-                                    release(e);
+                                    release(e, w.index);
                                 }
                                 return true;
                             },
@@ -469,22 +525,22 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
             else if(v->query->getPath() == X){
                 auto cond = static_cast<EXCondition*>(v->query);
                 auto query = (*cond)[0];
-                nextStates(query_marking, cond,
+                nextStates(w, w.query_marking, cond,
                         [](){},
                         [&](Marking& marking) {
-                            auto res = fastEval(query, &marking);
+                            auto res = fastEval(w, query, &marking);
                             if(res == Condition::RTRUE)
                             {
-                                for(auto s : succs){ --s->refcnt; release(s);}
+                                for(auto s : succs){ --s->refcnt; release(s, w.index);}
                                 succs.clear();
-                                succs.push_back(newEdge(*v, 0));
+                                succs.push_back(newEdge(w, *v, 0));
                                 return false;
                             }   //else: It can't hold there, no need to create an edge
                             else if(res == Condition::RUNKNOWN)
                             {
-                                context.setMarking(marking.marking());
-                                Edge* e = newEdge(*v, /*(*cond)[0]->distance(context)*/0);
-                                Configuration* c = createConfiguration(createMarking(marking), v->getOwner(), query);
+                                w.context.setMarking(marking.marking());
+                                Edge* e = newEdge(w, *v, /*(*cond)[0]->distance(context)*/0);
+                                Configuration* c = createConfiguration(w, createMarking(w, marking), v->getOwner(), query);
                                 e->addTarget(c);
                                 succs.push_back(e);
                             }
@@ -504,56 +560,35 @@ std::vector<DependencyGraph::Edge*> OnTheFlyDG::successors(Configuration *c)
     {
         assert(false && "Should never happen");
     }
-    /*
-    // legacy code from distributed version
-    if(succs.size() == 1 && succs[0]->targets.size() == 1)
-    {
-        ((PetriConfig*)succs[0]->targets[0])->setOwner(v->getOwner());
-    }*/
     return succs;
 }
 
 Configuration* OnTheFlyDG::initialConfiguration()
 {
-    if(working_marking.marking() == nullptr)
+    auto& w = *_workers[0];
+    if(w.working_marking.marking() == nullptr)
     {
-        working_marking.setMarking  (net->makeInitialMarking());
-        query_marking.setMarking    (net->makeInitialMarking());
-        auto o = owner(working_marking, this->query);
-        initial_config = createConfiguration(createMarking(working_marking), o, this->query);
+        for(auto& other : _workers)
+        {
+            other->working_marking.setMarking(net->makeInitialMarking());
+            other->query_marking.setMarking(net->makeInitialMarking());
+        }
+        auto o = owner(w.working_marking, this->query);
+        initial_config = createConfiguration(w, createMarking(w, w.working_marking), o, this->query);
     }
     return initial_config;
 }
 
 
-void OnTheFlyDG::nextStates(Marking& t_marking, Condition* ptr,
-    std::function<void ()> pre,
-    std::function<bool (Marking&)> foreach,
-    std::function<void ()> post)
-{
-    bool first = true;
-    memcpy(working_marking.marking(), query_marking.marking(), n_places*sizeof(PetriEngine::MarkVal));
-    auto qf = static_cast<QuantifierCondition*>(ptr);
-    if(!_partial_order || ptr->getQuantifier() != E || ptr->getPath() != F || PetriEngine::PQL::isTemporal((*qf)[0]))
-    {
-        PetriEngine::SuccessorGenerator PNGen(*net);
-        dowork<PetriEngine::SuccessorGenerator>(PNGen, first, pre, foreach);
-    }
-    else
-    {
-        _redgen.setQuery(ptr);
-        dowork<PetriEngine::ReducingSuccessorGenerator>(_redgen, first, pre, foreach);
-    }
-
-    if(!first) post();
-}
-
 void OnTheFlyDG::cleanUp()
 {
-    while(!recycle.empty())
+    for(auto& w : _workers)
     {
-        assert(recycle.top()->refcnt == -1);
-        recycle.pop();
+        while(!w->recycle.empty())
+        {
+            assert(w->recycle.top()->refcnt == -1);
+            w->recycle.pop();
+        }
     }
     // TODO, implement proper cleanup
 }
@@ -562,14 +597,62 @@ void OnTheFlyDG::cleanUp()
 void OnTheFlyDG::setQuery(Condition* query)
 {
     this->query = query;
-    delete[] working_marking.marking();
-    delete[] query_marking.marking();
-    working_marking.setMarking(nullptr);
-    query_marking.setMarking(nullptr);
+    for(auto& w : _workers)
+    {
+        w->programs.clear();
+        delete[] w->working_marking.marking();
+        delete[] w->query_marking.marking();
+        w->working_marking.setMarking(nullptr);
+        w->query_marking.setMarking(nullptr);
+    }
+    _formulas.clear();
+    if(_cache)
+        numberFormulas(query);
     initialConfiguration();
     assert(this->query);
 }
 
+void OnTheFlyDG::numberFormulas(Condition* query)
+{
+    // only the temporal subformulas are given configurations
+    if(_formulas.count(query) != 0) return;
+    _formulas.emplace(query, _cache->formula(query));
+    auto visit = [this](const Condition_ptr& c) {
+        if(PetriEngine::PQL::isTemporal(c))
+            numberFormulas(c.get());
+    };
+    if(auto q = dynamic_cast<NotCondition*>(query))
+        visit((*q)[0]);
+    else if(auto q = dynamic_cast<LogicalCondition*>(query))
+    {
+        for(auto& c : *q)
+            visit(c);
+    }
+    else if(auto q = dynamic_cast<UntilCondition*>(query))
+    {
+        visit((*q)[0]);
+        visit((*q)[1]);
+    }
+    else if(auto q = dynamic_cast<QuantifierCondition*>(query))
+        visit((*q)[0]);
+}
+
+void OnTheFlyDG::cacheResults()
+{
+    assert(_cache);
+    auto& w = *_workers[0];
+    for(auto& s : _shards)
+    {
+        s->configurations.foreach([&](PetriConfig* c) {
+            if(!c->isDone()) return;
+            auto f = _formulas.find(c->query);
+            if(f == _formulas.end()) return;
+            auto length = s->trie.unpack(c->marking >> _shardBits, w.cache_key.data());
+            _cache->store(w.cache_key.data(), length, f->second, c->assignment == ONE);
+        });
+    }
+}
+
 size_t OnTheFlyDG::configurationCount() const
 {
     return _configurationCount;
@@ -581,50 +664,75 @@ size_t OnTheFlyDG::markingCount() const
 }
 
 size_t OnTheFlyDG::maxTokens() const {
-    return _maxTokens;
+    size_t tokens = 0;
+    for(auto& s : _shards)
+    {
+        std::lock_guard<std::mutex> guard(s->lock);
+        tokens = std::max(tokens, s->maxTokens);
+    }
+    return tokens;
 }
 
-PetriConfig *OnTheFlyDG::createConfiguration(size_t marking, size_t own, Condition* t_query)
+PetriConfig *OnTheFlyDG::createConfiguration(worker_t& w, uint32_t marking, size_t own, Condition* t_query)
 {
-    auto& configs = trie.get_data(marking);
-    for(PetriConfig* c : configs){
-        if(c->query == t_query)
-            return c;
-    }
+    auto& s = shard(marking);
+    std::lock_guard<std::mutex> guard(s.lock);
+    if(auto c = s.configurations.find(marking, t_query))
+        return c;
 
     _configurationCount++;
-    size_t id = conf_alloc->next(0);
+    size_t id = conf_alloc->next(w.index);
     char* mem = (*conf_alloc)[id];
     PetriConfig* newConfig = new (mem) PetriConfig();
     newConfig->marking = marking;
     newConfig->query = t_query;
     newConfig->setOwner(own);
-    configs.push_back(newConfig);
+    if(_cache)
+    {
+        auto f = _formulas.find(t_query);
+        if(f != _formulas.end())
+        {
+            auto length = s.trie.unpack(marking >> _shardBits, w.cache_key.data());
+            auto a = _cache->lookup(w.cache_key.data(), length, f->second);
+            if(a != UNKNOWN)
+            {
+                // decided by an earlier query, edges added later check it at once
+                newConfig->assignment = a;
+                newConfig->closeDependents();
+            }
+        }
+    }
+    s.configurations.insert(newConfig);
     return newConfig;
 }
 
 
 
-size_t OnTheFlyDG::createMarking(Marking& t_marking){
+uint32_t OnTheFlyDG::createMarking(worker_t& w, Marking& t_marking){
     size_t sum = 0;
     bool allsame = true;
     uint32_t val = 0;
     uint32_t active = 0;
     uint32_t last = 0;
     markingStats(t_marking.marking(), sum, allsame, val, active, last);
-    unsigned char type = encoder.getType(sum, active, allsame, val);
-    size_t length = encoder.encode(t_marking.marking(), type);
-    binarywrapper_t w = binarywrapper_t(encoder.scratchpad().raw(), length*8);
-    auto tit = trie.insert(w.raw(), w.size());
+    unsigned char type = w.encoder.getType(sum, active, allsame, val);
+    size_t length = w.encoder.encode(t_marking.marking(), type);
+    binarywrapper_t bw = binarywrapper_t(w.encoder.scratchpad().raw(), length*8);
+    auto sid = shardOf(bw.raw(), length);
+    auto& s = *_shards[sid];
+    std::lock_guard<std::mutex> guard(s.lock);
+    auto tit = s.trie.insert(bw.raw(), bw.size());
     if(tit.first){
         _markingCount++;
-        _maxTokens = std::max(sum, _maxTokens);
+        s.maxTokens = std::max(sum, s.maxTokens);
     }
 
-    return tit.second;
+    if((tit.second << _shardBits) > std::numeric_limits<uint32_t>::max())
+        throw base_error("The CTL engine supports at most 2^32 markings");
+    return (tit.second << _shardBits) | sid;
 }
 
-void OnTheFlyDG::release(Edge* e)
+void OnTheFlyDG::release(Edge* e, uint32_t worker)
 {
     assert(e->refcnt == 0);
     e->is_negated = false;
@@ -633,28 +741,28 @@ void OnTheFlyDG::release(Edge* e)
     e->targets.clear();
     e->refcnt = -1;
     e->handled = false;
-    recycle.push(e);
+    _workers[worker]->recycle.push(e);
 }
 
 size_t OnTheFlyDG::owner(Marking& marking, Condition* cond) {
-    // Used for distributed algorithm
+    // the worker exploring a configuration claims it, see ParallelCertainZeroFPA
     return 0;
 }
 
 
-Edge* OnTheFlyDG::newEdge(Configuration &t_source, uint32_t weight)
+Edge* OnTheFlyDG::newEdge(worker_t& w, Configuration &t_source, uint32_t weight)
 {
     Edge* e = nullptr;
-    if(recycle.empty())
+    if(w.recycle.empty())
     {
-        size_t n = edge_alloc->next(0);
+        size_t n = edge_alloc->next(w.index);
         e = &(*edge_alloc)[n];
     }
     else
     {
-        e = recycle.top();
+        e = w.recycle.top();
         e->refcnt = 0;
-        recycle.pop();
+        w.recycle.pop();
     }
     assert(e->targets.empty());
     /*e->assignment = UNKNOWN;
@@ -666,24 +774,28 @@ Edge* OnTheFlyDG::newEdge(Configuration &t_source, uint32_t weight)
     return e;
 }
 
-void OnTheFlyDG::markingStats(const uint32_t* marking, size_t& sum,
-        bool& allsame, uint32_t& val, uint32_t& active, uint32_t& last)
+uint32_t OnTheFlyDG::shardOf(const unsigned char* data, size_t length) const
 {
-    uint32_t cnt = 0;
-
-    for (uint32_t i = 0; i < n_places; i++)
+    if(_shardBits == 0) return 0;
+    // FNV-1a over the encoded marking
+    uint64_t h = 14695981039346656037ULL;
+    for(size_t i = 0; i < length; ++i)
     {
-        uint32_t old = val;
-        if(marking[i] != 0)
-        {
-            ++cnt;
-            last = std::max(last, i);
-            val = std::max(marking[i], val);
-            if(old != 0 && marking[i] != old) allsame = false;
-            ++active;
-            sum += marking[i];
-        }
+        h ^= data[i];
+        h *= 1099511628211ULL;
     }
+    return (h ^ (h >> 32)) & ((1u << _shardBits) - 1);
+}
+
+void OnTheFlyDG::markingStats(const uint32_t* marking, size_t& sum,
+        bool& allsame, uint32_t& val, uint32_t& active, uint32_t& last)
+{
+    auto stats = PetriEngine::Structures::MarkingKernels::stats(marking, n_places);
+    sum = stats.sum;
+    allsame = stats.allsame;
+    val = stats.max;
+    active = stats.active;
+    last = stats.last;
 }
 
 
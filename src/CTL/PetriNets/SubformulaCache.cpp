@@ -0,0 +1,39 @@
+#include "CTL/PetriNets/SubformulaCache.h"
+#include "PetriEngine/PQL/QueryPrinter.h"
+
+#include <cstring>
+#include <sstream>
+
+namespace PetriNets {
+
+uint32_t SubformulaCache::formula(const Condition* condition)
+{
+    std::stringstream ss;
+    PetriEngine::PQL::QueryPrinter printer(ss);
+    PetriEngine::PQL::Visitor::visit(printer, condition);
+    return _formulas.emplace(ss.str(), _formulas.size()).first->second;
+}
+
+DependencyGraph::Assignment SubformulaCache::lookup(unsigned char* marking, size_t length, uint32_t formula) const
+{
+    // the formula follows the marking, sharing the prefix of its configurations
+    memcpy(marking + length, &formula, sizeof(uint32_t));
+    length += sizeof(uint32_t);
+    if(_satisfied.exists(marking, length).first)
+        return DependencyGraph::ONE;
+    if(_unsatisfied.exists(marking, length).first)
+        return DependencyGraph::CZERO;
+    return DependencyGraph::UNKNOWN;
+}
+
+void SubformulaCache::store(unsigned char* marking, size_t length, uint32_t formula, bool satisfied)
+{
+    if(_size >= _capacity) return;
+    memcpy(marking + length, &formula, sizeof(uint32_t));
+    length += sizeof(uint32_t);
+    auto& set = satisfied ? _satisfied : _unsatisfied;
+    if(set.insert(marking, length).first)
+        ++_size;
+}
+
+}
@@ -19,6 +19,7 @@
 #include "LTL/SuccessorGeneration/Spoolers.h"
 #include "LTL/SuccessorGeneration/CompoundGenerator.h"
 #include "LTL/Structures/CompoundStateSet.h"
+#include "utils/MemoryLimit.h"
 
 namespace LTL {
 
@@ -109,6 +110,7 @@ namespace LTL {
         todo.push_back(stack_entry_t<T>{init, successor_generator.initial_suc_info()});
 
         while (!todo.empty()) {
+            MemoryLimit::enforce();
             auto &top = todo.back();
             states.decode(curState, top._id);
             successor_generator.prepare(&curState, top._sucinfo);
@@ -169,6 +171,7 @@ namespace LTL {
         nested_todo.push_back(stack_entry_t<T>{std::get<1>(states.add(state)), successor_generator.initial_suc_info()});
 
         while (!nested_todo.empty()) {
+            MemoryLimit::enforce();
             auto &top = nested_todo.back();
             states.decode(curState, top._id);
             successor_generator.prepare(&curState, top._sucinfo);
@@ -17,6 +17,7 @@
 
 #include "LTL/Algorithm/TarjanModelChecker.h"
 #include "PetriEngine/PQL/PredicateCheckers.h"
+#include "utils/MemoryLimit.h"
 
 namespace LTL {
 
@@ -127,6 +128,7 @@ namespace LTL {
                 push(seen, cstack, dstack, successorGenerator, state, std::get<1>(res));
             }
             while (!dstack.empty() && !_violation) {
+                MemoryLimit::enforce();
                 auto &dtop = dstack.back();
                 // write next successor state to working.
                 if (!next_trans(seen, cstack, successorGenerator, working, parent, dtop)) {
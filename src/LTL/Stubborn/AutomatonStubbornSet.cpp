@@ -111,7 +111,7 @@ namespace LTL {
                 }
 
                 if (_stubborn._bad) {
-                    _stubborn._places_seen[cand] |= pre ? PresetBad : PostsetBad;
+                    _stubborn.markSeen(cand, pre ? PresetBad : PostsetBad);
 #ifndef NDEBUG
                     //std::cerr << "Bad pre/post and reset" << std::endl;
 #endif
@@ -127,7 +127,7 @@ namespace LTL {
 #ifndef NDEBUG
                     //std::cerr << "Bad closure and reset" << std::endl;
 #endif
-                    _stubborn._places_seen[cand] |= pre ? PresetBad : PostsetBad;
+                    _stubborn.markSeen(cand, pre ? PresetBad : PostsetBad);
                     _stubborn._reset_pending();
                 }
             }
@@ -216,8 +216,8 @@ namespace LTL {
 
 
         /*//Check that S-INV is satisfied
-        if (has_shared_mark(_stubborn.get(), _retarding_stubborn_set.stubborn(), _net.numberOfTransitions())) {
-            memset(_stubborn.get(), true, sizeof(bool) * _net.numberOfTransitions());
+        if (has_shared_mark(_stubborn, _retarding_stubborn_set.stubborn())) {
+            _stubborn.set();
             //return true;
         }*/
 
@@ -236,7 +236,7 @@ namespace LTL {
             }
         }
 
-        assert(!has_shared_mark(_stubborn.get(), _retarding_stubborn_set.stubborn(), _net.numberOfTransitions()));
+        assert(!has_shared_mark(_stubborn, _retarding_stubborn_set.stubborn()));
 
         __print_debug();
 
@@ -342,7 +342,7 @@ namespace LTL {
 
     void AutomatonStubbornSet::set_all_stubborn()
     {
-        memset(_stubborn.get(), true, sizeof(bool) * _net.numberOfTransitions());
+        _stubborn.set();
         _done = true;
     }
 
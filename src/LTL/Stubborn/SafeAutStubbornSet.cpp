@@ -55,7 +55,7 @@ namespace LTL {
         _has_enabled_stubborn = false;
         //memset(_stubborn.get(), false, sizeof(bool) * _net.numberOfTransitions());
         _unprocessed.clear();
-        memset(_places_seen.get(), 0, _net.numberOfPlaces());
+        resetSeen();
 
         assert(_unprocessed.empty());
 
@@ -48,7 +48,7 @@ namespace LTL {
 
 
         if (!_has_enabled_stubborn) {
-            memset(_stubborn.get(), 1, _net.numberOfTransitions());
+            _stubborn.set();
         }
 #ifdef STUBBORN_STATISTICS
         float num_stubborn = 0;
@@ -120,7 +120,7 @@ namespace LTL {
         }
         if (!visibleStubborn) return;
         else {
-            memset(_stubborn.get(), true, _net.numberOfTransitions());
+            _stubborn.set();
         }
         // following block would implement rule V
         /*
@@ -152,7 +152,7 @@ namespace LTL {
         // recompute entire set
         closure();
         if (!_has_enabled_stubborn) {
-            memset(_stubborn.get(), 1, _net.numberOfTransitions());
+            _stubborn.set();
         }
         return true;
         /*
@@ -0,0 +1,240 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PetriEngine/EnabledTransitions.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace PetriEngine {
+
+    EnabledTransitions::EnabledTransitions(const PetriNet& net, size_t budget)
+    : _net(net), _words((net.numberOfTransitions() + 63) / 64)
+    {
+        const uint32_t ntrans = net.numberOfTransitions();
+        const FiringArc* arcs = net.firingArcs();
+
+        // the transitions guarded by each place
+        std::vector<size_t> guardPtrs(net.numberOfPlaces() + 1, 0);
+        for(uint32_t t = 0; t < ntrans; ++t)
+        {
+            auto& record = net.firing(t);
+            for(auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc)
+                ++guardPtrs[arc->place + 1];
+        }
+        for(size_t p = 0; p < net.numberOfPlaces(); ++p)
+            guardPtrs[p + 1] += guardPtrs[p];
+        std::vector<uint32_t> guards(guardPtrs.back());
+        {
+            auto fill = guardPtrs;
+            for(uint32_t t = 0; t < ntrans; ++t)
+            {
+                auto& record = net.firing(t);
+                for(auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc)
+                    guards[fill[arc->place]++] = t;
+            }
+        }
+
+        std::vector<uint32_t> stamp(ntrans, NONE);
+        _affectedPtrs.resize(ntrans + 1, 0);
+        _recompute.resize(ntrans, false);
+        for(uint32_t t = 0; t < ntrans; ++t)
+        {
+            auto& record = net.firing(t);
+            size_t begin = _affected.size();
+            for(auto arc = arcs + record.begin; arc != arcs + record.end; ++arc)
+            {
+                if(arc->delta == 0) continue;
+                for(size_t g = guardPtrs[arc->place]; g < guardPtrs[arc->place + 1]; ++g)
+                {
+                    if(stamp[guards[g]] == t) continue;
+                    stamp[guards[g]] = t;
+                    _affected.push_back(guards[g]);
+                }
+            }
+            if((_affected.size() - begin) * 2 > ntrans)
+            {
+                // cheaper to start over than to check (and store) a list this long
+                _affected.resize(begin);
+                _recompute[t] = true;
+            }
+            else
+                std::sort(_affected.begin() + begin, _affected.end());
+            _affectedPtrs[t + 1] = _affected.size();
+        }
+        _affected.shrink_to_fit();
+
+        if(_words == 0) return;
+        // a stored set costs its words and its entry in _free, plus the buckets
+        // of the index; take the largest index that leaves room for half as many sets
+        const size_t entry = _words * sizeof(word_t) + sizeof(uint32_t);
+        for(size_t n = 16; n * sizeof(bucket_t) + n / 2 * entry <= budget; n *= 2)
+            _maxBuckets = n;
+        if(_maxBuckets != 0)
+            _capacity = std::min(_maxBuckets / 4 * 3, (budget - _maxBuckets * sizeof(bucket_t)) / entry);
+    }
+
+    bool EnabledTransitions::enabled(uint32_t t, const MarkVal* marking) const
+    {
+        auto& record = _net.firing(t);
+        return _net.visitFiringArcs([&](auto arcs) {
+            for(auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc)
+            {
+                if(arc->inhibitor == (marking[arc->place] >= arc->tokens))
+                    return false;
+            }
+            return true;
+        });
+    }
+
+    void EnabledTransitions::compute(const MarkVal* marking, word_t* enabled) const
+    {
+        memset(enabled, 0, _words * sizeof(word_t));
+        // as the successor generator, only transitions consuming from a marked place
+        // (or the orphans under place 0) can be enabled
+        for(uint32_t p = 0; p < _net.numberOfPlaces(); ++p)
+        {
+            if(p != 0 && marking[p] == 0) continue;
+            for(uint32_t t = _net._placeToPtrs[p]; t != _net._placeToPtrs[p + 1]; ++t)
+            {
+                if(this->enabled(t, marking))
+                    enabled[t / 64] |= word_t{1} << (t % 64);
+            }
+        }
+    }
+
+    void EnabledTransitions::update(const MarkVal* marking, uint32_t fired, word_t* enabled) const
+    {
+        if(_recompute[fired])
+        {
+            compute(marking, enabled);
+            return;
+        }
+        for(size_t i = _affectedPtrs[fired]; i < _affectedPtrs[fired + 1]; ++i)
+        {
+            auto t = _affected[i];
+            auto bit = word_t{1} << (t % 64);
+            if(this->enabled(t, marking))
+                enabled[t / 64] |= bit;
+            else
+                enabled[t / 64] &= ~bit;
+        }
+    }
+
+    size_t EnabledTransitions::home(size_t id) const
+    {
+        size_t h = id * 0x9E3779B97F4A7C15ULL;
+        return (h ^ (h >> 32)) & (_buckets.size() - 1);
+    }
+
+    size_t EnabledTransitions::find(size_t id) const
+    {
+        const size_t mask = _buckets.size() - 1;
+        size_t b = home(id);
+        while(_buckets[b].id != EMPTY && _buckets[b].id != id)
+            b = (b + 1) & mask;
+        return b;
+    }
+
+    void EnabledTransitions::grow()
+    {
+        std::vector<bucket_t> old(_buckets.size() * 2, bucket_t{EMPTY, 0});
+        old.swap(_buckets);
+        for(auto& e : old)
+            if(e.id != EMPTY)
+                _buckets[find(e.id)] = e;
+    }
+
+    bool EnabledTransitions::store(size_t id, const word_t* enabled)
+    {
+        if(_capacity == 0)
+            return false;
+        if(_buckets.empty())
+            _buckets.assign(16, bucket_t{EMPTY, 0});
+        size_t b = find(id);
+        if(_buckets[b].id == id)
+        {
+            memcpy(_pool.data() + _buckets[b].slot * _words, enabled, _words * sizeof(word_t));
+            return true;
+        }
+
+        uint32_t slot;
+        if(!_free.empty())
+        {
+            slot = _free.back();
+            _free.pop_back();
+        }
+        else if(_pool.size() / _words < _capacity)
+        {
+            slot = _pool.size() / _words;
+            if(_pool.size() == _pool.capacity())
+            {
+                // grow geometrically, but never past the budget
+                size_t sets = std::min(std::max<size_t>(16, 2 * slot), _capacity);
+                _pool.reserve(sets * _words);
+                _free.reserve(sets);
+            }
+            _pool.resize(_pool.size() + _words);
+        }
+        else
+            return false;
+
+        // _capacity keeps the index at most 3/4 full within _maxBuckets
+        if((_stored + 1) * 4 > _buckets.size() * 3)
+        {
+            grow();
+            b = find(id);
+        }
+        memcpy(_pool.data() + slot * _words, enabled, _words * sizeof(word_t));
+        _buckets[b] = bucket_t{id, slot};
+        ++_stored;
+        return true;
+    }
+
+    bool EnabledTransitions::load(size_t id, word_t* enabled)
+    {
+        if(_stored == 0)
+            return false;
+        size_t hole = find(id);
+        if(_buckets[hole].id != id)
+            return false;
+        memcpy(enabled, _pool.data() + _buckets[hole].slot * _words, _words * sizeof(word_t));
+        _free.push_back(_buckets[hole].slot);
+        --_stored;
+
+        // backward-shift deletion: pull later entries of the run into the hole
+        // unless that would move them before their home bucket
+        const size_t mask = _buckets.size() - 1;
+        for(size_t n = (hole + 1) & mask; _buckets[n].id != EMPTY; n = (n + 1) & mask)
+        {
+            if(((n - home(_buckets[n].id)) & mask) >= ((n - hole) & mask))
+            {
+                _buckets[hole] = _buckets[n];
+                hole = n;
+            }
+        }
+        _buckets[hole].id = EMPTY;
+        return true;
+    }
+
+    void EnabledTransitions::clear()
+    {
+        _buckets.clear();
+        _stored = 0;
+        _free.clear();
+        _pool.clear();
+    }
+}
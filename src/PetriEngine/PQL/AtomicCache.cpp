@@ -0,0 +1,165 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PetriEngine/PQL/AtomicCache.h"
+#include "PetriEngine/PQL/Contexts.h"
+#include "PetriEngine/PQL/Evaluation.h"
+#include "PetriEngine/PQL/Expressions.h"
+#include "PetriEngine/PQL/PlaceUseVisitor.h"
+#include "PetriEngine/PQL/QueryPrinter.h"
+
+#include <limits>
+#include <sstream>
+#include <string>
+
+namespace PetriEngine {
+    namespace PQL {
+
+        namespace {
+            class AtomCollector : public BaseVisitor {
+            public:
+                const std::vector<const Condition*>& found() const {
+                    return _found;
+                }
+            protected:
+                void _accept(const CompareConjunction* element) override {
+                    _found.push_back(element);
+                }
+
+                void _accept(const CompareCondition* element) override {
+                    _found.push_back(element);
+                }
+
+                void _accept(const PathSelectCondition*) override {
+                    // evaluated in another part of the marking
+                }
+            private:
+                std::vector<const Condition*> _found;
+            };
+        }
+
+        AtomicCache::AtomicCache(const PetriNet& net, const std::vector<Condition_ptr>& queries)
+        : _net(net), _queries(queries)
+        {
+            AtomCollector collector;
+            for (auto& q : queries)
+                Visitor::visit(collector, q);
+
+            std::unordered_map<std::string, uint32_t> names;
+            std::vector<std::vector<uint32_t>> placeAtoms(net.numberOfPlaces());
+            for (auto* c : collector.found()) {
+                if (_index.count(c) != 0) continue;
+                std::stringstream ss;
+                QueryPrinter printer(ss);
+                Visitor::visit(printer, c);
+                auto res = names.emplace(ss.str(), _atoms.size());
+                if (res.second) {
+                    // evaluation annotates the condition, so it is not const to the evaluator
+                    _atoms.push_back(const_cast<Condition*>(c));
+                    _programs.push_back(Bytecode::compile(c, &net));
+                    PlaceUseVisitor places(net.numberOfPlaces());
+                    Visitor::visit(places, c);
+                    for (uint32_t p = 0; p < net.numberOfPlaces(); ++p)
+                        if (places[p])
+                            placeAtoms[p].push_back(res.first->second);
+                }
+                _index[c] = res.first->second;
+            }
+
+            const uint32_t ntrans = net.numberOfTransitions();
+            const FiringArc* arcs = net.firingArcs();
+            std::vector<uint32_t> stamp(_atoms.size(), std::numeric_limits<uint32_t>::max());
+            _affectedPtrs.resize(ntrans + 1, 0);
+            _recompute.resize(ntrans, false);
+            for (uint32_t t = 0; t < ntrans; ++t) {
+                auto& record = net.firing(t);
+                size_t begin = _affected.size();
+                for (auto arc = arcs + record.begin; arc != arcs + record.end; ++arc) {
+                    if (arc->delta == 0) continue;
+                    for (auto a : placeAtoms[arc->place]) {
+                        if (stamp[a] == t) continue;
+                        stamp[a] = t;
+                        _affected.push_back(a);
+                    }
+                }
+                if ((_affected.size() - begin) * 2 > _atoms.size()) {
+                    _affected.resize(begin);
+                    _recompute[t] = true;
+                }
+                _affectedPtrs[t + 1] = _affected.size();
+            }
+            _affected.shrink_to_fit();
+
+            _live.resize(_atoms.size());
+            for (uint32_t a = 0; a < _atoms.size(); ++a)
+                _live[a] = a;
+            _parent.resize(_atoms.size(), false);
+            _current.resize(_atoms.size(), false);
+        }
+
+        void AtomicCache::retain(const std::vector<Condition_ptr>& queries) {
+            AtomCollector collector;
+            for (auto& q : queries)
+                Visitor::visit(collector, q);
+            std::vector<bool> keep(_atoms.size(), false);
+            for (auto* c : collector.found()) {
+                auto a = index(c);
+                if (a != _atoms.size())
+                    keep[a] = true;
+            }
+
+            _live.clear();
+            for (uint32_t a = 0; a < _atoms.size(); ++a)
+                if (keep[a])
+                    _live.push_back(a);
+
+            size_t begin = 0;
+            size_t out = 0;
+            for (size_t t = 0; t + 1 < _affectedPtrs.size(); ++t) {
+                size_t end = _affectedPtrs[t + 1];
+                for (size_t i = begin; i < end; ++i)
+                    if (keep[_affected[i]])
+                        _affected[out++] = _affected[i];
+                _affectedPtrs[t + 1] = out;
+                begin = end;
+            }
+            _affected.resize(out);
+        }
+
+        bool AtomicCache::compute(uint32_t atom, const MarkVal* marking) const {
+            if (_programs[atom])
+                return _programs[atom]->evaluate(marking) == Condition::RTRUE;
+            return PQL::evaluate(_atoms[atom], EvaluationContext(marking, &_net)) == Condition::RTRUE;
+        }
+
+        void AtomicCache::evaluate(const MarkVal* marking) {
+            for (auto a : _live)
+                _parent[a] = compute(a, marking);
+            _current = _parent;
+        }
+
+        void AtomicCache::successor(const MarkVal* marking, uint32_t fired) {
+            if (_recompute[fired]) {
+                for (auto a : _live)
+                    _current[a] = compute(a, marking);
+                return;
+            }
+            _current = _parent;
+            for (size_t i = _affectedPtrs[fired]; i < _affectedPtrs[fired + 1]; ++i)
+                _current[_affected[i]] = compute(_affected[i], marking);
+        }
+    }
+}
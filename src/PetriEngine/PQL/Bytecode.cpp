@@ -0,0 +1,546 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PetriEngine/PQL/Bytecode.h"
+#include "PetriEngine/PQL/AtomicCache.h"
+#include "PetriEngine/PQL/Contexts.h"
+#include "PetriEngine/PQL/Expressions.h"
+#include "PetriEngine/PQL/IncrementalDistance.h"
+#include "PetriEngine/PQL/Visitor.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <limits>
+
+namespace PetriEngine {
+    namespace PQL {
+
+        class BytecodeCompiler : public Visitor {
+        public:
+            BytecodeCompiler(Bytecode& code, const AtomicCache* atoms)
+            : _code(code), _atoms(atoms) {}
+
+            bool failed() const {
+                return _failed;
+            }
+
+        protected:
+            uint32_t open(Bytecode::op_t op, Bytecode::distance_t dist = Bytecode::OPERAND) {
+                _code._code.emplace_back();
+                _code._code.back().op = op;
+                _code._code.back().dist = dist;
+                return _code._code.size() - 1;
+            }
+
+            void close(uint32_t pc) {
+                _code._code[pc].end = _code._code.size();
+            }
+
+            // a cached comparison reads the cache, but keeps its code for the distance
+            uint32_t openAtom(const Condition* element) {
+                if (_atoms == nullptr) return std::numeric_limits<uint32_t>::max();
+                auto atom = _atoms->index(element);
+                if (atom == _atoms->size()) return std::numeric_limits<uint32_t>::max();
+                auto pc = open(Bytecode::ATOM);
+                _code._code[pc].arg = atom;
+                return pc;
+            }
+
+            void closeAtom(uint32_t pc) {
+                if (pc != std::numeric_limits<uint32_t>::max())
+                    close(pc);
+            }
+
+            void quantifier(const SimpleQuantifierCondition* element, Bytecode::op_t op, Bytecode::distance_t dist) {
+                auto pc = open(op, dist);
+                Visitor::visit(this, element->getCond());
+                close(pc);
+            }
+
+            void until(const UntilCondition* element, Bytecode::distance_t dist) {
+                auto pc = open(Bytecode::UNTIL, dist);
+                Visitor::visit(this, (*element)[0]);
+                Visitor::visit(this, (*element)[1]);
+                close(pc);
+            }
+
+            void compare(const CompareCondition* element, Bytecode::op_t op) {
+                auto atom = openAtom(element);
+                auto pc = open(op);
+                expression(element->getExpr1().get());
+                expression(element->getExpr2().get());
+                close(pc);
+                closeAtom(atom);
+            }
+
+            // folds e * factor into constant + the terms, false if e is not linear
+            bool linearize(const Expr* e, int64_t factor, int64_t& constant, std::vector<Bytecode::term_t>& terms) {
+                switch (e->type()) {
+                    case type_id<LiteralExpr>():
+                        constant += factor * static_cast<const LiteralExpr*>(e)->value();
+                        return true;
+                    case type_id<UnfoldedIdentifierExpr>():
+                        terms.push_back({(uint32_t)static_cast<const UnfoldedIdentifierExpr*>(e)->offset(), factor});
+                        return true;
+                    case type_id<IdentifierExpr>(): {
+                        auto& compiled = static_cast<const IdentifierExpr*>(e)->compiled();
+                        return compiled && linearize(compiled.get(), factor, constant, terms);
+                    }
+                    case type_id<PlusExpr>(): {
+                        auto plus = static_cast<const PlusExpr*>(e);
+                        constant += factor * plus->constant();
+                        for (auto& p : plus->places())
+                            terms.push_back({p.first, factor});
+                        for (auto& sub : plus->expressions())
+                            if (!linearize(sub.get(), factor, constant, terms))
+                                return false;
+                        return true;
+                    }
+                    case type_id<SubtractExpr>(): {
+                        auto& subs = static_cast<const SubtractExpr*>(e)->expressions();
+                        for (size_t i = 0; i < subs.size(); ++i)
+                            if (!linearize(subs[i].get(), i == 0 ? factor : -factor, constant, terms))
+                                return false;
+                        return true;
+                    }
+                    case type_id<MinusExpr>():
+                        return linearize((*static_cast<const MinusExpr*>(e))[0].get(), -factor, constant, terms);
+                    case type_id<MultiplyExpr>(): {
+                        // linear if at most one factor is not a constant
+                        auto mult = static_cast<const MultiplyExpr*>(e);
+                        int64_t k = mult->constant();
+                        const Expr* variable = nullptr;
+                        for (auto& sub : mult->expressions()) {
+                            int64_t c = 0;
+                            std::vector<Bytecode::term_t> t;
+                            if (!linearize(sub.get(), 1, c, t))
+                                return false;
+                            if (!t.empty()) {
+                                if (variable != nullptr) return false;
+                                variable = sub.get();
+                            }
+                            else
+                                k *= c;
+                        }
+                        if (mult->places().size() + (variable != nullptr ? 1 : 0) > 1)
+                            return false;
+                        if (!mult->places().empty())
+                            terms.push_back({mult->places()[0].first, factor * k});
+                        else if (variable != nullptr)
+                            return linearize(variable, factor * k, constant, terms);
+                        else
+                            constant += factor * k;
+                        return true;
+                    }
+                    default:
+                        return false;
+                }
+            }
+
+            void expression(const Expr* e) {
+                int64_t constant = 0;
+                std::vector<Bytecode::term_t> terms;
+                if (linearize(e, 1, constant, terms)) {
+                    auto pc = open(Bytecode::SUM);
+                    _code._code[pc].constant = constant;
+                    _code._code[pc].arg = _code._terms.size();
+                    _code._code[pc].count = terms.size();
+                    _code._terms.insert(_code._terms.end(), terms.begin(), terms.end());
+                    close(pc);
+                }
+                else
+                    Visitor::visit(this, e);
+            }
+
+            template<typename E>
+            void commutative(const E* element, Bytecode::op_t op) {
+                auto pc = open(op);
+                _code._code[pc].constant = element->constant();
+                _code._code[pc].arg = _code._terms.size();
+                _code._code[pc].count = element->places().size();
+                for (auto& p : element->places())
+                    _code._terms.push_back({p.first, 1});
+                for (auto& sub : element->expressions())
+                    expression(sub.get());
+                close(pc);
+            }
+
+            void _accept(const NotCondition* element) override {
+                auto pc = open(Bytecode::NOT);
+                Visitor::visit(this, element->getCond());
+                close(pc);
+            }
+
+            void _accept(const AndCondition* element) override {
+                auto pc = open(Bytecode::AND);
+                for (auto& c : *element)
+                    Visitor::visit(this, c);
+                close(pc);
+            }
+
+            void _accept(const OrCondition* element) override {
+                auto pc = open(Bytecode::OR);
+                for (auto& c : *element)
+                    Visitor::visit(this, c);
+                close(pc);
+            }
+
+            void _accept(const CompareConjunction* element) override {
+                auto atom = openAtom(element);
+                auto pc = open(Bytecode::CONJUNCTION);
+                _code._code[pc].negated = element->isNegated();
+                _code._code[pc].arg = _code._constraints.size();
+                _code._code[pc].count = element->constraints().size();
+                for (auto& c : element->constraints())
+                    _code._constraints.push_back({c._place, c._lower, c._upper});
+                close(pc);
+                closeAtom(atom);
+            }
+
+            void _accept(const LessThanCondition* element) override {
+                compare(element, Bytecode::LESS);
+            }
+
+            void _accept(const LessThanOrEqualCondition* element) override {
+                compare(element, Bytecode::LESS_EQUAL);
+            }
+
+            void _accept(const EqualCondition* element) override {
+                compare(element, Bytecode::EQUAL);
+            }
+
+            void _accept(const NotEqualCondition* element) override {
+                compare(element, Bytecode::NOT_EQUAL);
+            }
+
+            void _accept(const BooleanCondition* element) override {
+                close(open(element->value ? Bytecode::CONST_TRUE : Bytecode::CONST_FALSE));
+            }
+
+            void _accept(const DeadlockCondition*) override {
+                close(open(Bytecode::DEADLOCK));
+            }
+
+            void _accept(const EFCondition* c) override { quantifier(c, Bytecode::IF_TRUE, Bytecode::OPERAND); }
+            void _accept(const AFCondition* c) override { quantifier(c, Bytecode::IF_TRUE, Bytecode::NEGATED); }
+            void _accept(const ECondition* c) override { quantifier(c, Bytecode::IF_TRUE, Bytecode::NONE); }
+            void _accept(const FCondition* c) override { quantifier(c, Bytecode::IF_TRUE, Bytecode::OPERAND); }
+            void _accept(const EGCondition* c) override { quantifier(c, Bytecode::IF_FALSE, Bytecode::OPERAND); }
+            void _accept(const AGCondition* c) override { quantifier(c, Bytecode::IF_FALSE, Bytecode::NEGATED); }
+            void _accept(const ACondition* c) override { quantifier(c, Bytecode::IF_FALSE, Bytecode::OPERAND); }
+            void _accept(const GCondition* c) override { quantifier(c, Bytecode::IF_FALSE, Bytecode::NEGATED); }
+            void _accept(const EXCondition* c) override { quantifier(c, Bytecode::UNKNOWN, Bytecode::OPERAND); }
+            void _accept(const AXCondition* c) override { quantifier(c, Bytecode::UNKNOWN, Bytecode::NEGATED); }
+            void _accept(const XCondition* c) override { quantifier(c, Bytecode::UNKNOWN, Bytecode::OPERAND); }
+            void _accept(const ControlCondition* c) override { quantifier(c, Bytecode::UNKNOWN, Bytecode::NONE); }
+
+            void _accept(const UntilCondition* c) override { until(c, Bytecode::OPERAND); }
+            void _accept(const EUCondition* c) override { until(c, Bytecode::OPERAND); }
+            void _accept(const AUCondition* c) override { until(c, Bytecode::NEGATED); }
+
+            // upper bounds annotate the condition when evaluated, and the
+            // path selections evaluate in another part of the marking
+            void _accept(const UpperBoundsCondition*) override { _failed = true; }
+            void _accept(const UnfoldedUpperBoundsCondition*) override { _failed = true; }
+            void _accept(const PathSelectCondition*) override { _failed = true; }
+            void _accept(const PathSelectExpr*) override { _failed = true; }
+            void _accept(const PathQuant*) override { _failed = true; }
+
+            void _accept(const PlusExpr* element) override {
+                commutative(element, Bytecode::SUM);
+            }
+
+            void _accept(const MultiplyExpr* element) override {
+                commutative(element, Bytecode::PRODUCT);
+            }
+
+            void _accept(const SubtractExpr* element) override {
+                auto pc = open(Bytecode::SUBTRACT);
+                for (auto& sub : element->expressions())
+                    expression(sub.get());
+                close(pc);
+            }
+
+            void _accept(const MinusExpr* element) override {
+                auto pc = open(Bytecode::MINUS);
+                expression((*element)[0].get());
+                close(pc);
+            }
+
+            void _accept(const LiteralExpr* element) override {
+                expression(element);
+            }
+
+            void _accept(const UnfoldedIdentifierExpr* element) override {
+                expression(element);
+            }
+
+            void _accept(const IdentifierExpr* element) override {
+                if (element->compiled())
+                    expression(element->compiled().get());
+                else
+                    _failed = true;
+            }
+
+        private:
+            Bytecode& _code;
+            const AtomicCache* _atoms;
+            bool _failed = false;
+        };
+
+        std::unique_ptr<Bytecode> Bytecode::compile(const Condition* condition, const PetriNet* net, const AtomicCache* atoms)
+        {
+            auto code = std::make_unique<Bytecode>();
+            code->_net = net;
+            code->_atoms = atoms;
+            BytecodeCompiler compiler(*code, atoms);
+            Visitor::visit(compiler, condition);
+            if (compiler.failed())
+                return nullptr;
+            return code;
+        }
+
+        namespace {
+            // as the delta of the conditions in Expressions.cpp
+
+            uint32_t deltaEqual(int v1, int v2, bool negated) {
+                if (!negated)
+                    return std::abs(v1 - v2);
+                else
+                    return v1 == v2 ? 1 : 0;
+            }
+
+            uint32_t deltaLess(int v1, int v2, bool negated) {
+                if (!negated)
+                    return v1 < v2 ? 0 : v1 - v2 + 1;
+                else
+                    return v1 >= v2 ? 0 : v2 - v1;
+            }
+
+            uint32_t deltaLessEqual(int v1, int v2, bool negated) {
+                if (!negated)
+                    return v1 <= v2 ? 0 : v1 - v2;
+                else
+                    return v1 > v2 ? 0 : v2 - v1 + 1;
+            }
+        }
+
+        Condition::Result Bytecode::evaluate(const MarkVal* marking) const
+        {
+            return evaluateAt(0, marking);
+        }
+
+        uint32_t Bytecode::distance(const MarkVal* marking, bool negated) const
+        {
+            return distanceAt(0, marking, negated);
+        }
+
+        Condition::Result Bytecode::evaluateAt(uint32_t pc, const MarkVal* marking) const
+        {
+            auto& in = _code[pc];
+            switch (in.op) {
+                case CONST_TRUE:
+                    return Condition::RTRUE;
+                case CONST_FALSE:
+                    return Condition::RFALSE;
+                case DEADLOCK:
+                    return _net != nullptr && _net->deadlocked(marking) ? Condition::RTRUE : Condition::RFALSE;
+                case CONJUNCTION: {
+                    bool res = true;
+                    for (auto c = _constraints.data() + in.arg; c != _constraints.data() + in.arg + in.count; ++c) {
+                        if (marking[c->place] > c->upper || marking[c->place] < c->lower) {
+                            res = false;
+                            break;
+                        }
+                    }
+                    return (in.negated xor res) ? Condition::RTRUE : Condition::RFALSE;
+                }
+                case ATOM:
+                    return _atoms->value(in.arg) ? Condition::RTRUE : Condition::RFALSE;
+                case LESS:
+                case LESS_EQUAL:
+                case EQUAL:
+                case NOT_EQUAL: {
+                    auto v1 = valueAt(pc + 1, marking);
+                    auto v2 = valueAt(_code[pc + 1].end, marking);
+                    bool res = in.op == LESS ? v1 < v2 :
+                               in.op == LESS_EQUAL ? v1 <= v2 :
+                               in.op == EQUAL ? v1 == v2 : v1 != v2;
+                    return res ? Condition::RTRUE : Condition::RFALSE;
+                }
+                case NOT: {
+                    auto res = evaluateAt(pc + 1, marking);
+                    if (res == Condition::RUNKNOWN) return res;
+                    return res == Condition::RFALSE ? Condition::RTRUE : Condition::RFALSE;
+                }
+                case AND:
+                case OR: {
+                    // the value concluding the connective
+                    auto stop = in.op == AND ? Condition::RFALSE : Condition::RTRUE;
+                    auto res = in.op == AND ? Condition::RTRUE : Condition::RFALSE;
+                    for (auto sub = pc + 1; sub != in.end; sub = _code[sub].end) {
+                        auto r = evaluateAt(sub, marking);
+                        if (r == stop) return stop;
+                        if (r == Condition::RUNKNOWN) res = Condition::RUNKNOWN;
+                    }
+                    return res;
+                }
+                case IF_TRUE:
+                    return evaluateAt(pc + 1, marking) == Condition::RTRUE ? Condition::RTRUE : Condition::RUNKNOWN;
+                case IF_FALSE:
+                    return evaluateAt(pc + 1, marking) == Condition::RFALSE ? Condition::RFALSE : Condition::RUNKNOWN;
+                case UNKNOWN:
+                    return Condition::RUNKNOWN;
+                case UNTIL: {
+                    auto res = evaluateAt(_code[pc + 1].end, marking);
+                    if (res != Condition::RFALSE) return res;
+                    return evaluateAt(pc + 1, marking) == Condition::RFALSE ? Condition::RFALSE : Condition::RUNKNOWN;
+                }
+                default:
+                    assert(false);
+                    throw base_error("Evaluating an expression as a condition");
+            }
+        }
+
+        int64_t Bytecode::valueAt(uint32_t pc, const MarkVal* marking) const
+        {
+            auto& in = _code[pc];
+            int64_t r = in.constant;
+            switch (in.op) {
+                case SUM:
+                    for (auto t = _terms.data() + in.arg; t != _terms.data() + in.arg + in.count; ++t)
+                        r += t->coefficient * marking[t->place];
+                    for (auto sub = pc + 1; sub != in.end; sub = _code[sub].end)
+                        r += valueAt(sub, marking);
+                    return r;
+                case PRODUCT:
+                    for (auto t = _terms.data() + in.arg; t != _terms.data() + in.arg + in.count; ++t)
+                        r *= marking[t->place];
+                    for (auto sub = pc + 1; sub != in.end; sub = _code[sub].end)
+                        r *= valueAt(sub, marking);
+                    return r;
+                case SUBTRACT:
+                    r = valueAt(pc + 1, marking);
+                    for (auto sub = _code[pc + 1].end; sub != in.end; sub = _code[sub].end)
+                        r -= valueAt(sub, marking);
+                    return r;
+                case MINUS:
+                    return -valueAt(pc + 1, marking);
+                default:
+                    assert(false);
+                    throw base_error("Evaluating a condition as an expression");
+            }
+        }
+
+        uint32_t Bytecode::distanceAt(uint32_t pc, const MarkVal* marking, bool negated) const
+        {
+            auto& in = _code[pc];
+            switch (in.op) {
+                case CONST_TRUE:
+                case CONST_FALSE:
+                    if (negated != (in.op == CONST_TRUE))
+                        return 0;
+                    return std::numeric_limits<uint32_t>::max();
+                case DEADLOCK:
+                    return 0;
+                case CONJUNCTION: {
+                    uint32_t d = 0;
+                    auto neg = negated != in.negated;
+                    auto begin = _constraints.data() + in.arg;
+                    auto end = begin + in.count;
+                    if (!neg) {
+                        for (auto c = begin; c != end; ++c) {
+                            auto pv = marking[c->place];
+                            d += (c->upper == std::numeric_limits<uint32_t>::max() ? 0 : deltaLessEqual(pv, c->upper, neg)) +
+                                 (c->lower == 0 ? 0 : deltaLessEqual(c->lower, pv, neg));
+                        }
+                    }
+                    else {
+                        bool first = true;
+                        for (auto c = begin; c != end; ++c) {
+                            auto pv = marking[c->place];
+                            if (c->upper != std::numeric_limits<uint32_t>::max()) {
+                                auto d2 = deltaLessEqual(pv, c->upper, neg);
+                                d = first ? d2 : std::min(d, d2);
+                                first = false;
+                            }
+                            if (c->lower != 0) {
+                                auto d2 = deltaLessEqual(c->upper, pv, neg);
+                                d = first ? d2 : std::min(d, d2);
+                                first = false;
+                            }
+                        }
+                    }
+                    return d;
+                }
+                case ATOM:
+                    return distanceAt(pc + 1, marking, negated);
+                case LESS:
+                case LESS_EQUAL:
+                case EQUAL:
+                case NOT_EQUAL: {
+                    // the distances of the conditions see the values as unsigned 32-bit
+                    int v1 = (uint32_t)valueAt(pc + 1, marking);
+                    int v2 = (uint32_t)valueAt(_code[pc + 1].end, marking);
+                    switch (in.op) {
+                        case LESS: return deltaLess(v1, v2, negated);
+                        case LESS_EQUAL: return deltaLessEqual(v1, v2, negated);
+                        case EQUAL: return deltaEqual(v1, v2, negated);
+                        default: return deltaEqual(v1, v2, !negated);
+                    }
+                }
+                case NOT:
+                    return distanceAt(pc + 1, marking, !negated);
+                case AND:
+                case OR: {
+                    if ((in.op == AND) != negated) {
+                        uint32_t val = 0;
+                        for (auto sub = pc + 1; sub != in.end; sub = _code[sub].end)
+                            val += distanceAt(sub, marking, negated);
+                        return val;
+                    }
+                    uint32_t val = std::numeric_limits<uint32_t>::max();
+                    for (auto sub = pc + 1; sub != in.end; sub = _code[sub].end)
+                        val = std::min(distanceAt(sub, marking, negated), val);
+                    return val;
+                }
+                case IF_TRUE:
+                case IF_FALSE:
+                case UNKNOWN:
+                    if (in.dist == NONE)
+                        throw base_error("Computing distance on a quantifier without one");
+                    return distanceAt(pc + 1, marking, negated != (in.dist == NEGATED));
+                case UNTIL:
+                    if (in.dist == NEGATED)
+                        return distanceAt(pc + 1, marking, !negated) + distanceAt(_code[pc + 1].end, marking, !negated);
+                    return distanceAt(_code[pc + 1].end, marking, negated);
+                default:
+                    assert(false);
+                    throw base_error("Computing distance on an expression");
+            }
+        }
+
+        uint32_t distance(const Condition* query, DistanceContext& context)
+        {
+            if (context.incremental() != nullptr && !context.negated())
+                return context.incremental()->value();
+            if (context.program() != nullptr)
+                return context.program()->distance(context.marking(), context.negated());
+            return query->distance(context);
+        }
+    }
+}
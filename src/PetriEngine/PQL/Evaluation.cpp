@@ -19,6 +19,7 @@
  */
 
 #include "PetriEngine/PQL/Evaluation.h"
+#include "PetriEngine/PQL/AtomicCache.h"
 
 namespace PetriEngine { namespace PQL {
 
@@ -46,6 +47,15 @@ namespace PetriEngine { namespace PQL {
             return C::fail_hard_here;
     }
 
+    // takes the value of an atomic proposition from the cache of the context, if it is there
+    bool cached(const EvaluationContext& context, const Condition* condition, Condition::Result& result)
+    {
+        if (context.atoms() == nullptr)
+            return false;
+        result = context.atoms()->lookup(condition);
+        return result != Condition::RUNKNOWN;
+    }
+
     template<typename V, typename E>
     int64_t commutative(V* visitor, const E* element, const EvaluationContext& context) {
         int64_t r = element->constant();
@@ -230,6 +240,8 @@ namespace PetriEngine { namespace PQL {
     }
 
     void EvaluateVisitor::_accept(CompareConjunction *element) {
+        if (cached(_context, element, _return_value))
+            return;
         bool res = true;
         for (auto &c: element->constraints()) {
             res = res && _context.marking()[c._place] <= c._upper && _context.marking()[c._place] >= c._lower;
@@ -239,21 +251,29 @@ namespace PetriEngine { namespace PQL {
     }
 
     void EvaluateVisitor::_accept(LessThanOrEqualCondition *element) {
+        if (cached(_context, element, _return_value))
+            return;
         _return_value = {compare(this, element) ?
             Condition::RTRUE : Condition::RFALSE};
     }
 
     void EvaluateVisitor::_accept(LessThanCondition *element) {
+        if (cached(_context, element, _return_value))
+            return;
         _return_value = {compare(this, element) ?
             Condition::RTRUE : Condition::RFALSE};
     }
 
     void EvaluateVisitor::_accept(EqualCondition *element) {
+        if (cached(_context, element, _return_value))
+            return;
         _return_value = {compare(this, element) ?
             Condition::RTRUE : Condition::RFALSE};
     }
 
     void EvaluateVisitor::_accept(NotEqualCondition *element) {
+        if (cached(_context, element, _return_value))
+            return;
         _return_value = {compare(this, element) ?
             Condition::RTRUE : Condition::RFALSE};
     }
@@ -0,0 +1,176 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PetriEngine/PQL/IncrementalDistance.h"
+#include "utils/errors.h"
+
+#include <algorithm>
+#include <limits>
+
+namespace PetriEngine {
+    namespace PQL {
+
+        IncrementalDistance::IncrementalDistance(const Bytecode& program, const PetriNet& net)
+        : _program(program)
+        {
+            std::vector<std::vector<uint32_t>> placeLeaves(net.numberOfPlaces());
+            build(0, false, placeLeaves);
+
+            const uint32_t ntrans = net.numberOfTransitions();
+            const FiringArc* arcs = net.firingArcs();
+            std::vector<uint32_t> stamp(_leaves.size(), std::numeric_limits<uint32_t>::max());
+            _affectedPtrs.resize(ntrans + 1, 0);
+            _recompute.resize(ntrans, false);
+            for (uint32_t t = 0; t < ntrans; ++t) {
+                auto& record = net.firing(t);
+                size_t begin = _affected.size();
+                for (auto arc = arcs + record.begin; arc != arcs + record.end; ++arc) {
+                    if (arc->delta == 0) continue;
+                    for (auto l : placeLeaves[arc->place]) {
+                        if (stamp[l] == t) continue;
+                        stamp[l] = t;
+                        _affected.push_back(l);
+                    }
+                }
+                if ((_affected.size() - begin) * 2 > _leaves.size()) {
+                    _affected.resize(begin);
+                    _recompute[t] = true;
+                }
+                _affectedPtrs[t + 1] = _affected.size();
+            }
+            _affected.shrink_to_fit();
+
+            _parent.resize(program._code.size(), 0);
+            _current.resize(program._code.size(), 0);
+        }
+
+        void IncrementalDistance::build(uint32_t pc, bool negated, std::vector<std::vector<uint32_t>>& placeLeaves)
+        {
+            auto& code = _program._code;
+            auto& in = code[pc];
+            switch (in.op) {
+                case Bytecode::NOT:
+                    _nodes.push_back({pc, FIRST});
+                    build(pc + 1, !negated, placeLeaves);
+                    return;
+                case Bytecode::AND:
+                case Bytecode::OR:
+                    _nodes.push_back({pc, (in.op == Bytecode::AND) != negated ? SUM : MIN});
+                    for (auto sub = pc + 1; sub != in.end; sub = code[sub].end)
+                        build(sub, negated, placeLeaves);
+                    return;
+                case Bytecode::IF_TRUE:
+                case Bytecode::IF_FALSE:
+                case Bytecode::UNKNOWN:
+                    if (in.dist == Bytecode::NONE)
+                        throw base_error("Computing distance on a quantifier without one");
+                    _nodes.push_back({pc, FIRST});
+                    build(pc + 1, negated != (in.dist == Bytecode::NEGATED), placeLeaves);
+                    return;
+                case Bytecode::UNTIL:
+                    if (in.dist == Bytecode::NEGATED) {
+                        _nodes.push_back({pc, SUM});
+                        build(pc + 1, !negated, placeLeaves);
+                        build(code[pc + 1].end, !negated, placeLeaves);
+                    }
+                    else {
+                        _nodes.push_back({pc, SECOND});
+                        build(code[pc + 1].end, negated, placeLeaves);
+                    }
+                    return;
+                default:
+                    break;
+            }
+
+            // a comparison (or constant), measured as a whole
+            uint32_t leaf = _leaves.size();
+            _leaves.push_back({pc, negated});
+            auto add = [&](uint32_t place) {
+                auto& leaves = placeLeaves[place];
+                if (leaves.empty() || leaves.back() != leaf)
+                    leaves.push_back(leaf);
+            };
+            for (auto sub = pc; sub != in.end; ++sub) {
+                auto& s = code[sub];
+                if (s.op == Bytecode::CONJUNCTION) {
+                    for (uint32_t i = s.arg; i < s.arg + s.count; ++i)
+                        add(_program._constraints[i].place);
+                }
+                else if (s.op == Bytecode::SUM || s.op == Bytecode::PRODUCT) {
+                    for (uint32_t i = s.arg; i < s.arg + s.count; ++i)
+                        add(_program._terms[i].place);
+                }
+            }
+        }
+
+        void IncrementalDistance::combine(std::vector<uint32_t>& values) const
+        {
+            auto& code = _program._code;
+            // the operands follow their operator, so they are combined first
+            for (auto n = _nodes.rbegin(); n != _nodes.rend(); ++n) {
+                auto& in = code[n->pc];
+                switch (n->combine) {
+                    case SUM: {
+                        uint32_t val = 0;
+                        for (auto sub = n->pc + 1; sub != in.end; sub = code[sub].end)
+                            val += values[sub];
+                        values[n->pc] = val;
+                        break;
+                    }
+                    case MIN: {
+                        uint32_t val = std::numeric_limits<uint32_t>::max();
+                        for (auto sub = n->pc + 1; sub != in.end; sub = code[sub].end)
+                            val = std::min(values[sub], val);
+                        values[n->pc] = val;
+                        break;
+                    }
+                    case FIRST:
+                        values[n->pc] = values[n->pc + 1];
+                        break;
+                    case SECOND:
+                        values[n->pc] = values[code[n->pc + 1].end];
+                        break;
+                }
+            }
+        }
+
+        uint32_t IncrementalDistance::evaluate(const MarkVal* marking)
+        {
+            for (auto& l : _leaves)
+                _parent[l.pc] = _program.distanceAt(l.pc, marking, l.negated);
+            combine(_parent);
+            _current = _parent;
+            return _current[0];
+        }
+
+        uint32_t IncrementalDistance::successor(const MarkVal* marking, uint32_t fired)
+        {
+            _current = _parent;
+            if (_recompute[fired]) {
+                for (auto& l : _leaves)
+                    _current[l.pc] = _program.distanceAt(l.pc, marking, l.negated);
+            }
+            else {
+                for (size_t i = _affectedPtrs[fired]; i < _affectedPtrs[fired + 1]; ++i) {
+                    auto& l = _leaves[_affected[i]];
+                    _current[l.pc] = _program.distanceAt(l.pc, marking, l.negated);
+                }
+            }
+            combine(_current);
+            return _current[0];
+        }
+    }
+}
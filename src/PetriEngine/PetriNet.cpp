@@ -26,6 +26,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <algorithm>
+#include <limits>
 
 namespace PetriEngine {
 
@@ -143,16 +145,14 @@ namespace PetriEngine {
 
     bool PetriNet::fireable(const MarkVal *marking, int transitionIndex)
     {
-        const TransPtr& transition = _transitions[transitionIndex];
-        uint32_t first = transition.inputs;
-        uint32_t last = transition.outputs;
-
-        for(;first < last; ++first){
-            const Invariant& inv = _invariants[first];
-            if(inv.inhibitor == (marking[inv.place] >= inv.tokens))
-                return false;
-        }
-        return true;
+        const FiringRecord& record = _firing[transitionIndex];
+        return visitFiringArcs([&](auto arcs) {
+            for(auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc){
+                if(arc->inhibitor == (marking[arc->place] >= arc->tokens))
+                    return false;
+            }
+            return true;
+        });
     }
 
     MarkVal PetriNet::initial(size_t id) const {
@@ -177,6 +177,62 @@ namespace PetriEngine {
         }
     }
 
+    void PetriNet::compile()
+    {
+        _firing.resize(_ntransitions);
+        _firingArcs.clear();
+        _firingArcs.reserve(_ninvariants);
+        for(uint32_t t = 0; t < _ntransitions; ++t)
+        {
+            auto& record = _firing[t];
+            record.begin = _firingArcs.size();
+            record.unit = true;
+            auto pre = preset(t);
+            auto post = postset(t);
+            for(auto it = pre.first; it != pre.second; ++it)
+            {
+                _firingArcs.push_back({it->place, it->tokens, 0, it->inhibitor, false});
+                record.unit &= !it->inhibitor && it->tokens == 1;
+                if(!it->inhibitor)
+                    _firingArcs.back().delta = -(int32_t)it->tokens;
+            }
+            record.guards = _firingArcs.size();
+            for(auto it = post.first; it != post.second; ++it)
+            {
+                // merge into the consuming arc of the same place, if any
+                auto guards = _firingArcs.data() + record.guards;
+                auto arc = std::find_if(_firingArcs.data() + record.begin, guards, [it](auto& a) {
+                    return a.place == it->place && !a.inhibitor;
+                });
+                if(arc != guards)
+                {
+                    arc->delta += it->tokens;
+                    arc->selfloop = arc->delta == 0;
+                }
+                else
+                    _firingArcs.push_back({it->place, 0, (int32_t)it->tokens, false, false});
+            }
+            record.end = _firingArcs.size();
+        }
+
+        _compactArcs.clear();
+        bool compact = _nplaces <= (uint32_t)std::numeric_limits<uint16_t>::max() + 1;
+        for(auto& arc : _firingArcs)
+        {
+            compact &= arc.tokens <= (uint32_t)std::numeric_limits<int16_t>::max() &&
+                       std::abs(arc.delta) <= std::numeric_limits<int16_t>::max();
+        }
+        if(compact)
+        {
+            _compactArcs.reserve(_firingArcs.size());
+            for(auto& arc : _firingArcs)
+            {
+                _compactArcs.push_back({(uint16_t)arc.place, (uint16_t)arc.tokens, (int16_t)arc.delta,
+                                        arc.inhibitor, arc.selfloop});
+            }
+        }
+    }
+
     void PetriNet::toXML(std::ostream& out)
     {
         out << "<?xml version=\"1.0\"?>\n"
@@ -251,4 +307,38 @@ namespace PetriEngine {
         out << "</page></net>\n</pnml>";
     }
 
+    uint64_t PetriNet::hash() const
+    {
+        // FNV-1a, stable across platforms and runs
+        uint64_t h = 14695981039346656037ULL;
+        auto mix = [&h](uint64_t v) {
+            for(size_t b = 0; b < sizeof(v); ++b)
+            {
+                h ^= (v >> (b * 8)) & 0xFF;
+                h *= 1099511628211ULL;
+            }
+        };
+        mix(_nplaces);
+        mix(_ntransitions);
+        for(size_t p = 0; p < _nplaces; ++p)
+            mix(_initialMarking[p]);
+        for(size_t t = 0; t < _ntransitions; ++t)
+        {
+            for(auto pre = preset(t); pre.first != pre.second; ++pre.first)
+            {
+                mix(pre.first->place);
+                mix(pre.first->tokens);
+                mix(pre.first->inhibitor);
+            }
+            mix(std::numeric_limits<uint64_t>::max());
+            for(auto post = postset(t); post.first != post.second; ++post.first)
+            {
+                mix(post.first->place);
+                mix(post.first->tokens);
+            }
+            mix(std::numeric_limits<uint64_t>::max());
+        }
+        return h;
+    }
+
 } // PetriEngine
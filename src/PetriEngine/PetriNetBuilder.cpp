@@ -524,6 +524,7 @@ namespace PetriEngine {
                 }
             }
         }
+        net->compile();
         return net;
     }
 
@@ -21,11 +21,22 @@
 #include "PetriEngine/PQL/PQL.h"
 #include "PetriEngine/PQL/Contexts.h"
 #include "PetriEngine/PQL/Evaluation.h"
+#include "PetriEngine/PQL/PredicateCheckers.h"
+#include "PetriEngine/PQL/QueryPrinter.h"
 #include "PetriEngine/Structures/StateSet.h"
 #include "PetriEngine/SuccessorGenerator.h"
 
 #include "PetriEngine/Structures/PotencyQueue.h"
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
 using namespace PetriEngine::PQL;
 using namespace PetriEngine::Structures;
 
@@ -35,43 +46,48 @@ namespace PetriEngine {
         bool ReachabilitySearch::checkQueries(  std::vector<std::shared_ptr<PQL::Condition > >& queries,
                                                 std::vector<ResultPrinter::Result>& results,
                                                 State& state,
-                                                searchstate_t& ss, StateSetInterface* states)
+                                                searchstate_t& ss, StateSetInterface* states,
+                                                const PQL::AtomicCache* atoms, const programs_t* programs)
         {
             if(!ss.usequeries) return false;
 
-            bool alldone = true;
-            for(size_t i = 0; i < queries.size(); ++i)
+            bool answered = false;
+            for(auto i : ss.open)
             {
-                if(results[i] == ResultPrinter::Unknown)
+                Condition::Result res;
+                if(programs != nullptr && (*programs)[i])
+                    res = (*programs)[i]->evaluate(state.marking());
+                else
                 {
                     EvaluationContext ec(state.marking(), &_net);
-                    if(PetriEngine::PQL::evaluate(queries[i].get(), ec) == Condition::RTRUE)
-                    {
-                        auto r = doCallback(queries[i], i, ResultPrinter::Satisfied, ss, states);
-                        results[i] = r.first;
-                        if(r.second)
-                            return true;
-                    }
-                    else
-                    {
-                        alldone = false;
-                    }
+                    ec.setAtoms(atoms);
+                    res = PetriEngine::PQL::evaluate(queries[i].get(), ec);
                 }
-                if( i == ss.heurquery &&
-                    results[i] != ResultPrinter::Unknown)
+                if(res == Condition::RTRUE)
                 {
-                    if(queries.size() >= 2)
-                    {
-                        for(size_t n = 1; n < queries.size(); ++n)
-                        {
-                            ss.heurquery = (ss.heurquery + n) % queries.size();
-                            if(results[i] == ResultPrinter::Unknown)
-                                break;
-                        }
-                    }
+                    auto r = doCallback(queries[i], i, ResultPrinter::Satisfied, ss, states);
+                    results[i] = r.first;
+                    if(r.second)
+                        return true;
+                    answered |= results[i] != ResultPrinter::Unknown;
                 }
             }
-            return alldone;
+            if(answered)
+                retireQueries(ss, results);
+            return ss.open.empty();
+        }
+
+        void ReachabilitySearch::retireQueries(searchstate_t& ss, const std::vector<ResultPrinter::Result>& results)
+        {
+            ss.open.erase(std::remove_if(ss.open.begin(), ss.open.end(),
+                                         [&](size_t i) { return results[i] != ResultPrinter::Unknown; }),
+                          ss.open.end());
+            // the heuristic moves on to the next open query
+            if(!ss.open.empty() && results[ss.heurquery] != ResultPrinter::Unknown)
+            {
+                auto next = std::upper_bound(ss.open.begin(), ss.open.end(), ss.heurquery);
+                ss.heurquery = next == ss.open.end() ? ss.open.front() : *next;
+            }
         }
 
         std::pair<ResultPrinter::Result,bool> ReachabilitySearch::doCallback(std::shared_ptr<PQL::Condition>& query, size_t i, ResultPrinter::Result r,
@@ -82,6 +98,261 @@ namespace PetriEngine {
                         states, _satisfyingMarking, _initial.marking());
         }
 
+        namespace {
+            /**
+             * Forwards the answers of the swarm workers to the real handler,
+             * only the first answer to each query.
+             */
+            class SwarmHandler : public AbstractHandler {
+            public:
+                SwarmHandler(AbstractHandler& callback, std::vector<Result>& results, std::atomic<bool>& stop)
+                : _callback(callback), _results(results), _stop(stop) {
+                    _open = std::count(results.begin(), results.end(), Unknown);
+                    if(_open == 0)
+                        _stop = true;
+                }
+
+                std::pair<Result, bool> handle(
+                    size_t index,
+                    PQL::Condition* query,
+                    Result result,
+                    const std::vector<uint32_t>* maxPlaceBound,
+                    size_t expandedStates,
+                    size_t exploredStates,
+                    size_t discoveredStates,
+                    int maxTokens,
+                    Structures::StateSetInterface* stateset, size_t lastmarking, const MarkVal* initialMarking, bool trace) override
+                {
+                    std::lock_guard<std::mutex> guard(_lock);
+                    // answered by another worker
+                    if(_results[index] != Unknown)
+                        return std::make_pair(_results[index], _stop.load());
+                    auto r = _callback.handle(index, query, result, maxPlaceBound, expandedStates, exploredStates,
+                                              discoveredStates, maxTokens, stateset, lastmarking, initialMarking, trace);
+                    _results[index] = r.first;
+                    if(r.first != Unknown)
+                        --_open;
+                    if(r.second || _open == 0)
+                        _stop = true;
+                    return r;
+                }
+
+            private:
+                AbstractHandler& _callback;
+                std::vector<Result>& _results;
+                std::atomic<bool>& _stop;
+                std::mutex _lock;
+                size_t _open;
+            };
+
+            const char* strategyName(Strategy strategy) {
+                switch(strategy)
+                {
+                    case Strategy::BFS: return "BFS";
+                    case Strategy::DFS: return "DFS";
+                    case Strategy::HEUR: return "BestFS";
+                    case Strategy::RDFS: return "RDFS";
+                    case Strategy::RPFS: return "RPFS";
+                    default: return "OverApprox";
+                }
+            }
+        }
+
+        bool ReachabilitySearch::swarm(
+                    std::vector<std::shared_ptr<PQL::Condition > >& queries,
+                    std::vector<ResultPrinter::Result>& results,
+                    Strategy strategy,
+                    bool stubbornreduction,
+                    bool printstats,
+                    bool keep_trace,
+                    size_t seed,
+                    uint32_t workers,
+                    uint32_t cores)
+        {
+            if(!_external.directory.empty() || !_checkpoint.file.empty() || !_checkpoint.resume.empty())
+                throw base_error("The swarm does not support the external-memory search or checkpoints");
+
+            // upper-bound queries are refined during evaluation and cannot be shared between workers
+            for(auto& q : queries)
+                if(containsUpperBounds(q))
+                    workers = 1;
+            if(workers <= 1)
+                return reachable(queries, results, strategy, stubbornreduction, false, printstats, keep_trace, seed, cores);
+
+            // the other workers cycle through the randomized and heuristic searches, every other round of
+            // them with the opposite use of stubborn sets
+            const Strategy strategies[] = {Strategy::RDFS, Strategy::RPFS, Strategy::HEUR};
+            const size_t nstrategies = sizeof(strategies) / sizeof(strategies[0]);
+
+            // answered before the search, the workers read it while results is updated
+            const std::vector<ResultPrinter::Result> initial = results;
+            std::atomic<bool> stop = false;
+            SwarmHandler handler(_callback, results, stop);
+            std::mutex query_lock;
+            std::mutex error_lock;
+            std::exception_ptr error;
+            std::vector<size_t> maxTokens(workers, 0);
+            std::vector<std::thread> threads;
+            for(uint32_t w = 0; w < workers; ++w)
+            {
+                auto s = w == 0 ? strategy : strategies[(w - 1) % nstrategies];
+                bool stubborn = (w == 0 || ((w - 1) / nstrategies) % 2 == 1) ? stubbornreduction : !stubbornreduction;
+                threads.emplace_back([&, w, s, stubborn] {
+                    try
+                    {
+                        ReachabilitySearch worker(_net, handler, _kbound);
+                        worker._bitstate = _bitstate;
+                        worker._enabledCache = _enabledCache;
+                        worker._cancel = &stop;
+                        worker._query_lock = &query_lock;
+                        auto local = initial;
+                        worker.reachable(queries, local, s, stubborn, false, false, keep_trace, seed + w);
+                        maxTokens[w] = worker.maxTokens();
+                        if(printstats)
+                        {
+                            std::lock_guard<std::mutex> guard(error_lock);
+                            std::cout << "Swarm worker " << w << ": " << strategyName(s)
+                                      << (stubborn ? " with" : " without") << " stubborn sets" << std::endl;
+                        }
+                    }
+                    catch(...)
+                    {
+                        std::lock_guard<std::mutex> guard(error_lock);
+                        if(!error)
+                            error = std::current_exception();
+                        stop = true;
+                    }
+                });
+            }
+            for(auto& t : threads)
+                t.join();
+            if(error)
+                std::rethrow_exception(error);
+            _max_tokens = *std::max_element(maxTokens.begin(), maxTokens.end());
+            return stop;
+        }
+
+        bool ReachabilitySearch::checkpointDue(searchstate_t& ss)
+        {
+            if(_checkpoint.file.empty())
+                return false;
+            // an interval of zero checkpoints after every expansion, otherwise the clock is only sampled now and then
+            if(_checkpoint.interval == 0)
+                return true;
+            if((ss.expandedStates % 4096) != 0)
+                return false;
+            auto now = std::chrono::steady_clock::now();
+            if(std::chrono::duration_cast<std::chrono::seconds>(now - _checkpoint.last).count() < (int64_t)_checkpoint.interval)
+                return false;
+            _checkpoint.last = now;
+            return true;
+        }
+
+        namespace {
+            const char CHECKPOINT_MAGIC[8] = {'V', 'P', 'N', 'C', 'K', 'P', 'T', '2'};
+
+            // FNV-1a of the printed queries, so a resume with other queries of the same count is refused
+            uint64_t queryHash(const std::vector<std::shared_ptr<PQL::Condition>>& queries)
+            {
+                uint64_t h = 14695981039346656037ULL;
+                for(auto& q : queries)
+                {
+                    std::stringstream ss;
+                    PQL::QueryPrinter printer(ss);
+                    PQL::Visitor::visit(printer, q);
+                    ss << '\n';
+                    for(char c : ss.str())
+                    {
+                        h ^= (unsigned char)c;
+                        h *= 1099511628211ULL;
+                    }
+                }
+                return h;
+            }
+
+            template<typename T>
+            void put(std::ostream& out, const T& v) {
+                out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+            }
+
+            template<typename T>
+            T get(std::istream& in) {
+                T v;
+                in.read(reinterpret_cast<char*>(&v), sizeof(T));
+                if(!in)
+                    throw base_error("Checkpoint is truncated");
+                return v;
+            }
+        }
+
+        void ReachabilitySearch::writeCheckpoint(const std::string& kind, const std::vector<std::shared_ptr<PQL::Condition>>& queries,
+                                                 std::vector<ResultPrinter::Result>& results,
+                                                 searchstate_t& ss, StateSetInterface& states, Queue& queue)
+        {
+            // write to a temporary file first, a preemption while writing must not destroy the last checkpoint
+            auto tmp = _checkpoint.file + ".tmp";
+            {
+                std::ofstream out(tmp, std::ios::binary);
+                out.write(CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+                put<uint64_t>(out, _net.hash());
+                put<uint64_t>(out, kind.size());
+                out.write(kind.data(), kind.size());
+                put<uint64_t>(out, results.size());
+                put<uint64_t>(out, queryHash(queries));
+                for(auto r : results)
+                    put<int32_t>(out, r);
+                put<uint64_t>(out, ss.expandedStates);
+                put<uint64_t>(out, ss.exploredStates);
+                put<uint64_t>(out, ss.heurquery);
+                for(auto c : ss.enabledTransitionsCount)
+                    put<uint64_t>(out, c);
+                states.write(out);
+                queue.write(out);
+                if(!out)
+                    throw base_error("Could not write checkpoint to ", _checkpoint.file);
+            }
+            std::remove(_checkpoint.file.c_str());
+            if(std::rename(tmp.c_str(), _checkpoint.file.c_str()) != 0)
+                throw base_error("Could not write checkpoint to ", _checkpoint.file);
+        }
+
+        void ReachabilitySearch::readCheckpoint(const std::string& kind, const std::vector<std::shared_ptr<PQL::Condition>>& queries,
+                                                std::vector<ResultPrinter::Result>& results,
+                                                searchstate_t& ss, StateSetInterface& states, Queue& queue)
+        {
+            std::ifstream in(_checkpoint.resume, std::ios::binary);
+            if(!in)
+                throw base_error("Could not open checkpoint ", _checkpoint.resume);
+            char magic[sizeof(CHECKPOINT_MAGIC)];
+            in.read(magic, sizeof(magic));
+            if(!in || memcmp(magic, CHECKPOINT_MAGIC, sizeof(magic)) != 0)
+                throw base_error("Not a checkpoint file ", _checkpoint.resume);
+            if(get<uint64_t>(in) != _net.hash())
+                throw base_error("Checkpoint was made for a different (reduced) net");
+            std::string stored(get<uint64_t>(in), '\0');
+            in.read(stored.data(), stored.size());
+            if(stored != kind)
+                throw base_error("Checkpoint was made with a different search configuration");
+            if(get<uint64_t>(in) != results.size())
+                throw base_error("Checkpoint was made for a different number of queries");
+            if(get<uint64_t>(in) != queryHash(queries))
+                throw base_error("Checkpoint was made for different queries");
+            for(auto& r : results)
+            {
+                auto result = (ResultPrinter::Result)get<int32_t>(in);
+                // answers are printed when found, so only restore which queries are done
+                if(result != ResultPrinter::Unknown)
+                    r = ResultPrinter::Ignore;
+            }
+            ss.expandedStates = get<uint64_t>(in);
+            ss.exploredStates = get<uint64_t>(in);
+            ss.heurquery = get<uint64_t>(in);
+            for(auto& c : ss.enabledTransitionsCount)
+                c = get<uint64_t>(in);
+            states.read(in);
+            queue.read(in);
+        }
+
         void ReachabilitySearch::printStats(searchstate_t& ss, Structures::StateSetInterface* states)
         {
             std::cout   << "STATS:\n"
@@ -117,8 +388,10 @@ namespace PetriEngine {
             std::cout << std::endl << std::endl;
         }
 
-#define TRYREACHPAR    (queries, results, usequeries, printstats, seed)
-#define TEMPPAR(X, Y)  if(keep_trace) return tryReach<X, Structures::TracableStateSet, Y>TRYREACHPAR ; \
+#define TRYREACHPAR    (queries, results, usequeries, printstats, seed, keep_trace)
+#define TEMPPAR(X, Y)  if(_bitstate.bits > 0) return tryReach<X, Structures::BitStateSet, Y>TRYREACHPAR ; \
+                       else if(cores > 1) return tryReachParallel<X, Y>(queries, results, usequeries, printstats, keep_trace, seed, cores); \
+                       else if(keep_trace) return tryReach<X, Structures::TracableStateSet, Y>TRYREACHPAR ; \
                        else return tryReach<X, Structures::StateSet, Y> TRYREACHPAR;
 #define TRYREACH(X)    if(stubbornreduction) TEMPPAR(X, ReducingSuccessorGenerator) \
                        else TEMPPAR(X, SuccessorGenerator)
@@ -136,13 +409,35 @@ namespace PetriEngine {
                     bool statespacesearch,
                     bool printstats,
                     bool keep_trace,
-                    size_t seed)
+                    size_t seed,
+                    uint32_t cores)
         {
             bool usequeries = !statespacesearch;
 
             // if we are searching for bounds
             if(!usequeries) strategy = Strategy::BFS;
 
+            if(!_checkpoint.file.empty() || !_checkpoint.resume.empty())
+            {
+                if(!_external.directory.empty() || _bitstate.bits > 0 || cores > 1 || strategy == Strategy::RPFS)
+                    throw base_error("Checkpoints are only supported by the sequential BFS, DFS, RDFS and HEUR searches");
+            }
+
+            if(!_external.directory.empty())
+            {
+                if(keep_trace)
+                    throw base_error("Traces are not supported by the external-memory search");
+                if(stubbornreduction)
+                    return tryReachExternal<ReducingSuccessorGenerator>(queries, results, usequeries, printstats);
+                else
+                    return tryReachExternal<SuccessorGenerator>(queries, results, usequeries, printstats);
+            }
+
+            // upper-bound queries are refined during evaluation and cannot be shared between workers
+            for(auto& q : queries)
+                if(containsUpperBounds(q))
+                    cores = 1;
+
             switch(strategy)
             {
                 case Strategy::DFS:
@@ -3,6 +3,7 @@
 #include "PetriEngine/PetriNetBuilder.h"
 #include "PetriEngine/options.h"
 #include "PetriEngine/PQL/Expressions.h"
+#include "utils/MemoryLimit.h"
 
 namespace PetriEngine {
     namespace Reachability {
@@ -161,6 +162,15 @@ namespace PetriEngine {
             return std::make_pair(retval, false);
         }
 
+        void ResultPrinter::printUnsolved(std::ostream& out, const std::vector<Result>& results, const char* reason) const
+        {
+            for(size_t i = 0; i < results.size(); ++i)
+            {
+                if(results[i] == Unknown)
+                    MemoryLimit::printUnsolved(out, querynames[i], i, reason);
+            }
+        }
+
         std::string ResultPrinter::printTechniques() {
             std::string out;
 
@@ -40,9 +40,26 @@ namespace PetriEngine {
         return true;
     }
 
+    size_t ReducingSuccessorGenerator::next(SuccessorBatch &batch) {
+        size_t n = 0;
+        while (n < batch.capacity()) {
+            _current = _stubSet->next();
+            if (_current == std::numeric_limits<uint32_t>::max()) {
+                reset();
+                break;
+            }
+            assert(checkPreset(_current));
+            _fire(batch._states[n], _current);
+            batch._transitions[n++] = _current;
+        }
+        batch._size = n;
+        return n;
+    }
+
     bool ReducingSuccessorGenerator::prepare(const Structures::State *state) {
         _current = 0;
         _parent = state;
+        _stubSet->setEnabled(_enabled);
         return _stubSet->prepare(state);
     }
 
@@ -8,6 +8,7 @@
 #include <limits>
 
 #include "PetriEngine/Structures/AlignedEncoder.h"
+#include "PetriEngine/Structures/MarkingKernels.h"
 
 #define SAMEBOUND 120
 #define DBOUND (SAMEBOUND*2)
@@ -42,33 +43,13 @@ uint32_t AlignedEncoder::tokenBytes(uint32_t ntokens) const
 
 uint32_t AlignedEncoder::writeBitVector(size_t offset, const uint32_t* data)
 {
-    for(size_t i = 0; i < _places; ++i)
-    {
-        _scratchpad.set(i+(offset*8), data[i] > 0);
-    }
+    PetriEngine::Structures::MarkingKernels::packBits(&_scratchpad.raw()[offset], data, _places);
     return offset + scratchpad_t::bytes(_places);
 }
 
 uint32_t AlignedEncoder::writeTwoBitVector(size_t offset, const uint32_t* data)
 {
-    for(size_t i = 0; i < _places; ++i)
-    {
-        switch(data[i])
-        {
-            case 1:
-                _scratchpad.set((i*2)+(offset*8), true);
-                break;
-            case 3:
-                _scratchpad.set((i*2)+(offset*8), true);                
-            case 2:
-                _scratchpad.set((i*2)+(offset*8)+1, true);                                
-                break;
-            default:                
-                break;
-            
-        }
-    }
-
+    PetriEngine::Structures::MarkingKernels::packTwoBits(&_scratchpad.raw()[offset], data, _places);
     return offset + scratchpad_t::bytes(_places*2);
 }
 
@@ -421,6 +402,60 @@ unsigned char AlignedEncoder::getType(uint32_t sum, uint32_t pwt, bool same, uin
     return 0;
 }
 
+// same bit-order as binarywrapper_t, which would copy small buffers rather than wrap them
+static inline void setBit(unsigned char* data, size_t bit, bool value)
+{
+    unsigned char mask = 0x80 >> (bit % 8);
+    if(value) data[bit / 8] |= mask;
+    else data[bit / 8] &= ~mask;
+}
+
+bool AlignedEncoder::positional(unsigned char type) const
+{
+    return (type > 0 && type <= SAMEBOUND) || (type >= DBOUND+1 && type <= DBOUND+4);
+}
+
+void AlignedEncoder::patch(unsigned char* data, uint32_t place, uint32_t value) const
+{
+    unsigned char type = data[0];
+    assert(positional(type));
+    if(type <= SAMEBOUND)
+    {
+        assert(value == 0 || value == type);
+        setBit(&data[1], place, value > 0);
+        return;
+    }
+    switch(type)
+    {
+        case DBOUND+1:
+        {
+            assert(value < 4);
+            setBit(&data[1], place*2, (value & 1) != 0);
+            setBit(&data[1], (place*2)+1, (value & 2) != 0);
+            break;
+        }
+        case DBOUND+2:
+            assert(value < 256);
+            data[1 + place] = (unsigned char)value;
+            break;
+        case DBOUND+3:
+        {
+            assert(value < 65536);
+            uint16_t* dest = (uint16_t*)(&data[1 + (place*sizeof(uint16_t))]);
+            *dest = value;
+            break;
+        }
+        case DBOUND+4:
+        {
+            uint32_t* dest = (uint32_t*)(&data[1 + (place*sizeof(uint32_t))]);
+            *dest = value;
+            break;
+        }
+        default:
+            assert(false);
+    }
+}
+
 size_t AlignedEncoder::size(const uchar* s) const
 {
     unsigned char type = s[0];
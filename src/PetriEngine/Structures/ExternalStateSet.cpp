@@ -0,0 +1,273 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PetriEngine/Structures/ExternalStateSet.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <queue>
+#include <random>
+
+namespace PetriEngine {
+    namespace Structures {
+
+        namespace {
+            // records are ordered by length, then by content
+            int compare(const unsigned char* a, size_t alen, const unsigned char* b, size_t blen)
+            {
+                if(alen != blen) return alen < blen ? -1 : 1;
+                return memcmp(a, b, alen);
+            }
+
+            void write_record(std::ofstream& out, const unsigned char* data, uint16_t length)
+            {
+                out.write((const char*)&length, sizeof(length));
+                out.write((const char*)data, length);
+            }
+        }
+
+        struct ExternalStateSet::reader_t {
+            std::ifstream _in;
+            std::vector<unsigned char> _data;
+            bool _valid = false;
+
+            reader_t(const std::string& file)
+            : _in(file, std::ios::binary)
+            {
+                next();
+            }
+
+            bool next()
+            {
+                uint16_t length;
+                _valid = false;
+                if(!_in.read((char*)&length, sizeof(length)))
+                    return false;
+                _data.resize(length);
+                if(!_in.read((char*)_data.data(), length))
+                    throw base_error("Corrupt record in external state-set file");
+                _valid = true;
+                return true;
+            }
+
+            int compare(const reader_t& other) const
+            {
+                return Structures::compare(_data.data(), _data.size(), other._data.data(), other._data.size());
+            }
+
+            void write(std::ofstream& out) const
+            {
+                write_record(out, _data.data(), _data.size());
+            }
+        };
+
+        ExternalStateSet::ExternalStateSet(const PetriNet& net, uint32_t kbound, const std::string& directory, size_t buffer)
+        : StateSetInterface(net, kbound), _directory(directory), _bufferSize(std::max<size_t>(buffer, 1 << 16))
+        {
+            std::random_device rd;
+            _prefix = "verifypn-" + std::to_string(rd()) + "-";
+            _buffer.reserve(_bufferSize);
+            _visited = fileName("visited", _files++);
+            std::ofstream out(_visited, std::ios::binary);
+            if(!out)
+                throw base_error("Could not create files for the external state-set in ", directory);
+        }
+
+        ExternalStateSet::~ExternalStateSet()
+        {
+            _reader = nullptr;
+            for(auto& r : _runs)
+                std::remove(r.c_str());
+            std::remove(_visited.c_str());
+            if(!_frontier.empty())
+                std::remove(_frontier.c_str());
+        }
+
+        std::string ExternalStateSet::fileName(const char* kind, size_t n) const
+        {
+            return _directory + "/" + _prefix + kind + "-" + std::to_string(n) + ".bin";
+        }
+
+        std::pair<bool, size_t> ExternalStateSet::add(const State& state)
+        {
+            _discovered++;
+
+            MarkVal sum = 0;
+            bool allsame = true;
+            uint32_t val = 0;
+            uint32_t active = 0;
+            uint32_t last = 0;
+            markingStats(state.marking(), sum, allsame, val, active, last);
+
+            if (_maxTokens < sum)
+                _maxTokens = sum;
+
+            //Check that we're within k-bound
+            if (_kbound != 0 && sum > _kbound)
+                return std::pair<bool, size_t>(false, std::numeric_limits<size_t>::max());
+
+            unsigned char type = _encoder.getType(sum, active, allsame, val);
+            size_t length = _encoder.encode(state.marking(), type);
+            if(length >= std::numeric_limits<uint16_t>::max())
+            {
+                throw base_error("Marking could not be encoded into less than 2^16 bytes, current limit of the external state-set");
+            }
+
+            // every successor is a reachable marking, so the bounds need no duplicate detection
+            MarkingKernels::updateBounds(_maxPlaceBound.data(), state.marking(), _net.numberOfPlaces());
+
+            uint16_t len = length;
+            _offsets.push_back(_buffer.size());
+            _buffer.insert(_buffer.end(), (unsigned char*)&len, (unsigned char*)&len + sizeof(len));
+            _buffer.insert(_buffer.end(), _encoder.scratchpad().const_raw(), _encoder.scratchpad().const_raw() + length);
+            if(_buffer.size() >= _bufferSize)
+                flushRun();
+            return std::pair<bool, size_t>(true, _added++);
+        }
+
+        void ExternalStateSet::flushRun()
+        {
+            if(_offsets.empty()) return;
+            auto record = [this](size_t offset, uint16_t& length) {
+                memcpy(&length, &_buffer[offset], sizeof(length));
+                return &_buffer[offset + sizeof(length)];
+            };
+            std::sort(_offsets.begin(), _offsets.end(), [&](size_t a, size_t b) {
+                uint16_t alen, blen;
+                auto adata = record(a, alen);
+                auto bdata = record(b, blen);
+                return compare(adata, alen, bdata, blen) < 0;
+            });
+
+            _runs.push_back(fileName("run", _files++));
+            std::ofstream out(_runs.back(), std::ios::binary);
+            const unsigned char* prev = nullptr;
+            uint16_t prevlen = 0;
+            for(auto o : _offsets)
+            {
+                uint16_t len;
+                auto data = record(o, len);
+                if(prev != nullptr && compare(prev, prevlen, data, len) == 0)
+                    continue;
+                write_record(out, data, len);
+                prev = data;
+                prevlen = len;
+            }
+            if(!out)
+                throw base_error("Could not write run of the external state-set to ", _runs.back());
+            _offsets.clear();
+            _buffer.clear();
+        }
+
+        bool ExternalStateSet::nextLayer()
+        {
+            flushRun();
+            _reader = nullptr;
+            if(!_frontier.empty())
+                std::remove(_frontier.c_str());
+
+            std::vector<std::unique_ptr<reader_t>> runs;
+            for(auto& r : _runs)
+                runs.emplace_back(std::make_unique<reader_t>(r));
+            auto greater = [&runs](size_t a, size_t b) { return runs[a]->compare(*runs[b]) > 0; };
+            std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+            for(size_t i = 0; i < runs.size(); ++i)
+                if(runs[i]->_valid)
+                    heap.push(i);
+
+            reader_t visited(_visited);
+            auto nvisited = fileName("visited", _files++);
+            _frontier = fileName("frontier", _files++);
+            std::ofstream vout(nvisited, std::ios::binary);
+            std::ofstream fout(_frontier, std::ios::binary);
+
+            std::vector<unsigned char> prev;
+            bool has_prev = false;
+            size_t fresh = 0;
+            while(!heap.empty())
+            {
+                auto idx = heap.top();
+                auto& run = *runs[idx];
+                heap.pop();
+                if(!has_prev || compare(prev.data(), prev.size(), run._data.data(), run._data.size()) != 0)
+                {
+                    while(visited._valid && visited.compare(run) < 0)
+                    {
+                        visited.write(vout);
+                        visited.next();
+                    }
+                    if(!visited._valid || visited.compare(run) != 0)
+                    {
+                        run.write(vout);
+                        run.write(fout);
+                        ++fresh;
+                    }
+                    prev = run._data;
+                    has_prev = true;
+                }
+                if(run.next())
+                    heap.push(idx);
+            }
+            while(visited._valid)
+            {
+                visited.write(vout);
+                visited.next();
+            }
+            if(!vout || !fout)
+                throw base_error("Could not write layer of the external state-set to ", _directory);
+            vout.close();
+            fout.close();
+
+            runs.clear();
+            for(auto& r : _runs)
+                std::remove(r.c_str());
+            _runs.clear();
+            std::remove(_visited.c_str());
+            _visited = nvisited;
+            _visitedCount += fresh;
+            ++_layer;
+
+            _reader = std::make_unique<reader_t>(_frontier);
+            return fresh > 0;
+        }
+
+        bool ExternalStateSet::nextFrontier(State& state)
+        {
+            if(_reader == nullptr || !_reader->_valid)
+                return false;
+            memcpy(_encoder.scratchpad().raw(), _reader->_data.data(), _reader->_data.size());
+            _encoder.decode(state.marking(), _encoder.scratchpad().raw());
+            _reader->next();
+            return true;
+        }
+
+        void ExternalStateSet::decode(State& state, size_t id)
+        {
+            throw base_error("The external state-set does not support decoding by id");
+        }
+
+        std::pair<bool, size_t> ExternalStateSet::lookup(State& state)
+        {
+            throw base_error("The external state-set does not support lookups");
+        }
+
+        std::pair<size_t, size_t> ExternalStateSet::getHistory(size_t markingid)
+        {
+            throw base_error("The external state-set does not support traces");
+        }
+    }
+}
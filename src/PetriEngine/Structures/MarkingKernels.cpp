@@ -0,0 +1,348 @@
+/* VerifyPN - TAPAAL Petri Net Engine
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "PetriEngine/Structures/MarkingKernels.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+// the vectorized kernels are compiled with function-level target attributes,
+// so the rest of the binary still runs on CPUs without these extensions
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define VERIFYPN_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace PetriEngine {
+    namespace Structures {
+        namespace MarkingKernels {
+
+            namespace {
+                constexpr std::array<unsigned char, 256> makeReverse()
+                {
+                    std::array<unsigned char, 256> table{};
+                    for(size_t i = 0; i < 256; ++i)
+                        for(size_t k = 0; k < 8; ++k)
+                            if(i & (1 << k))
+                                table[i] |= 0x80 >> k;
+                    return table;
+                }
+
+                // bit k of a nibble to bit 7-2k of a byte
+                constexpr std::array<unsigned char, 16> makeSpread()
+                {
+                    std::array<unsigned char, 16> table{};
+                    for(size_t i = 0; i < 16; ++i)
+                        for(size_t k = 0; k < 4; ++k)
+                            if(i & (1 << k))
+                                table[i] |= 0x80 >> (2 * k);
+                    return table;
+                }
+
+                constexpr auto reverse = makeReverse();
+                constexpr auto spread = makeSpread();
+
+                // the scalar loops also finish the tails of the vectorized ones
+                void statsScalar(stats_t& s, const uint32_t* marking, size_t from, size_t places)
+                {
+                    for(size_t i = from; i < places; ++i)
+                    {
+                        auto v = marking[i];
+                        if(v == 0) continue;
+                        ++s.active;
+                        s.sum += v;
+                        s.max = std::max(s.max, v);
+                        s.last = i;
+                    }
+                }
+
+                void boundsScalar(uint32_t* bounds, const uint32_t* marking, size_t from, size_t places)
+                {
+                    for(size_t i = from; i < places; ++i)
+                        bounds[i] = std::max(bounds[i], marking[i]);
+                }
+
+                void bitsScalar(unsigned char* dest, const uint32_t* marking, size_t from, size_t places)
+                {
+                    for(size_t i = from; i < places; i += 8)
+                    {
+                        unsigned char byte = 0;
+                        for(size_t k = 0; k < 8 && i + k < places; ++k)
+                            if(marking[i + k] != 0)
+                                byte |= 0x80 >> k;
+                        dest[i / 8] = byte;
+                    }
+                }
+
+                void twoBitsScalar(unsigned char* dest, const uint32_t* marking, size_t from, size_t places)
+                {
+                    for(size_t i = from; i < places; i += 4)
+                    {
+                        unsigned char byte = 0;
+                        for(size_t k = 0; k < 4 && i + k < places; ++k)
+                        {
+                            auto v = marking[i + k];
+                            if(v & 1) byte |= 0x80 >> (2 * k);
+                            if(v & 2) byte |= 0x40 >> (2 * k);
+                        }
+                        dest[i / 4] = byte;
+                    }
+                }
+
+                stats_t statsGeneric(const uint32_t* marking, size_t places)
+                {
+                    stats_t s;
+                    statsScalar(s, marking, 0, places);
+                    return s;
+                }
+
+                void boundsGeneric(uint32_t* bounds, const uint32_t* marking, size_t places)
+                {
+                    boundsScalar(bounds, marking, 0, places);
+                }
+
+                void bitsGeneric(unsigned char* dest, const uint32_t* marking, size_t places)
+                {
+                    bitsScalar(dest, marking, 0, places);
+                }
+
+                void twoBitsGeneric(unsigned char* dest, const uint32_t* marking, size_t places)
+                {
+                    twoBitsScalar(dest, marking, 0, places);
+                }
+
+#ifdef VERIFYPN_X86_KERNELS
+                __attribute__((target("sse4.1")))
+                stats_t statsSSE(const uint32_t* marking, size_t places)
+                {
+                    stats_t s;
+                    const __m128i zero = _mm_setzero_si128();
+                    __m128i vmax = zero;
+                    __m128i vsum = zero;
+                    size_t i = 0;
+                    for(; i + 4 <= places; i += 4)
+                    {
+                        __m128i v = _mm_loadu_si128((const __m128i*)(marking + i));
+                        vmax = _mm_max_epu32(vmax, v);
+                        vsum = _mm_add_epi64(vsum, _mm_add_epi64(_mm_unpacklo_epi32(v, zero),
+                                                                 _mm_unpackhi_epi32(v, zero)));
+                        unsigned nz = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(v, zero))) & 0xF;
+                        if(nz != 0)
+                        {
+                            s.active += __builtin_popcount(nz);
+                            s.last = i + 31 - __builtin_clz(nz);
+                        }
+                    }
+                    alignas(16) uint32_t maxs[4];
+                    alignas(16) uint64_t sums[2];
+                    _mm_store_si128((__m128i*)maxs, vmax);
+                    _mm_store_si128((__m128i*)sums, vsum);
+                    s.max = *std::max_element(maxs, maxs + 4);
+                    s.sum = sums[0] + sums[1];
+                    statsScalar(s, marking, i, places);
+                    return s;
+                }
+
+                __attribute__((target("sse4.1")))
+                void boundsSSE(uint32_t* bounds, const uint32_t* marking, size_t places)
+                {
+                    size_t i = 0;
+                    for(; i + 4 <= places; i += 4)
+                    {
+                        __m128i b = _mm_loadu_si128((const __m128i*)(bounds + i));
+                        __m128i v = _mm_loadu_si128((const __m128i*)(marking + i));
+                        _mm_storeu_si128((__m128i*)(bounds + i), _mm_max_epu32(b, v));
+                    }
+                    boundsScalar(bounds, marking, i, places);
+                }
+
+                __attribute__((target("sse4.1")))
+                void bitsSSE(unsigned char* dest, const uint32_t* marking, size_t places)
+                {
+                    const __m128i zero = _mm_setzero_si128();
+                    size_t i = 0;
+                    for(; i + 8 <= places; i += 8)
+                    {
+                        __m128i lo = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(marking + i)), zero);
+                        __m128i hi = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(marking + i + 4)), zero);
+                        unsigned z = _mm_movemask_ps(_mm_castsi128_ps(lo)) | (_mm_movemask_ps(_mm_castsi128_ps(hi)) << 4);
+                        dest[i / 8] = reverse[~z & 0xFF];
+                    }
+                    bitsScalar(dest, marking, i, places);
+                }
+
+                __attribute__((target("sse4.1")))
+                void twoBitsSSE(unsigned char* dest, const uint32_t* marking, size_t places)
+                {
+                    size_t i = 0;
+                    for(; i + 4 <= places; i += 4)
+                    {
+                        __m128i v = _mm_loadu_si128((const __m128i*)(marking + i));
+                        // move bit 0 and bit 1 of every place into the sign bit
+                        unsigned ones = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(v, 31)));
+                        unsigned twos = _mm_movemask_ps(_mm_castsi128_ps(_mm_slli_epi32(v, 30)));
+                        dest[i / 4] = spread[ones] | (spread[twos] >> 1);
+                    }
+                    twoBitsScalar(dest, marking, i, places);
+                }
+
+                __attribute__((target("avx2")))
+                stats_t statsAVX2(const uint32_t* marking, size_t places)
+                {
+                    stats_t s;
+                    const __m256i zero = _mm256_setzero_si256();
+                    __m256i vmax = zero;
+                    __m256i vsum = zero;
+                    size_t i = 0;
+                    for(; i + 8 <= places; i += 8)
+                    {
+                        __m256i v = _mm256_loadu_si256((const __m256i*)(marking + i));
+                        vmax = _mm256_max_epu32(vmax, v);
+                        vsum = _mm256_add_epi64(vsum, _mm256_add_epi64(_mm256_unpacklo_epi32(v, zero),
+                                                                       _mm256_unpackhi_epi32(v, zero)));
+                        unsigned nz = ~_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(v, zero))) & 0xFF;
+                        if(nz != 0)
+                        {
+                            s.active += __builtin_popcount(nz);
+                            s.last = i + 31 - __builtin_clz(nz);
+                        }
+                    }
+                    alignas(32) uint32_t maxs[8];
+                    alignas(32) uint64_t sums[4];
+                    _mm256_store_si256((__m256i*)maxs, vmax);
+                    _mm256_store_si256((__m256i*)sums, vsum);
+                    s.max = *std::max_element(maxs, maxs + 8);
+                    s.sum = sums[0] + sums[1] + sums[2] + sums[3];
+                    statsScalar(s, marking, i, places);
+                    return s;
+                }
+
+                __attribute__((target("avx2")))
+                void boundsAVX2(uint32_t* bounds, const uint32_t* marking, size_t places)
+                {
+                    size_t i = 0;
+                    for(; i + 8 <= places; i += 8)
+                    {
+                        __m256i b = _mm256_loadu_si256((const __m256i*)(bounds + i));
+                        __m256i v = _mm256_loadu_si256((const __m256i*)(marking + i));
+                        _mm256_storeu_si256((__m256i*)(bounds + i), _mm256_max_epu32(b, v));
+                    }
+                    boundsScalar(bounds, marking, i, places);
+                }
+
+                __attribute__((target("avx2")))
+                void bitsAVX2(unsigned char* dest, const uint32_t* marking, size_t places)
+                {
+                    const __m256i zero = _mm256_setzero_si256();
+                    size_t i = 0;
+                    for(; i + 8 <= places; i += 8)
+                    {
+                        __m256i z = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i*)(marking + i)), zero);
+                        dest[i / 8] = reverse[~_mm256_movemask_ps(_mm256_castsi256_ps(z)) & 0xFF];
+                    }
+                    bitsScalar(dest, marking, i, places);
+                }
+
+                __attribute__((target("avx2")))
+                void twoBitsAVX2(unsigned char* dest, const uint32_t* marking, size_t places)
+                {
+                    size_t i = 0;
+                    for(; i + 8 <= places; i += 8)
+                    {
+                        __m256i v = _mm256_loadu_si256((const __m256i*)(marking + i));
+                        unsigned ones = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(v, 31)));
+                        unsigned twos = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(v, 30)));
+                        dest[i / 4] = spread[ones & 0xF] | (spread[twos & 0xF] >> 1);
+                        dest[i / 4 + 1] = spread[ones >> 4] | (spread[twos >> 4] >> 1);
+                    }
+                    twoBitsScalar(dest, marking, i, places);
+                }
+#endif
+
+                struct kernels_t {
+                    stats_t (*stats)(const uint32_t*, size_t);
+                    void (*bounds)(uint32_t*, const uint32_t*, size_t);
+                    void (*bits)(unsigned char*, const uint32_t*, size_t);
+                    void (*twoBits)(unsigned char*, const uint32_t*, size_t);
+                    const char* name;
+                };
+
+                // the implementations compiled in and supported by the CPU, widest first
+                std::vector<kernels_t> supported()
+                {
+                    std::vector<kernels_t> all;
+#ifdef VERIFYPN_X86_KERNELS
+                    __builtin_cpu_init();
+                    if(__builtin_cpu_supports("avx2"))
+                        all.push_back({statsAVX2, boundsAVX2, bitsAVX2, twoBitsAVX2, "avx2"});
+                    if(__builtin_cpu_supports("sse4.1"))
+                        all.push_back({statsSSE, boundsSSE, bitsSSE, twoBitsSSE, "sse4.1"});
+#endif
+                    all.push_back({statsGeneric, boundsGeneric, bitsGeneric, twoBitsGeneric, "generic"});
+                    return all;
+                }
+
+                kernels_t& kernels()
+                {
+                    static kernels_t selected = supported().front();
+                    return selected;
+                }
+            }
+
+            stats_t stats(const uint32_t* marking, size_t places)
+            {
+                auto s = kernels().stats(marking, places);
+                s.allsame = s.sum == (uint64_t)s.active * s.max;
+                return s;
+            }
+
+            void updateBounds(uint32_t* bounds, const uint32_t* marking, size_t places)
+            {
+                kernels().bounds(bounds, marking, places);
+            }
+
+            void packBits(unsigned char* dest, const uint32_t* marking, size_t places)
+            {
+                kernels().bits(dest, marking, places);
+            }
+
+            void packTwoBits(unsigned char* dest, const uint32_t* marking, size_t places)
+            {
+                kernels().twoBits(dest, marking, places);
+            }
+
+            const char* name()
+            {
+                return kernels().name;
+            }
+
+            bool use(const char* name)
+            {
+                for(auto& k : supported())
+                {
+                    if(std::strcmp(k.name, name) == 0)
+                    {
+                        kernels() = k;
+                        return true;
+                    }
+                }
+                return false;
+            }
+        }
+    }
+}
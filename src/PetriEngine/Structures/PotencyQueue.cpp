@@ -1,4 +1,5 @@
 #include "PetriEngine/Structures/PotencyQueue.h"
+#include "PetriEngine/PQL/Bytecode.h"
 #include "PetriEngine/PQL/Contexts.h"
 
 namespace PetriEngine {
@@ -26,7 +27,7 @@ namespace PetriEngine {
             if (_potencies.empty())
                 this->_initializePotencies(context->net()->numberOfTransitions(), 100);
 
-            uint32_t dist = query->distance(*context);
+            uint32_t dist = PQL::distance(query, *context);
             _queues[_best].emplace(dist, id);
             _size++;
         }
@@ -77,7 +78,7 @@ namespace PetriEngine {
 
         void
         RandomPotencyQueue::push(size_t id, PQL::DistanceContext *context, const PQL::Condition *query, uint32_t t) {
-            uint32_t dist = query->distance(*context);
+            uint32_t dist = PQL::distance(query, *context);
 
             if (dist < _currentParentDist) {
                 _potencies[t].value += _currentParentDist - dist;
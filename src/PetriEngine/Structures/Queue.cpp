@@ -16,7 +16,9 @@
  */
 
 #include "PetriEngine/Structures/Queue.h"
+#include "PetriEngine/PQL/Bytecode.h"
 #include "PetriEngine/PQL/Contexts.h"
+#include "utils/errors.h"
 
 #include <algorithm>
 #include <random>
@@ -28,6 +30,43 @@ namespace PetriEngine {
         Queue::~Queue() {
         }
 
+        void Queue::write(std::ostream&) const {
+            throw base_error("Checkpointing is not supported by this search strategy");
+        }
+
+        void Queue::read(std::istream&) {
+            throw base_error("Checkpointing is not supported by this search strategy");
+        }
+
+        namespace {
+            template<typename T>
+            void put(std::ostream& out, const T& v) {
+                out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+            }
+
+            template<typename T>
+            T get(std::istream& in) {
+                T v;
+                in.read(reinterpret_cast<char*>(&v), sizeof(T));
+                if(!in)
+                    throw base_error("Checkpoint is truncated");
+                return v;
+            }
+
+            // ids are written as 64 bit, independent of how they are stored
+            void put_stack(std::ostream& out, const SegmentedStack<stored_id_t>& stack) {
+                put<uint64_t>(out, stack.size());
+                for(size_t i = 0; i < stack.size(); ++i)
+                    put<uint64_t>(out, stack[i]);
+            }
+
+            void get_stack(std::istream& in, SegmentedStack<stored_id_t>& stack) {
+                auto n = get<uint64_t>(in);
+                for(size_t i = 0; i < n; ++i)
+                    stack.push(get<uint64_t>(in));
+            }
+        }
+
 
         BFSQueue::BFSQueue(size_t) : Queue() {}
         BFSQueue::~BFSQueue(){}
@@ -56,13 +95,26 @@ namespace PetriEngine {
             return _queue.empty();
         }
 
+        void BFSQueue::write(std::ostream& out) const {
+            auto queue = _queue;
+            put<uint64_t>(out, queue.size());
+            for(; !queue.empty(); queue.pop())
+                put<uint64_t>(out, queue.front());
+        }
+
+        void BFSQueue::read(std::istream& in) {
+            auto n = get<uint64_t>(in);
+            for(size_t i = 0; i < n; ++i)
+                _queue.push(get<uint64_t>(in));
+        }
+
         DFSQueue::DFSQueue(size_t) : Queue() {}
         DFSQueue::~DFSQueue(){}
 
         size_t DFSQueue::pop()
         {
             if(_stack.empty()) return EMPTY;
-            uint32_t n = _stack.top();
+            size_t n = _stack.top();
             _stack.pop();
             return n;
         }
@@ -77,6 +129,14 @@ namespace PetriEngine {
             return _stack.empty();
         }
 
+        void DFSQueue::write(std::ostream& out) const {
+            put_stack(out, _stack);
+        }
+
+        void DFSQueue::read(std::istream& in) {
+            get_stack(in, _stack);
+        }
+
         /*bool DFSQueue::top() const {
             if(_stack.empty()) return EMPTY;
             uint32_t n = _stack.top();
@@ -97,14 +157,14 @@ namespace PetriEngine {
             {
                 if(_stack.empty())
                     return EMPTY;
-                uint32_t n = _stack.top();
+                size_t n = _stack.top();
                 _stack.pop();
                 return n;
             }
             else
             {
                 std::shuffle(_cache.begin(), _cache.end(), _rng);
-                uint32_t n = _cache.back();
+                size_t n = _cache.back();
                 for(size_t i = 0; i < (_cache.size() - 1); ++i)
                 {
                     _stack.push(_cache[i]);
@@ -140,27 +200,102 @@ namespace PetriEngine {
             return _cache.empty() && _stack.empty();
         }
 
+        void RDFSQueue::write(std::ostream& out) const {
+            put_stack(out, _stack);
+            put<uint64_t>(out, _cache.size());
+            for(auto e : _cache)
+                put<uint64_t>(out, e);
+        }
+
+        void RDFSQueue::read(std::istream& in) {
+            get_stack(in, _stack);
+            auto n = get<uint64_t>(in);
+            for(size_t i = 0; i < n; ++i)
+                _cache.push_back(get<uint64_t>(in));
+        }
+
         HeuristicQueue::HeuristicQueue(size_t) : Queue() {}
         HeuristicQueue::~HeuristicQueue(){}
 
         size_t HeuristicQueue::pop()
         {
-            if(_queue.empty()) return EMPTY;
-            uint32_t n = _queue.top().item;
-            _queue.pop();
+            if(_size > 0)
+            {
+                // first non-empty bucket at or above _min
+                size_t word = _min / 64;
+                uint64_t bits = _nonempty[word] & (~uint64_t{0} << (_min % 64));
+                while(bits == 0)
+                    bits = _nonempty[++word];
+                _min = word * 64 + __builtin_ctzll(bits);
+
+                auto& bucket = _buckets[_min];
+                size_t n = bucket.back();
+                bucket.pop_back();
+                if(bucket.empty())
+                    _nonempty[_min / 64] &= ~(uint64_t{1} << (_min % 64));
+                --_size;
+                return n;
+            }
+            if(_overflow.empty()) return EMPTY;
+            size_t n = _overflow.top().item;
+            _overflow.pop();
             return n;
         }
 
         void HeuristicQueue::push(size_t id, PQL::DistanceContext* context,
             const PQL::Condition* query)
         {
-            // invert result, highest numbers are on top!
-            uint32_t dist = query->distance(*context);
-            _queue.emplace(dist, (uint32_t)id);
+            insert(PQL::distance(query, *context), id);
+        }
+
+        void HeuristicQueue::insert(uint32_t weight, size_t item)
+        {
+            if(weight >= BUCKETS)
+            {
+                _overflow.emplace(weight, item);
+                return;
+            }
+            if(weight >= _buckets.size())
+            {
+                _buckets.resize(weight + 1);
+                _nonempty.resize(weight / 64 + 1, 0);
+            }
+            _buckets[weight].push_back(item);
+            _nonempty[weight / 64] |= uint64_t{1} << (weight % 64);
+            if(_size == 0 || weight < _min)
+                _min = weight;
+            ++_size;
         }
 
         bool HeuristicQueue::empty() const {
-            return _queue.empty();
+            return _size == 0 && _overflow.empty();
+        }
+
+        void HeuristicQueue::write(std::ostream& out) const {
+            put<uint64_t>(out, _size + _overflow.size());
+            // bottom up, so reading restores the order within a bucket
+            for(uint32_t w = 0; w < _buckets.size(); ++w)
+            {
+                for(size_t item : _buckets[w])
+                {
+                    put(out, w);
+                    put<uint64_t>(out, item);
+                }
+            }
+            for(auto queue = _overflow; !queue.empty(); queue.pop())
+            {
+                put(out, queue.top().weight);
+                put<uint64_t>(out, queue.top().item);
+            }
+        }
+
+        void HeuristicQueue::read(std::istream& in) {
+            auto n = get<uint64_t>(in);
+            for(size_t i = 0; i < n; ++i)
+            {
+                auto weight = get<uint32_t>(in);
+                insert(weight, get<uint64_t>(in));
+            }
         }
 
     }
@@ -32,12 +32,19 @@ namespace PetriEngine {
             return true;
         }
         assert(!_queries.empty());
+        std::unique_lock<std::mutex> guard;
+        if (_query_lock != nullptr)
+            guard = std::unique_lock<std::mutex>(*_query_lock);
+        PQL::EvaluationContext context((*_parent).marking(), &_net);
+        context.setAtoms(_atoms);
         for (auto &q : _queries) {
-            PetriEngine::PQL::evaluateAndSet(q, PQL::EvaluationContext((*_parent).marking(), &_net));
+            PetriEngine::PQL::evaluateAndSet(q, context);
 
             assert(_interesting->get_negated() == false);
             PQL::Visitor::visit(_interesting, q);
         }
+        if (guard.owns_lock())
+            guard.unlock();
 
         closure();
         return true;
@@ -35,23 +35,24 @@ namespace PetriEngine {
     }
 
     bool StubbornSet::checkPreset(uint32_t t) {
-        const TransPtr &ptr = transitions()[t];
-        uint32_t finv = ptr.inputs;
-        uint32_t linv = ptr.outputs;
-
-        for (; finv < linv; ++finv) {
-            const Invariant &inv = _net._invariants[finv];
-            if (_parent->marking()[inv.place] < inv.tokens) {
-                if (!inv.inhibitor) {
-                    return false;
+        const FiringRecord &record = _net._firing[t];
+        const MarkVal *marking = _parent->marking();
+        return _net.visitFiringArcs([&](auto arcs) {
+            if (record.unit) {
+                for (auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc) {
+                    if (marking[arc->place] == 0) {
+                        return false;
+                    }
                 }
-            } else {
-                if (inv.inhibitor) {
+                return true;
+            }
+            for (auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc) {
+                if (arc->inhibitor == (marking[arc->place] >= arc->tokens)) {
                     return false;
                 }
             }
-        }
-        return true;
+            return true;
+        });
     }
 
     bool StubbornSet::seenPre(uint32_t place) const {
@@ -64,30 +65,22 @@ namespace PetriEngine {
 
     void StubbornSet::presetOf(uint32_t place, bool make_closure) {
         if ((_places_seen[place] & PresetSeen) != 0) return;
-        _places_seen[place] = _places_seen[place] | PresetSeen;
-        for (uint32_t t = _places[place].pre; t < _places[place].post; t++) {
-            const auto &tr = _arcs[t];
-            addToStub(tr.index);
-        }
+        markSeen(place, PresetSeen);
+        addToStub(_producers[place]);
         if (make_closure) closure();
     }
 
     void StubbornSet::postsetOf(uint32_t place, bool make_closure) {
         if ((_places_seen[place] & PostsetSeen) != 0) return;
-        _places_seen[place] = _places_seen[place] | PostsetSeen;
-        for (uint32_t t = _places[place].post; t < _places[place + 1].pre; t++) {
-            const auto& tr = _arcs[t];
-            if (tr.direction < 0)
-                addToStub(tr.index);
-        }
+        markSeen(place, PostsetSeen);
+        addToStub(_decreasing[place]);
         if (make_closure) closure();
     }
 
     void StubbornSet::inhibitorPostsetOf(uint32_t place) {
         if ((_places_seen[place] & InhibPostsetSeen) != 0) return;
-        _places_seen[place] = _places_seen[place] | InhibPostsetSeen;
-        for (uint32_t &newstub : _inhibpost[place])
-            addToStub(newstub);
+        markSeen(place, InhibPostsetSeen);
+        addToStub(_inhibited[place]);
     }
 
     void StubbornSet::postPresetOf(uint32_t t, bool make_closure) {
@@ -120,6 +113,7 @@ namespace PetriEngine {
 
     void StubbornSet::constructPrePost() {
         std::vector<std::pair<std::vector<trans_t>, std::vector<trans_t>>> tmp_places(_net._nplaces);
+        std::vector<std::vector<uint32_t>> inhibitors(_net._nplaces);
 
         for (uint32_t t = 0; t < _net._ntransitions; t++) {
             const TransPtr &ptr = _net._transitions[t];
@@ -127,7 +121,7 @@ namespace PetriEngine {
             uint32_t linv = ptr.outputs;
             for (; finv < linv; finv++) { // Post set of places
                 if (_net._invariants[finv].inhibitor) {
-                    _inhibpost[_net._invariants[finv].place].push_back(t);
+                    inhibitors[_net._invariants[finv].place].push_back(t);
                     _netContainsInhibitorArcs = true;
                 } else {
                     tmp_places[_net._invariants[finv].place].second.emplace_back(t, _net._invariants[finv].direction);
@@ -176,6 +170,29 @@ namespace PetriEngine {
         assert(offset == ntrans);
         _places[p].pre = offset;
         _places[p].post = offset;
+
+        // the same sets as masks, transitions are sorted so each word is added once
+        auto add = [](place_masks_t &masks, uint32_t t) {
+            uint32_t word = t / light_bitset::BITS;
+            if (masks.masks.size() == masks.offsets.back() || masks.masks.back().word != word)
+                masks.masks.push_back({word, 0});
+            masks.masks.back().bits |= light_bitset::word_t{1} << (t % light_bitset::BITS);
+        };
+        for (auto *masks : {&_producers, &_consumers, &_decreasing, &_inhibited})
+            masks->offsets.assign(1, 0);
+        for (p = 0; p < _net._nplaces; ++p) {
+            for (uint32_t a = _places[p].pre; a < _places[p].post; ++a)
+                add(_producers, _arcs[a].index);
+            for (uint32_t a = _places[p].post; a < _places[p + 1].pre; ++a) {
+                add(_consumers, _arcs[a].index);
+                if (_arcs[a].direction < 0)
+                    add(_decreasing, _arcs[a].index);
+            }
+            for (auto t : inhibitors[p])
+                add(_inhibited, t);
+            for (auto *masks : {&_producers, &_consumers, &_decreasing, &_inhibited})
+                masks->offsets.push_back(masks->masks.size());
+        }
     }
 
     void StubbornSet::constructDependency() {
@@ -202,18 +219,30 @@ namespace PetriEngine {
         }
     }
 
+    void StubbornSet::addToStub(std::pair<const mask_t *, const mask_t *> masks) {
+        for (auto m = masks.first; m != masks.second; ++m) {
+            const uint32_t base = m->word * light_bitset::BITS;
+            if (_orMasks) {
+                auto fresh = _stubborn.or_word(m->word, m->bits);
+                for (; fresh != 0; fresh &= fresh - 1)
+                    _unprocessed.push_back(base + __builtin_ctzll(fresh));
+            } else {
+                for (auto bits = m->bits; bits != 0; bits &= bits - 1)
+                    addToStub(base + __builtin_ctzll(bits));
+            }
+        }
+    }
+
     uint32_t StubbornSet::leastDependentEnabled() {
         uint32_t tLeast = -1;
         bool foundLeast = false;
-        for (uint32_t t = 0; t < _net.numberOfTransitions(); t++) {
-            if (_enabled[t]) {
-                if (!foundLeast) {
+        for (uint32_t t = _enabled.next(0); t < _net.numberOfTransitions(); t = _enabled.next(t + 1)) {
+            if (!foundLeast) {
+                tLeast = t;
+                foundLeast = true;
+            } else {
+                if (_dependency[t] < _dependency[tLeast]) {
                     tLeast = t;
-                    foundLeast = true;
-                } else {
-                    if (_dependency[t] < _dependency[tLeast]) {
-                        tLeast = t;
-                    }
                 }
             }
         }
@@ -221,9 +250,9 @@ namespace PetriEngine {
     }
 
     void StubbornSet::reset() {
-        std::fill(_enabled.get(), _enabled.get() + _net.numberOfTransitions(), false);
-        std::fill(_stubborn.get(), _stubborn.get() + _net.numberOfTransitions(), false);
-        std::fill(_places_seen.get(), _places_seen.get() + _net.numberOfPlaces(), 0);
+        _enabled.clear();
+        _stubborn.clear();
+        resetSeen();
         _ordering.clear();
         _nenabled = 0;
         //_tid = 0;
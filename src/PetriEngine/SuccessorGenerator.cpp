@@ -18,6 +18,18 @@
 #include <cassert>
 namespace PetriEngine {
 
+    SuccessorBatch::SuccessorBatch(uint32_t nplaces, size_t capacity)
+    : _markings(nplaces * capacity), _transitions(capacity) {
+        _states.reserve(capacity);
+        for (size_t i = 0; i < capacity; ++i)
+            _states.emplace_back(_markings.data() + i * nplaces);
+    }
+
+    SuccessorBatch::~SuccessorBatch() {
+        for (auto& s : _states)
+            s.release();
+    }
+
     SuccessorGenerator::SuccessorGenerator(const PetriNet& net)
     : _net(net), _parent(nullptr) {
         reset();
@@ -39,65 +51,84 @@ namespace PetriEngine {
         return true;
     }
 
+    size_t SuccessorGenerator::next(SuccessorBatch& batch) {
+        size_t n = 0;
+        while (n < batch.capacity() && _next(batch._states[n], [](size_t){ return true; }))
+            batch._transitions[n++] = fired();
+        batch._size = n;
+        return n;
+    }
+
     void SuccessorGenerator::reset() {
         _suc_pcounter = 0;
         _suc_tcounter = std::numeric_limits<uint32_t>::max();
     }
 
     void SuccessorGenerator::consumePreset(Structures::State& write, uint32_t t) {
-
-        const TransPtr& ptr = _net._transitions[t];
-        uint32_t finv = ptr.inputs;
-        uint32_t linv = ptr.outputs;
-        for (; finv < linv; ++finv) {
-            if(!_net._invariants[finv].inhibitor) {
-                assert(write.marking()[_net._invariants[finv].place] >= _net._invariants[finv].tokens);
-                write.marking()[_net._invariants[finv].place] -= _net._invariants[finv].tokens;
+        const FiringRecord& record = _net._firing[t];
+        _net.visitFiringArcs([&](auto arcs) {
+            for (auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc) {
+                if (arc->delta < 0) {
+                    assert(write.marking()[arc->place] >= (uint32_t)-arc->delta);
+                    write.marking()[arc->place] += arc->delta;
+                }
             }
-        }
+        });
     }
 
     bool SuccessorGenerator::checkPreset(uint32_t t) {
-        const TransPtr& ptr = _net._transitions[t];
-        uint32_t finv = ptr.inputs;
-        uint32_t linv = ptr.outputs;
-
-        for (; finv < linv; ++finv) {
-            const Invariant& inv = _net._invariants[finv];
-            if ((*_parent).marking()[inv.place] < inv.tokens) {
-                if (!inv.inhibitor) {
-                    return false;
+        const FiringRecord& record = _net._firing[t];
+        const MarkVal* marking = (*_parent).marking();
+        return _net.visitFiringArcs([&](auto arcs) {
+            if (record.unit) {
+                for (auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc) {
+                    if (marking[arc->place] == 0) {
+                        return false;
+                    }
                 }
-            } else {
-                if (inv.inhibitor) {
+                return true;
+            }
+            for (auto arc = arcs + record.begin; arc != arcs + record.guards; ++arc) {
+                if (arc->inhibitor == (marking[arc->place] >= arc->tokens)) {
                     return false;
                 }
             }
-        }
-        return true;
+            return true;
+        });
     }
 
     void SuccessorGenerator::producePostset(Structures::State& write, uint32_t t) {
-        const TransPtr& ptr = _net._transitions[t];
-        uint32_t finv = ptr.outputs;
-        uint32_t linv = _net._transitions[t + 1].inputs;
-
-        for (; finv < linv; ++finv) {
-            size_t n = write.marking()[_net._invariants[finv].place];
-            n += _net._invariants[finv].tokens;
-            if (n >= std::numeric_limits<uint32_t>::max()) {
-                throw base_error("Exceeded 2**32 limit of tokens in a single place (", n, ")");
+        const FiringRecord& record = _net._firing[t];
+        _net.visitFiringArcs([&](auto arcs) {
+            for (auto arc = arcs + record.begin; arc != arcs + record.end; ++arc) {
+                if (arc->delta > 0) {
+                    size_t n = write.marking()[arc->place];
+                    n += arc->delta;
+                    if (n >= std::numeric_limits<uint32_t>::max()) {
+                        throw base_error("Exceeded 2**32 limit of tokens in a single place (", n, ")");
+                    }
+                    write.marking()[arc->place] = n;
+                }
             }
-            write.marking()[_net._invariants[finv].place] = n;
-        }
+        });
     }
 
     void SuccessorGenerator::_fire(Structures::State &write, uint32_t tid) {
         assert(checkPreset(tid));
         _suc_tcounter = tid + 1; // make sure "fired()" call reflects this now
         memcpy(write.marking(), (*_parent).marking(), _net._nplaces * sizeof (MarkVal));
-        consumePreset(write, tid);
-        producePostset(write, tid);
+        // single pass over the merged arcs, self-loops have no delta
+        const FiringRecord& record = _net._firing[tid];
+        _net.visitFiringArcs([&](auto arcs) {
+            for (auto arc = arcs + record.begin; arc != arcs + record.end; ++arc) {
+                if (arc->delta == 0) continue;
+                size_t n = (size_t)write.marking()[arc->place] + arc->delta;
+                if (arc->delta > 0 && n >= std::numeric_limits<uint32_t>::max()) {
+                    throw base_error("Exceeded 2**32 limit of tokens in a single place (", n, ")");
+                }
+                write.marking()[arc->place] = n;
+            }
+        });
     }
 
     SuccessorGenerator::SuccessorGenerator(const PetriNet &net, const std::shared_ptr<StubbornSet>&)
@@ -13,6 +13,7 @@ namespace PetriEngine {
 
         GameStubbornSet::GameStubbornSet(const PetriNet& net, PQL::Condition* predicate, bool is_safety)
         : StubbornSet(net, predicate), _is_safety(is_safety), _in_query(net.numberOfPlaces()) {
+            _orMasks = false;
             for (size_t t = 0; t < _net.numberOfTransitions(); ++t) {
                 if (_net.controllable(t))
                     _reach_actions.emplace_back(t);
@@ -147,7 +148,7 @@ namespace PetriEngine {
                     auto [fout, lout] = _net.postset(t);
                     for (; fout < lout; ++fout) {
                         if (fout->direction > 0 && (_places_seen[fout->place] & WAITING) == 0) {
-                            _places_seen[fout->place] |= WAITING;
+                            markSeen(fout->place, WAITING);
                             waiting.push_back(fout->place);
                         }
                     }
@@ -258,7 +259,7 @@ namespace PetriEngine {
                         if (finv->direction < 0 && _inhibiting_place[finv->place]) {
                             if ((_places_seen[finv->place] & DECR) == 0)
                                 waiting.push(finv->place);
-                            _places_seen[finv->place] |= DECR;
+                            markSeen(finv->place, DECR);
                         }
                     }
                 }
@@ -270,7 +271,7 @@ namespace PetriEngine {
                         if (finv->direction > 0) {
                             if ((_places_seen[finv->place] & INCR) == 0)
                                 waiting.push(finv->place);
-                            _places_seen[finv->place] |= INCR;
+                            markSeen(finv->place, INCR);
                         }
                     }
                 }
@@ -49,6 +49,34 @@ void options_t::print(std::ostream& optionsOut) {
         optionsOut << ",Token_Bound=" << kbound;
     }
 
+    if (memoryLimit > 0) {
+        optionsOut << ",Memory_Limit=" << memoryLimit;
+    }
+
+    if (!externalDirectory.empty()) {
+        optionsOut << ",External_BFS=ENABLED,External_Buffer=" << externalBuffer;
+    }
+
+    if (!checkpointFile.empty()) {
+        optionsOut << ",Checkpoint=ENABLED,Checkpoint_Interval=" << checkpointInterval;
+    }
+
+    if (!resumeFile.empty()) {
+        optionsOut << ",Resume=ENABLED";
+    }
+
+    if (enabledCache > 0) {
+        optionsOut << ",Enabled_Cache=" << enabledCache;
+    }
+
+    if (swarm > 0) {
+        optionsOut << ",Swarm=" << swarm;
+    }
+
+    if (bitstate > 0) {
+        optionsOut << ",Bitstate=" << bitstate << ",Bitstate_Hashes=" << bitstateHashes;
+    }
+
     if (statespaceexploration) {
         optionsOut << ",State_Space_Exploration=ENABLED";
     } else {
@@ -135,6 +163,26 @@ void printHelp() {
         "                                       - RPFS         Random potency first search\n"
         "                                       - OverApprox   Linear Over Approx\n"
         "  --seed-offset <number>               Extra noise to add to the seed of the random number generation\n"
+        "  --memory-limit <megabytes>           Stop searching when the process uses more memory, open queries\n"
+        "                                       are reported as CANNOT_COMPUTE and the next query is tried\n"
+        "                                       (0 for unlimited, default)\n"
+        "  --external-bfs <directory>           Use a disk-backed breadth first search for reachability, storing\n"
+        "                                       the explored markings in files in <directory>\n"
+        "  --external-buffer <megabytes>        Memory used for sorting successors in the disk-backed search\n"
+        "                                       (default 256)\n"
+        "  --checkpoint <file>                  Periodically save the state of the reachability search to <file>\n"
+        "  --checkpoint-interval <seconds>      Minimum time between two checkpoints (default 600)\n"
+        "  --resume <file>                      Continue the reachability search saved in <file>, requires the\n"
+        "                                       same model, queries and options as the interrupted run\n"
+        "  --enabled-cache <megabytes>          Memory for the enabled transitions of waiting markings, which are\n"
+        "                                       then updated incrementally for their successors (default 64,\n"
+        "                                       0 to compute them for every marking)\n"
+        "  --bitstate <bits>                    Use bitstate hashing with 2^<bits> bits for reachability, only\n"
+        "                                       satisfying markings are conclusive, the other queries are\n"
+        "                                       reported as CANNOT_COMPUTE (disabled by default)\n"
+        "  --bitstate-hashes <number>           Number of hash functions used by bitstate hashing (default 3)\n"
+        "  --bitstate-frontier <number>         Maximum number of markings waiting for expansion during\n"
+        "                                       bitstate hashing, 0 for unbounded (default 4194304)\n"
         "  -e, --state-space-exploration        State-space exploration only (query-file is irrelevant)\n"
         "  -x, --xml-queries <query index>      Parse XML query file and verify queries of a given comma-seperated list\n"
         "  -r, --reduction <type>               Change structural net reduction:\n"
@@ -191,9 +239,10 @@ void printHelp() {
         "  --disable-cfp                        Disable the computation of possible colors in the Petri Net (CPN only)\n"
         "  --disable-partitioning               Disable the partitioning of colors in the Petri Net (CPN only)\n"
         "  --disable-symmetry-vars              Disable search for symmetric variables (CPN only)\n"
-#ifdef VERIFYPN_MC_Simplification
-        "  -z, --cores <number of cores>        Number of cores to use (currently only query simplification)\n"
-#endif
+        "  -z, --cores <number of cores>        Number of cores to use (query simplification, reachability search\n"
+        "                                       and the czero CTL algorithm)\n"
+        "  --swarm <number of workers>          Run independent reachability searches with different seeds, strategies\n"
+        "                                       and stubborn sets, the first answer to a query is reported\n"
         "  -tar, --trace-abstraction            Enables Trace Abstraction Refinement for reachability properties\n"
         "  --max-intervals <interval count>     The max amount of intervals kept when computing the color fixpoint\n"
         "                  <interval count>     Default is 250 and then after <interval-timeout> second(s) to 5\n"
@@ -386,6 +435,70 @@ bool options_t::parse(int argc, const char** argv) {
         if (sscanf(argv[++i], "%u", &seed_offset) != 1) {
             throw base_error("Argument Error: Invalid seed offset argument ", std::quoted(argv[i]));
         }
+        } else if (std::strcmp(argv[i], "--memory-limit") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%zu", &memoryLimit) != 1) {
+                throw base_error("Argument Error: Invalid memory limit ", std::quoted(argv[i]));
+            }
+        } else if (std::strcmp(argv[i], "--external-bfs") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing directory after ", std::quoted(argv[i]));
+            }
+            externalDirectory = argv[++i];
+        } else if (std::strcmp(argv[i], "--external-buffer") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%zu", &externalBuffer) != 1 || externalBuffer == 0) {
+                throw base_error("Argument Error: Invalid external buffer size ", std::quoted(argv[i]));
+            }
+        } else if (std::strcmp(argv[i], "--checkpoint") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing file after ", std::quoted(argv[i]));
+            }
+            checkpointFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--checkpoint-interval") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%zu", &checkpointInterval) != 1) {
+                throw base_error("Argument Error: Invalid checkpoint interval ", std::quoted(argv[i]));
+            }
+        } else if (std::strcmp(argv[i], "--resume") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing file after ", std::quoted(argv[i]));
+            }
+            resumeFile = argv[++i];
+        } else if (std::strcmp(argv[i], "--enabled-cache") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%zu", &enabledCache) != 1) {
+                throw base_error("Argument Error: Invalid enabled cache size ", std::quoted(argv[i]));
+            }
+        } else if (std::strcmp(argv[i], "--bitstate") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%u", &bitstate) != 1 || bitstate < 6 || bitstate > 40) {
+                throw base_error("Argument Error: Invalid bitstate size, must be between 6 and 40 ", std::quoted(argv[i]));
+            }
+        } else if (std::strcmp(argv[i], "--bitstate-hashes") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%u", &bitstateHashes) != 1 || bitstateHashes == 0) {
+                throw base_error("Argument Error: Invalid number of bitstate hash functions ", std::quoted(argv[i]));
+            }
+        } else if (std::strcmp(argv[i], "--bitstate-frontier") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%zu", &bitstateFrontier) != 1) {
+                throw base_error("Argument Error: Invalid bitstate frontier ", std::quoted(argv[i]));
+            }
         } else if (std::strcmp(argv[i], "-p") == 0 || std::strcmp(argv[i], "--disable-partial-order") == 0) {
             stubbornreduction = false;
         } else if (std::strcmp(argv[i], "-a") == 0 || std::strcmp(argv[i], "--siphon-trap") == 0) {
@@ -468,16 +581,25 @@ bool options_t::parse(int argc, const char** argv) {
             replay_trace = true;
             replay_file = std::string(argv[++i]);
         }
-#ifdef VERIFYPN_MC_Simplification
-        else if (std::strcmp(argv[i], "-z") == 0) {
+        else if (std::strcmp(argv[i], "-z") == 0 || std::strcmp(argv[i], "--cores") == 0) {
             if (i == argc - 1) {
                 throw base_error("Missing number after ", std::quoted(argv[i]));
             }
             if (sscanf(argv[++i], "%u", &cores) != 1) {
                 throw base_error("Argument Error: Invalid cores count ", std::quoted(argv[i]));
             }
+            if (cores == 0) {
+                throw base_error("Argument Error: Number of cores must be positive ", std::quoted(argv[i]));
+            }
+        }
+        else if (std::strcmp(argv[i], "--swarm") == 0) {
+            if (i == argc - 1) {
+                throw base_error("Missing number after ", std::quoted(argv[i]));
+            }
+            if (sscanf(argv[++i], "%u", &swarm) != 1 || swarm == 0) {
+                throw base_error("Argument Error: Invalid number of swarm workers ", std::quoted(argv[i]));
+            }
         }
-#endif
         else if (std::strcmp(argv[i], "--keep-solved") == 0)
         {
             keep_solved = true;
@@ -633,6 +755,24 @@ bool options_t::parse(int argc, const char** argv) {
         throw base_error("Argument Error: No query-file provided");
     }
 
+    if (swarm > 0) {
+        if (!externalDirectory.empty()) {
+            throw base_error("Argument Error: --swarm is not compatible with --external-bfs.");
+        }
+        if (!checkpointFile.empty() || !resumeFile.empty()) {
+            throw base_error("Argument Error: --swarm is not compatible with --checkpoint and --resume.");
+        }
+    }
+
+    if (!externalDirectory.empty()) {
+        if (trace != TraceLevel::None) {
+            throw base_error("Argument Error: --external-bfs is not compatible with traces.");
+        }
+        if (bitstate > 0) {
+            throw base_error("Argument Error: --external-bfs is not compatible with --bitstate.");
+        }
+    }
+
     //Check for compatibility with LTL model checking
     if (logic == TemporalLogic::LTL) {
         if (tar) {
@@ -50,6 +50,7 @@
 #include "PetriEngine/Synthesis/SimpleSynthesis.h"
 #include "LTL/LTLSearch.h"
 #include "PetriEngine/PQL/PQL.h"
+#include "utils/MemoryLimit.h"
 
 using namespace PetriEngine;
 using namespace PetriEngine::PQL;
@@ -61,6 +62,7 @@ int main(int argc, const char** argv) {
         options_t options;
         if (options.parse(argc, argv)) // if options were --help or --version
             return to_underlying(ReturnValue::SuccessCode);
+        MemoryLimit::set(options.memoryLimit);
 
         if (options.printstatistics) {
             std::cout << std::endl << "Parameters: ";
@@ -402,10 +404,17 @@ int main(int argc, const char** argv) {
                 options.usedltl = true;
 
                 for (auto qid : ltl_ids) {
+                    MemoryLimit::reset();
                     LTL::LTLSearch search(*net, queries[qid], options.buchiOptimization, options.ltl_compress_aps);
-                    auto res = search.solve(options.trace != TraceLevel::None, options.kbound,
-                        options.ltlalgorithm, options.stubbornreduction ? options.ltl_por : LTL::LTLPartialOrder::None,
-                        options.strategy, options.ltlHeuristic, options.ltluseweak, options.seed_offset);
+                    bool res;
+                    try {
+                        res = search.solve(options.trace != TraceLevel::None, options.kbound,
+                            options.ltlalgorithm, options.stubbornreduction ? options.ltl_por : LTL::LTLPartialOrder::None,
+                            options.strategy, options.ltlHeuristic, options.ltluseweak, options.seed_offset);
+                    } catch (const memory_limit_error&) {
+                        MemoryLimit::printUnsolved(std::cout, querynames[qid], qid);
+                        continue;
+                    }
 
                     if(options.printstatistics)
                         search.print_stats(std::cout);
@@ -512,19 +521,47 @@ int main(int argc, const char** argv) {
                                    options.trace != TraceLevel::None);
             } else {
                 ReachabilitySearch strategy(*net, printer, options.kbound);
+                if (options.bitstate > 0)
+                    strategy.setBitstate(options.bitstate, options.bitstateHashes, options.bitstateFrontier);
+                if (!options.externalDirectory.empty())
+                    strategy.setExternal(options.externalDirectory, options.externalBuffer * 1024 * 1024);
+                if (!options.checkpointFile.empty())
+                    strategy.setCheckpoint(options.checkpointFile, options.checkpointInterval);
+                if (!options.resumeFile.empty())
+                    strategy.setResume(options.resumeFile);
+                strategy.setEnabledCache(options.enabledCache * 1024 * 1024);
 
                 // Change default place-holder to default strategy
                 if (options.strategy == Strategy::DEFAULT) options.strategy = Strategy::HEUR;
 
                 //Reachability search
-                strategy.reachable(queries, results,
+                MemoryLimit::reset();
+                if (options.swarm > 0 && !options.statespaceexploration)
+                    strategy.swarm(queries, results,
+                                   options.strategy,
+                                   options.stubbornreduction,
+                                   options.printstatistics,
+                                   options.trace != TraceLevel::None,
+                                   options.seed(),
+                                   options.swarm,
+                                   options.cores);
+                else
+                    strategy.reachable(queries, results,
                                    options.strategy,
                                    options.stubbornreduction,
                                    options.statespaceexploration,
                                    options.printstatistics,
                                    options.trace != TraceLevel::None,
-                                   options.seed());
+                                   options.seed(),
+                                   options.cores);
             }
+
+            // bitstate hashing may prune unseen markings, so the queries it did not
+            // satisfy are left open as when the memory limit is exhausted
+            if (MemoryLimit::exhausted())
+                printer.printUnsolved(std::cout, results, "within the memory limit");
+            else if (options.bitstate > 0 && !options.tar)
+                printer.printUnsolved(std::cout, results, "by the bitstate search");
         }
     } catch (base_error& e) {
         std::cerr << "ERROR: " << e.what() << std::endl;